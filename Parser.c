@@ -1,42 +1,109 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
 #include "parser.h"
 
 
+static ASTNode* parse_any_statement(Parser* parser);
+
+
+_Noreturn void parse_error(Parser* parser, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(parser->error, sizeof(parser->error), format, args);
+    va_end(args);
+
+    if (!parser->on_error) {
+        printf("%s", parser->error);
+        exit(1);
+    }
+    longjmp(*parser->on_error, 1);
+}
+
 void advance_token(Parser* parser) {
     parser->current = next_token(parser->lexer);
+
+    // Names end up in fixed 64-byte fields (schema, catalog, log records)
+    if (parser->current.type == TOKEN_IDENTIFIER && parser->current.length > 63) {
+        parse_error(parser, "Identifier too long: '%.20s...'\n", token_start(parser->lexer, parser->current));
+    }
+}
+
+const char* token_text(Parser* parser) {
+    return arena_strndup(parser->arena, token_start(parser->lexer, parser->current),
+                         parser->current.length);
 }
 
 void expect(Parser* parser, TokenType type) {
     if (parser->current.type != type) {
-        printf("Parse error: expected %d but got %d (%s)\n",
-               type, parser->current.type, parser->current.lexeme);
-        exit(1);
+        parse_error(parser, "Parse error: expected %d but got %d (%.*s)\n",
+               type, parser->current.type, parser->current.length,
+               token_start(parser->lexer, parser->current));
     }
     advance_token(parser);
 }
 
-void parser_init(Parser* parser, Lexer* lexer) {
+/* Whether the current token is an identifier spelling word, ignoring case */
+static int is_word(Parser* parser, const char* word) {
+    if (parser->current.type != TOKEN_IDENTIFIER || parser->current.length != (int)strlen(word)) {
+        return 0;
+    }
+    const char* text = token_start(parser->lexer, parser->current);
+    for (int i = 0; i < parser->current.length; i++) {
+        if (tolower((unsigned char)text[i]) != word[i]) return 0;
+    }
+    return 1;
+}
+
+void parser_init(Parser* parser, Lexer* lexer, Arena* arena) {
     parser->lexer = lexer;
-    advance_token(parser);
+    parser->arena = arena;
+    parser->parameterize = 0;
+    parser->param_count = 0;
+    parser->on_error = NULL;
+    parser->error[0] = '\0';
+    parser->current = next_token(lexer);
 }
 
 
 
 ASTNode* parse_column(Parser* parser) {
     if (parser->current.type == TOKEN_STAR) {
-        ASTNode* star_node = ast_new(AST_STAR, NULL);
+        ASTNode* star_node = ast_new(parser->arena, AST_STAR, NULL);
         advance_token(parser);
         return star_node;
     }
 
     if (parser->current.type != TOKEN_IDENTIFIER) {
-        printf("Expected column name or *\n");
-        exit(1);
+        parse_error(parser, "Expected column name or *\n");
     }
 
-    ASTNode* col_node = ast_new(AST_IDENTIFIER, parser->current.lexeme);
+    ASTNode* col_node = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
     advance_token(parser);
+    if (parser->current.type != TOKEN_LEFT_PAREN) {
+        return col_node;
+    }
+
+    // name(*) or name(column): an aggregate, named in lowercase
+    char* name = (char*)col_node->value;
+    for (char* c = name; *c; c++) *c = (char)tolower((unsigned char)*c);
+    if (strcmp(name, "count") != 0 && strcmp(name, "sum") != 0 && strcmp(name, "min") != 0 &&
+        strcmp(name, "max") != 0 && strcmp(name, "avg") != 0) {
+        parse_error(parser, "Unknown function '%s'\n", name);
+    }
+    col_node->type = AST_AGGREGATE;
+    advance_token(parser);
+
+    if (parser->current.type == TOKEN_STAR) {
+        col_node->left = ast_new(parser->arena, AST_STAR, NULL);
+    } else if (parser->current.type == TOKEN_IDENTIFIER) {
+        col_node->left = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
+    } else {
+        parse_error(parser, "Expected column name or * in %s()\n", name);
+    }
+    advance_token(parser);
+    expect(parser, TOKEN_RIGHT_PAREN);
     return col_node;
 }
 
@@ -56,34 +123,49 @@ ASTNode* parse_column_list(Parser* parser) {
 
 
 
+/* A literal, bare word or ? placeholder. Placeholders are numbered in the
+   order they appear; with parameterize set, literals are numbered too so
+   one cached plan serves every value. */
+ASTNode* parse_value(Parser* parser) {
+    TokenType type = parser->current.type;
+    ASTNode* node;
+
+    if (type == TOKEN_PARAM || (parser->parameterize && (type == TOKEN_NUMBER || type == TOKEN_STRING))) {
+        node = ast_new(parser->arena, AST_PARAM, "?");
+        node->param = ++parser->param_count;
+    } else if (type == TOKEN_NUMBER) {
+        node = ast_new(parser->arena, AST_LITERAL_NUMBER, token_text(parser));
+    } else if (type == TOKEN_STRING) {
+        node = ast_new(parser->arena, AST_LITERAL_STRING, token_text(parser));
+    } else {
+        node = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
+    }
+
+    advance_token(parser);
+    return node;
+}
+
 ASTNode* parse_condition(Parser* parser) {
     if (parser->current.type != TOKEN_IDENTIFIER) {
-        printf("Expected column in WHERE condition\n");
-        exit(1);
+        parse_error(parser, "Expected column in WHERE condition\n");
     }
-    ASTNode* column = ast_new(AST_IDENTIFIER, parser->current.lexeme);
+    ASTNode* column = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
     advance_token(parser);
 
     TokenType op = parser->current.type;
     if (op != TOKEN_EQUAL && op != TOKEN_GREATER && op != TOKEN_LESS &&
         op != TOKEN_GREATER_EQUAL && op != TOKEN_LESS_EQUAL) {
-        printf("Expected comparison operator in WHERE\n");
-        exit(1);
+        parse_error(parser, "Expected comparison operator in WHERE\n");
     }
-    ASTNode* condition = ast_new(AST_CONDITION, parser->current.lexeme);
+    ASTNode* condition = ast_new(parser->arena, AST_CONDITION, token_text(parser));
     condition->left = column;
     advance_token(parser);
 
-    if (parser->current.type == TOKEN_NUMBER || parser->current.type == TOKEN_STRING) {
-        ASTNode* value_node = ast_new(
-            parser->current.type == TOKEN_NUMBER ? AST_LITERAL_NUMBER : AST_LITERAL_STRING,
-            parser->current.lexeme
-        );
-        condition->right = value_node;
-        advance_token(parser);
+    if (parser->current.type == TOKEN_NUMBER || parser->current.type == TOKEN_STRING ||
+        parser->current.type == TOKEN_PARAM) {
+        condition->right = parse_value(parser);
     } else {
-        printf("Expected literal value in WHERE\n");
-        exit(1);
+        parse_error(parser, "Expected literal value in WHERE\n");
     }
 
     return condition;
@@ -92,11 +174,11 @@ ASTNode* parse_condition(Parser* parser) {
 ASTNode* parse_where(Parser* parser) {
     expect(parser, TOKEN_WHERE);
 
-    ASTNode* where_node = ast_new(AST_WHERE, NULL);
+    ASTNode* where_node = ast_new(parser->arena, AST_WHERE, NULL);
     ASTNode* current = parse_condition(parser);
 
     while (parser->current.type == TOKEN_AND || parser->current.type == TOKEN_OR) {
-        ASTNode* logic = ast_new(AST_CONDITION, parser->current.lexeme); 
+        ASTNode* logic = ast_new(parser->arena, AST_CONDITION, token_text(parser)); 
         advance_token(parser);
         ASTNode* next_cond = parse_condition(parser);
         logic->left = current;
@@ -110,25 +192,129 @@ ASTNode* parse_where(Parser* parser) {
 
 
 
+/* JOIN table ON column = column */
+ASTNode* parse_join(Parser* parser) {
+    expect(parser, TOKEN_JOIN);
+    if (parser->current.type != TOKEN_IDENTIFIER) {
+        parse_error(parser, "Expected table name after JOIN\n");
+    }
+    ASTNode* join_node = ast_new(parser->arena, AST_JOIN, token_text(parser));
+    advance_token(parser);
+    expect(parser, TOKEN_ON);
+
+    if (parser->current.type != TOKEN_IDENTIFIER) {
+        parse_error(parser, "Expected column after ON\n");
+    }
+    ASTNode* left = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
+    advance_token(parser);
+    if (parser->current.type != TOKEN_EQUAL) {
+        parse_error(parser, "Expected = in JOIN condition\n");
+    }
+    ASTNode* condition = ast_new(parser->arena, AST_CONDITION, token_text(parser));
+    advance_token(parser);
+    if (parser->current.type != TOKEN_IDENTIFIER) {
+        parse_error(parser, "Expected column after = in JOIN condition\n");
+    }
+    condition->left = left;
+    condition->right = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
+    advance_token(parser);
+
+    join_node->left = condition;
+    return join_node;
+}
+
+/* ORDER BY column [ASC|DESC], ...: one AST_SORT_KEY per column */
+ASTNode* parse_order_by(Parser* parser) {
+    expect(parser, TOKEN_ORDER);
+    expect(parser, TOKEN_BY);
+
+    ASTNode* order_node = ast_new(parser->arena, AST_ORDER_BY, NULL);
+    ASTNode* current = NULL;
+    do {
+        if (current) {
+            advance_token(parser);
+        }
+        if (parser->current.type != TOKEN_IDENTIFIER) {
+            parse_error(parser, "Expected column name in ORDER BY\n");
+        }
+        ASTNode* key = ast_new(parser->arena, AST_SORT_KEY, "asc");
+        key->left = parse_column(parser);
+        if (parser->current.type == TOKEN_ASC || parser->current.type == TOKEN_DESC) {
+            key->value = parser->current.type == TOKEN_DESC ? "desc" : "asc";
+            advance_token(parser);
+        }
+        if (current) {
+            current->right = key;
+        } else {
+            order_node->left = key;
+        }
+        current = key;
+    } while (parser->current.type == TOKEN_COMMA);
+
+    return order_node;
+}
+
+/* LIMIT n or OFFSET n: the keyword, then a number or ? */
+ASTNode* parse_row_count(Parser* parser, ASTNodeType type, const char* keyword) {
+    advance_token(parser);
+    if (parser->current.type != TOKEN_NUMBER && parser->current.type != TOKEN_PARAM) {
+        parse_error(parser, "Expected number after %s\n", keyword);
+    }
+    ASTNode* node = ast_new(parser->arena, type, NULL);
+    node->left = parse_value(parser);
+    return node;
+}
+
 ASTNode* parse_select(Parser* parser) {
     expect(parser, TOKEN_SELECT);
 
-    ASTNode* select_node = ast_new(AST_SELECT, NULL);
+    ASTNode* select_node = ast_new(parser->arena, AST_SELECT, NULL);
+    if (parser->current.type == TOKEN_DISTINCT) {
+        select_node->value = "distinct";
+        advance_token(parser);
+    }
     select_node->left = parse_column_list(parser);
 
     expect(parser, TOKEN_FROM);
 
     if (parser->current.type != TOKEN_IDENTIFIER) {
-        printf("Expected table name\n");
-        exit(1);
+        parse_error(parser, "Expected table name\n");
     }
-    ASTNode* table_node = ast_new(AST_IDENTIFIER, parser->current.lexeme);
+    ASTNode* table_node = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
     select_node->right = table_node;
     advance_token(parser);
 
+    // Optional clauses, each chained to the previous one
+    ASTNode* clause = table_node;
+    if (parser->current.type == TOKEN_JOIN) {
+        clause->right = parse_join(parser);
+        clause = clause->right;
+    }
     if (parser->current.type == TOKEN_WHERE) {
-        ASTNode* where_node = parse_where(parser);
-        table_node->right = where_node; 
+        clause->right = parse_where(parser);
+        clause = clause->right;
+    }
+    if (parser->current.type == TOKEN_GROUP) {
+        advance_token(parser);
+        expect(parser, TOKEN_BY);
+        clause->right = ast_new(parser->arena, AST_GROUP_BY, NULL);
+        clause = clause->right;
+        if (parser->current.type != TOKEN_IDENTIFIER) {
+            parse_error(parser, "Expected column name after GROUP BY\n");
+        }
+        clause->left = parse_column_list(parser);
+    }
+    if (parser->current.type == TOKEN_ORDER) {
+        clause->right = parse_order_by(parser);
+        clause = clause->right;
+    }
+    if (parser->current.type == TOKEN_LIMIT) {
+        clause->right = parse_row_count(parser, AST_LIMIT, "LIMIT");
+        clause = clause->right;
+    }
+    if (parser->current.type == TOKEN_OFFSET) {
+        clause->right = parse_row_count(parser, AST_OFFSET, "OFFSET");
+        clause = clause->right;
     }
 
     expect(parser, TOKEN_SEMICOLON);
@@ -140,12 +326,11 @@ ASTNode* parse_insert(Parser* parser) {
     expect(parser, TOKEN_INTO);
 
     if (parser->current.type != TOKEN_IDENTIFIER) {
-        printf("Expected table name after INSERT INTO\n");
-        exit(1);
+        parse_error(parser, "Expected table name after INSERT INTO\n");
     }
 
-    ASTNode* insert_node = ast_new(AST_INSERT, NULL);
-    ASTNode* table_node = ast_new(AST_IDENTIFIER, parser->current.lexeme);
+    ASTNode* insert_node = ast_new(parser->arena, AST_INSERT, NULL);
+    ASTNode* table_node = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
     insert_node->right = table_node;
     advance_token(parser);
 
@@ -157,61 +342,162 @@ ASTNode* parse_insert(Parser* parser) {
 
     expect(parser, TOKEN_VALUES);
 
-    expect(parser, TOKEN_LEFT_PAREN);
-    ASTNode* value_head = NULL;
-    ASTNode* value_current = NULL;
-
-    // Parse all values
-    while (parser->current.type == TOKEN_NUMBER || 
-           parser->current.type == TOKEN_STRING ||
-           parser->current.type == TOKEN_IDENTIFIER) {
-        
-        ASTNodeType value_type;
-        if (parser->current.type == TOKEN_NUMBER) {
-            value_type = AST_LITERAL_NUMBER;
-        } else if (parser->current.type == TOKEN_STRING) {
-            value_type = AST_LITERAL_STRING;
-        } else {
-            value_type = AST_IDENTIFIER;
+    // One AST_VALUES node per tuple: left = value chain, right = next tuple
+    ASTNode* tuple_head = NULL;
+    ASTNode* tuple_current = NULL;
+
+    while (1) {
+        expect(parser, TOKEN_LEFT_PAREN);
+        ASTNode* value_head = NULL;
+        ASTNode* value_current = NULL;
+
+        // Parse all values
+        while (parser->current.type == TOKEN_NUMBER || 
+               parser->current.type == TOKEN_STRING ||
+               parser->current.type == TOKEN_IDENTIFIER ||
+               parser->current.type == TOKEN_PARAM) {
+            
+            ASTNode* val_node = parse_value(parser);
+
+            if (!value_head) {
+                value_head = val_node;
+                value_current = val_node;
+            } else {
+                value_current->right = val_node;
+                value_current = val_node;
+            }
+
+            // Check for comma (more values coming)
+            if (parser->current.type == TOKEN_COMMA) {
+                advance_token(parser);
+            } else {
+                break;  // No more values
+            }
         }
-        
-        ASTNode* val_node = ast_new(value_type, parser->current.lexeme);
-        advance_token(parser);
 
-        if (!value_head) {
-            value_head = val_node;
-            value_current = val_node;
+        expect(parser, TOKEN_RIGHT_PAREN);
+
+        ASTNode* tuple = ast_new(parser->arena, AST_VALUES, NULL);
+        tuple->left = value_head;
+        if (!tuple_head) {
+            tuple_head = tuple;
         } else {
-            value_current->right = val_node;
-            value_current = val_node;
+            tuple_current->right = tuple;
         }
+        tuple_current = tuple;
 
-        // Check for comma (more values coming)
+        // VALUES (...), (...), ...
         if (parser->current.type == TOKEN_COMMA) {
             advance_token(parser);
         } else {
-            break;  // No more values
+            break;
         }
     }
 
-    expect(parser, TOKEN_RIGHT_PAREN);
     expect(parser, TOKEN_SEMICOLON);
 
-    table_node->right = value_head;
+    table_node->right = tuple_head;
     return insert_node;
 }
 
+ASTNode* parse_load(Parser* parser) {
+    expect(parser, TOKEN_LOAD);
+    expect(parser, TOKEN_DATA);
+
+    if (parser->current.type != TOKEN_STRING) {
+        parse_error(parser, "Expected file name after LOAD DATA\n");
+    }
+
+    ASTNode* load_node = ast_new(parser->arena, AST_LOAD, token_text(parser));
+    advance_token(parser);
+
+    expect(parser, TOKEN_INTO);
+
+    if (parser->current.type != TOKEN_IDENTIFIER) {
+        parse_error(parser, "Expected table name after INTO\n");
+    }
+
+    load_node->right = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
+    advance_token(parser);
+    expect(parser, TOKEN_SEMICOLON);
+
+    return load_node;
+}
+
+ASTNode* parse_prepare(Parser* parser) {
+    expect(parser, TOKEN_PREPARE);
+
+    if (parser->current.type != TOKEN_IDENTIFIER) {
+        parse_error(parser, "Expected statement name after PREPARE\n");
+    }
+
+    ASTNode* prepare_node = ast_new(parser->arena, AST_PREPARE, token_text(parser));
+    advance_token(parser);
+    expect(parser, TOKEN_AS);
+
+    if (parser->current.type != TOKEN_SELECT && parser->current.type != TOKEN_INSERT) {
+        parse_error(parser, "Only SELECT and INSERT can be prepared\n");
+    }
+
+    // Keep the statement's text; it is planned again whenever its plan is not cached
+    int start = parser->current.offset;
+    prepare_node->left = parse_any_statement(parser);
+    prepare_node->right = ast_new(parser->arena, AST_LITERAL_STRING,
+                                  arena_strndup(parser->arena, parser->lexer->input + start,
+                                                parser->lexer->pos - start));
+    return prepare_node;
+}
+
+ASTNode* parse_execute(Parser* parser) {
+    expect(parser, TOKEN_EXECUTE);
+
+    if (parser->current.type != TOKEN_IDENTIFIER) {
+        parse_error(parser, "Expected statement name after EXECUTE\n");
+    }
+
+    ASTNode* execute_node = ast_new(parser->arena, AST_EXECUTE, token_text(parser));
+    advance_token(parser);
+
+    // Optional argument list: EXECUTE name(1, 'x')
+    if (parser->current.type == TOKEN_LEFT_PAREN) {
+        advance_token(parser);
+        ASTNode* arg_current = NULL;
+        while (parser->current.type == TOKEN_NUMBER || parser->current.type == TOKEN_STRING) {
+            ASTNode* arg = ast_new(parser->arena,
+                parser->current.type == TOKEN_NUMBER ? AST_LITERAL_NUMBER : AST_LITERAL_STRING,
+                token_text(parser));
+            advance_token(parser);
+
+            if (!arg_current) {
+                execute_node->left = arg;
+            } else {
+                arg_current->right = arg;
+            }
+            arg_current = arg;
+
+            if (parser->current.type == TOKEN_COMMA) {
+                advance_token(parser);
+            } else {
+                break;
+            }
+        }
+        expect(parser, TOKEN_RIGHT_PAREN);
+    }
+
+    expect(parser, TOKEN_SEMICOLON);
+    return execute_node;
+}
+
 ASTNode* parse_createdatabase(Parser* parser) {
     expect(parser, TOKEN_CREATE);
     expect(parser, TOKEN_DATABASE);
 
     if (parser->current.type != TOKEN_IDENTIFIER) {
-        printf("Expected database name\n");
-        exit(1);
+        parse_error(parser, "Expected database name\n");
     }
 
-    ASTNode* create_node = ast_new(AST_CREATE, NULL);
-    ASTNode* database_node = ast_new(AST_IDENTIFIER, parser->current.lexeme);
+    ASTNode* create_node = ast_new(parser->arena, AST_CREATE, NULL);
+    ASTNode* database_node = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
     create_node->right = database_node;
     advance_token(parser);
     expect(parser, TOKEN_SEMICOLON);
@@ -224,12 +510,11 @@ ASTNode* parse_createtable(Parser* parser) {
     expect(parser, TOKEN_TABLE);
 
     if (parser->current.type != TOKEN_IDENTIFIER) {
-        printf("Expected table name\n");
-        exit(1);
+        parse_error(parser, "Expected table name\n");
     }
 
-    ASTNode* create_node = ast_new(AST_CREATE, NULL);
-    ASTNode* table_node = ast_new(AST_IDENTIFIER, parser->current.lexeme);
+    ASTNode* create_node = ast_new(parser->arena, AST_CREATE, NULL);
+    ASTNode* table_node = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
     create_node->right = table_node;
     advance_token(parser);
 
@@ -239,34 +524,63 @@ ASTNode* parse_createtable(Parser* parser) {
     ASTNode* col_current = NULL;
 
     while (parser->current.type == TOKEN_IDENTIFIER) {
-        ASTNode* col_node = ast_new(AST_IDENTIFIER, parser->current.lexeme);
+        ASTNode* col_node = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
         advance_token(parser);
 
         if (parser->current.type != TOKEN_VARCHAR &&
             parser->current.type != TOKEN_INT &&
             parser->current.type != TOKEN_DOUBLE &&
             parser->current.type != TOKEN_DATE) {
-            printf("Expected datatype for column\n");
-            exit(1);
+            parse_error(parser, "Expected datatype for column\n");
         }
 
-        ASTNode* type_node = ast_new(AST_DATATYPE, parser->current.lexeme);
+        ASTNode* type_node = ast_new(parser->arena, AST_DATATYPE, token_text(parser));
         col_node->right = type_node;
+        int is_varchar = parser->current.type == TOKEN_VARCHAR;
         advance_token(parser);
 
+        // VARCHAR(n): kept in the type name as "varchar(n)"
+        if (is_varchar && parser->current.type == TOKEN_LEFT_PAREN) {
+            advance_token(parser);
+            if (parser->current.type != TOKEN_NUMBER) {
+                parse_error(parser, "Expected length for VARCHAR\n");
+            }
+            const char* digits = token_text(parser);
+            size_t size = strlen(digits) + sizeof("varchar()");
+            char* type_name = arena_alloc(parser->arena, size);
+            snprintf(type_name, size, "varchar(%s)", digits);
+            type_node->value = type_name;
+            advance_token(parser);
+            expect(parser, TOKEN_RIGHT_PAREN);
+        }
+
+        // Columns are chained through their datatype nodes: col -> type -> col
         if (!col_head) {
             col_head = col_node;
-            col_current = col_node;
         } else {
             col_current->right = col_node;
-            col_current = col_node;
         }
+        col_current = type_node;
 
         if (parser->current.type == TOKEN_COMMA) advance_token(parser);
         else break;
     }
 
     expect(parser, TOKEN_RIGHT_PAREN);
+
+    // STORAGE = ROW | COLUMN, kept in the CREATE node's value
+    if (parser->current.type == TOKEN_STORAGE) {
+        advance_token(parser);
+        expect(parser, TOKEN_EQUAL);
+        if (is_word(parser, "column")) {
+            create_node->value = "COLUMN";
+        } else if (is_word(parser, "row")) {
+            create_node->value = "ROW";
+        } else {
+            parse_error(parser, "Expected ROW or COLUMN after STORAGE =\n");
+        }
+        advance_token(parser);
+    }
     expect(parser, TOKEN_SEMICOLON);
 
     table_node->left = col_head;
@@ -277,12 +591,11 @@ ASTNode* parse_use(Parser* parser) {
     expect(parser, TOKEN_USE);
 
     if (parser->current.type != TOKEN_IDENTIFIER) {
-        printf("Expected database name\n");
-        exit(1);
+        parse_error(parser, "Expected database name\n");
     }
 
-    ASTNode* use_node = ast_new(AST_USE, NULL);
-    ASTNode* db_node = ast_new(AST_IDENTIFIER, parser->current.lexeme);
+    ASTNode* use_node = ast_new(parser->arena, AST_USE, NULL);
+    ASTNode* db_node = ast_new(parser->arena, AST_IDENTIFIER, token_text(parser));
     use_node->right = db_node;
     advance_token(parser);
     expect(parser, TOKEN_SEMICOLON);
@@ -294,50 +607,64 @@ ASTNode* parse_show(Parser* parser) {
     expect(parser, TOKEN_SHOW);
 
     if (parser->current.type == TOKEN_DATABASES) {
-        ASTNode* node = ast_new(AST_SHOW, "DATABASES");
+        ASTNode* node = ast_new(parser->arena, AST_SHOW, "DATABASES");
         advance_token(parser);
         expect(parser, TOKEN_SEMICOLON);
         return node;
     }
 
     if (parser->current.type == TOKEN_TABLES) {
-        ASTNode* node = ast_new(AST_SHOW, "TABLES");
+        ASTNode* node = ast_new(parser->arena, AST_SHOW, "TABLES");
         advance_token(parser);
         expect(parser, TOKEN_SEMICOLON);
         return node;
     }
 
-    printf("Expected DATABASES or TABLES after SHOW\n");
-    exit(1);
+    parse_error(parser, "Expected DATABASES or TABLES after SHOW\n");
 }
 
 
 
-ASTNode* parse_statement(Parser* parser) {
+static ASTNode* parse_any_statement(Parser* parser) {
     switch (parser->current.type) {
         case TOKEN_SELECT: return parse_select(parser);
         case TOKEN_INSERT: return parse_insert(parser);
+        case TOKEN_LOAD: return parse_load(parser);
+        case TOKEN_PREPARE: return parse_prepare(parser);
+        case TOKEN_EXECUTE: return parse_execute(parser);
         case TOKEN_CREATE:
 
             {
                 Lexer temp_lexer = *(parser->lexer);
-                Parser temp_parser = *parser;
-                temp_parser.lexer = &temp_lexer;
-                advance_token(&temp_parser);
+                Token next = next_token(&temp_lexer);
                 
-                if (temp_parser.current.type == TOKEN_DATABASE)
+                if (next.type == TOKEN_DATABASE)
                     return parse_createdatabase(parser);
-                else if (temp_parser.current.type == TOKEN_TABLE)
+                else if (next.type == TOKEN_TABLE)
                     return parse_createtable(parser);
                 else {
-                    printf("Expected DATABASE or TABLE after CREATE\n");
-                    exit(1);
+                    parse_error(parser, "Expected DATABASE or TABLE after CREATE\n");
                 }
             }
         case TOKEN_USE: return parse_use(parser);
         case TOKEN_SHOW: return parse_show(parser);
         default:
-            printf("Unknown statement\n");
-            exit(1);
+            parse_error(parser, "Unknown statement\n");
     }
-}
\ No newline at end of file
+}
+
+ASTNode* parse_statement(Parser* parser) {
+    // Errors anywhere below jump back here; the message is in parser->error
+    jmp_buf on_error;
+    parser->on_error = &on_error;
+    parser->error[0] = '\0';
+
+    if (setjmp(on_error)) {
+        parser->on_error = NULL;
+        return NULL;
+    }
+
+    ASTNode* root = parse_any_statement(parser);
+    parser->on_error = NULL;
+    return root;
+}
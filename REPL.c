@@ -7,6 +7,12 @@
 #include "parser.h"
 #include "ast.h"
 #include "executor.h"
+#include "plan.h"
+#include "script.h"
+#include "result.h"
+#include "pool.h"
+#include "spill.h"
+#include "platform.h"
 
 
 /* Prompt */
@@ -15,41 +21,96 @@ void print_prompt() {
 }
 
 
-int main() {
+int main(int argc, char* argv[]) {
+    work_memory_init();
+    const char* script_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        ResultFormat format;
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            script_path = argv[++i];
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc && result_format_by_name(argv[i + 1], &format)) {
+            result_set_format(format);
+            i++;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            pool_set_threads(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "-u") == 0) {
+            parallel_scan_ordered = 0;
+        } else {
+            printf("Usage: %s [-f script.sql] [-m table|csv|tsv|binary] [-t threads] [-u]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    /* Script mode: a file, or whatever is piped into stdin */
+    if (script_path) {
+        FILE* script = fopen(script_path, "r");
+        if (!script) {
+            perror("Failed to open script");
+            return 1;
+        }
+        int status = run_script(script);
+        fclose(script);
+        return status;
+    }
+    if (!stdin_is_terminal()) {
+        return run_script(stdin);
+    }
+
     InputBuffer* input_buffer = new_input_buffer();
-    init_keywords();
+
+    // Everything a statement allocates is released at once when it ends
+    Arena arena;
+    arena_init(&arena, ARENA_DEFAULT_BLOCK_SIZE);
 
     while (1) {
         print_prompt();
-        read_input(input_buffer);
+        if (!read_input(input_buffer)) {
+            printf("\n");
+            break;
+        }
 
-        if (strcmp(input_buffer->buffer, ".exit") == 0) {
-            close_input_buffer(input_buffer);
-            return 0;
-        }   
+        if (input_buffer->buffer[0] == '.') {
+            int status = run_meta_command(input_buffer->buffer);
+            if (status == META_EXIT) {
+                break;
+            }
+            if (status == META_UNKNOWN) {
+                printf("Unrecognized command '%s'\n", input_buffer->buffer);
+            }
+            continue;
+        }
+
+        /* Repeated SELECT/INSERT shapes run from the plan cache */
+        if (plan_cache_execute(input_buffer->buffer, &arena)) {
+            arena_reset(&arena);
+            continue;
+        }
 
         /* Initialize lexer and parser */
         Lexer lexer = { input_buffer->buffer, 0 };
         Parser parser;
-        parser_init(&parser, &lexer);
+        parser_init(&parser, &lexer, &arena);
 
         /* Parse the statement */
         ASTNode* root = NULL;
-        // Handle parse errors gracefully
         if (strlen(input_buffer->buffer) > 0) {
             root = parse_statement(&parser);
+            if (!root) {
+                printf("%s", parser.error);
+            }
         }
 
         /* Print the AST */
         if (root) {
-            execute_statement(root); 
+            execute_statement(root, &arena); 
             //printf("AST:\n");
             //print_ast(root, 0);
         }
 
-        // Free AST nodes here if you implement a destroy function
+        arena_reset(&arena);
     }
 
     close_input_buffer(input_buffer);
+    arena_free(&arena);
     return 0;
 }
@@ -0,0 +1,541 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aggregate.h"
+#include "group.h"
+#include "pool.h"
+#include "output.h"
+
+static const struct {
+    const char* name;
+    AggregateFunction function;
+} functions[] = {
+    { "count", AGG_COUNT },
+    { "sum", AGG_SUM },
+    { "min", AGG_MIN },
+    { "max", AGG_MAX },
+    { "avg", AGG_AVG },
+};
+
+int has_aggregates(ASTNode* column_list) {
+    for (ASTNode* column = column_list; column; column = column->right) {
+        if (column->type == AST_AGGREGATE) return 1;
+    }
+    return 0;
+}
+
+static int find_column(TableSchema* schema, const char* name) {
+    for (int i = 0; i < schema->column_count; i++) {
+        if (strcmp(schema->columns[i].column_name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/* ============================================
+   PLANNING
+   ============================================ */
+
+/* Result column of one aggregate, placed at offset */
+static void result_column(const AggregateSpec* spec, const char* function_name,
+                          const char* argument, int offset, ColumnSchema* out) {
+    memset(out, 0, sizeof(*out));
+    int numeric_sum = spec->function == AGG_COUNT ||
+                      (spec->function == AGG_SUM && spec->source.type != TYPE_DOUBLE);
+    if (numeric_sum) {
+        strcpy(out->data_type, "bigint");
+        out->type = TYPE_BIGINT;
+        out->width = column_width(TYPE_BIGINT);
+    } else if (spec->function == AGG_SUM || spec->function == AGG_AVG) {
+        strcpy(out->data_type, "double");
+        out->type = TYPE_DOUBLE;
+        out->width = sizeof(double);
+    } else {
+        // MIN and MAX keep the column's type and storage
+        *out = spec->source;
+    }
+    snprintf(out->column_name, sizeof(out->column_name), "%s(%s)", function_name, argument);
+    out->offset = offset;
+}
+
+/* Resolve one aggregate call; returns 0 after printing an error */
+static int resolve_aggregate(ASTNode* call, TableSchema* schema, AggregateSpec* spec) {
+    for (size_t f = 0; f < sizeof(functions) / sizeof(functions[0]); f++) {
+        if (strcmp(functions[f].name, call->value) == 0) {
+            spec->function = functions[f].function;
+        }
+    }
+
+    ASTNode* argument = call->left;
+    spec->column = -1;
+    if (argument->type == AST_STAR) {
+        if (spec->function != AGG_COUNT) {
+            out_printf("%s(*) is not supported, only COUNT(*)\n", call->value);
+            return 0;
+        }
+        return 1;
+    }
+
+    spec->column = find_column(schema, argument->value);
+    if (spec->column < 0) {
+        out_printf("Column '%s' not found\n", argument->value);
+        return 0;
+    }
+    spec->source = schema->columns[spec->column];
+    if (spec->source.type == TYPE_UNKNOWN ||
+        (spec->source.type == TYPE_VARCHAR && (spec->function == AGG_SUM || spec->function == AGG_AVG))) {
+        out_printf("Cannot apply %s to %s column '%s'\n", call->value, spec->source.data_type,
+                   argument->value);
+        return 0;
+    }
+    return 1;
+}
+
+/* Key index of a column, added to the keys if add is set; -1 if absent */
+static int key_of(AggregatePlan* plan, TableSchema* schema, int column, int add) {
+    for (int k = 0; k < plan->key_count; k++) {
+        if (plan->keys[k].column == column) return k;
+    }
+    if (!add) return -1;
+    AggregateKey* key = &plan->keys[plan->key_count];
+    key->column = column;
+    key->source = schema->columns[column];
+    key->offset = plan->key_size;
+    plan->key_size += key->source.width;
+    if (key->source.overflow) plan->key_descriptors = 1;
+    return plan->key_count++;
+}
+
+AggregatePlan* aggregate_plan(ASTNode* column_list, ASTNode* group_by, int distinct,
+                              TableSchema* schema, Arena* arena) {
+    if (distinct && group_by) {
+        out_printf("SELECT DISTINCT cannot be combined with GROUP BY\n");
+        return NULL;
+    }
+
+    // Result columns, with DISTINCT * standing for every column
+    int outputs = 0;
+    int aggregates = 0;
+    int group_columns = 0;
+    for (ASTNode* column = column_list; column; column = column->right) {
+        if (column->type == AST_STAR && !distinct) {
+            out_printf("Cannot select * together with aggregate functions or GROUP BY\n");
+            return NULL;
+        }
+        if (column->type == AST_AGGREGATE && distinct) {
+            out_printf("SELECT DISTINCT cannot be combined with aggregate functions\n");
+            return NULL;
+        }
+        outputs += column->type == AST_STAR ? schema->column_count : 1;
+        aggregates += column->type == AST_AGGREGATE;
+    }
+    for (ASTNode* column = group_by; column; column = column->right) {
+        group_columns++;
+    }
+
+    AggregatePlan* plan = arena_calloc(arena, sizeof(AggregatePlan));
+    plan->specs = arena_calloc(arena, sizeof(AggregateSpec) * (aggregates ? aggregates : 1));
+    plan->keys = arena_calloc(arena, sizeof(AggregateKey) * (group_columns + outputs));
+    plan->outputs = arena_alloc(arena, sizeof(int) * outputs);
+    plan->result.columns = arena_calloc(arena, sizeof(ColumnSchema) * outputs);
+    plan->result.column_count = outputs;
+    plan->result_columns = arena_alloc(arena, sizeof(int) * outputs);
+    plan->result_offsets = arena_alloc(arena, sizeof(long) * outputs);
+    strcpy(plan->result.table_name, schema->table_name);
+
+    for (ASTNode* column = group_by; column; column = column->right) {
+        if (column->type != AST_IDENTIFIER) {
+            out_printf("GROUP BY takes column names\n");
+            return NULL;
+        }
+        int index = find_column(schema, column->value);
+        if (index < 0) {
+            out_printf("Column '%s' not found\n", column->value);
+            return NULL;
+        }
+        key_of(plan, schema, index, 1);
+    }
+
+    int output = 0;
+    int row_size = 0;
+    for (ASTNode* column = column_list; column; column = column->right) {
+        int expanded = column->type == AST_STAR ? schema->column_count : 1;
+        for (int e = 0; e < expanded; e++, output++) {
+            ColumnSchema* result = &plan->result.columns[output];
+            if (column->type == AST_AGGREGATE) {
+                AggregateSpec* spec = &plan->specs[plan->count];
+                if (!resolve_aggregate(column, schema, spec)) {
+                    return NULL;
+                }
+                result_column(spec, column->value,
+                              column->left->type == AST_STAR ? "*" : column->left->value, row_size, result);
+                plan->outputs[output] = plan->count++;
+            } else {
+                // A plain column: a DISTINCT key, or one of the GROUP BY keys
+                int index = column->type == AST_STAR ? e : find_column(schema, column->value);
+                if (index < 0) {
+                    out_printf("Column '%s' not found\n", column->value);
+                    return NULL;
+                }
+                int key = key_of(plan, schema, index, distinct);
+                if (key < 0) {
+                    out_printf("Column '%s' must appear in GROUP BY or inside an aggregate function\n",
+                               column->value);
+                    return NULL;
+                }
+                *result = schema->columns[index];
+                result->offset = row_size;
+                plan->outputs[output] = -1 - key;
+            }
+            row_size += result->width;
+            if (result->overflow) plan->result.overflow_columns++;
+            plan->result_columns[output] = output;
+            plan->result_offsets[output] = result->offset;
+        }
+    }
+    plan->result.row_size = row_size;
+    return plan;
+}
+
+AggregatePlan* aggregate_plan_copy(const AggregatePlan* plan, Arena* arena) {
+    int outputs = plan->result.column_count;
+    AggregatePlan* copy = arena_alloc(arena, sizeof(AggregatePlan));
+    *copy = *plan;
+    copy->specs = arena_alloc(arena, sizeof(AggregateSpec) * (plan->count ? plan->count : 1));
+    copy->keys = arena_alloc(arena, sizeof(AggregateKey) * (plan->key_count ? plan->key_count : 1));
+    copy->outputs = arena_alloc(arena, sizeof(int) * outputs);
+    copy->result.columns = arena_alloc(arena, sizeof(ColumnSchema) * outputs);
+    copy->result_columns = arena_alloc(arena, sizeof(int) * outputs);
+    copy->result_offsets = arena_alloc(arena, sizeof(long) * outputs);
+    memcpy(copy->specs, plan->specs, sizeof(AggregateSpec) * plan->count);
+    memcpy(copy->keys, plan->keys, sizeof(AggregateKey) * plan->key_count);
+    memcpy(copy->outputs, plan->outputs, sizeof(int) * outputs);
+    memcpy(copy->result.columns, plan->result.columns, sizeof(ColumnSchema) * outputs);
+    memcpy(copy->result_columns, plan->result_columns, sizeof(int) * outputs);
+    memcpy(copy->result_offsets, plan->result_offsets, sizeof(long) * outputs);
+    return copy;
+}
+
+int aggregate_plan_counts_only(const AggregatePlan* plan) {
+    if (plan->key_count > 0) return 0;
+    for (int i = 0; i < plan->count; i++) {
+        if (plan->specs[i].function != AGG_COUNT) return 0;
+    }
+    return 1;
+}
+
+/* ============================================
+   FOLDING
+   ============================================ */
+
+Aggregation* aggregation_new(const AggregatePlan* plan, const char* db_name, size_t budget) {
+    Aggregation* aggregation = calloc(1, sizeof(Aggregation));
+    aggregation->plan = plan;
+    snprintf(aggregation->db_name, sizeof(aggregation->db_name), "%s", db_name);
+    aggregation->budget = budget;
+    if (plan->key_count > 0) {
+        aggregation->groups = group_table_new(plan, db_name, budget);
+    } else {
+        aggregation->states = calloc(plan->count ? plan->count : 1, sizeof(AggregateState));
+    }
+    return aggregation;
+}
+
+Aggregation* aggregation_fork(const Aggregation* parent) {
+    return aggregation_new(parent->plan, parent->db_name, parent->budget / pool_threads());
+}
+
+void aggregation_free(Aggregation* aggregation) {
+    if (aggregation) {
+        free(aggregation->states);
+        group_table_free(aggregation->groups);
+        free(aggregation);
+    }
+}
+
+static int compare_text(const ColumnSchema* column, const char* a, const char* b, const char* overflow) {
+    const char* a_text;
+    const char* b_text;
+    int a_length = varchar_text(a, column->width, column->overflow, overflow, &a_text);
+    int b_length = varchar_text(b, column->width, column->overflow, overflow, &b_text);
+    int cmp = memcmp(a_text, b_text, a_length < b_length ? a_length : b_length);
+    return cmp ? cmp : (a_length > b_length) - (a_length < b_length);
+}
+
+/* Field of the i-th folded row */
+#define FIELD(i) (rows + (long)(selection ? selection[i] : (i)) * row_size + offset)
+
+static void fold_int(const AggregateSpec* spec, AggregateState* state, const char* rows, int row_size,
+                     const uint16_t* selection, int count) {
+    int offset = spec->source.offset;
+    if (spec->function == AGG_SUM || spec->function == AGG_AVG) {
+        long long sum = 0;
+        for (int i = 0; i < count; i++) {
+            int value;
+            memcpy(&value, FIELD(i), sizeof(int));
+            sum += value;
+        }
+        state->int_sum += sum;
+        return;
+    }
+
+    int best;
+    memcpy(&best, FIELD(0), sizeof(int));
+    if (spec->function == AGG_MIN) {
+        for (int i = 1; i < count; i++) {
+            int value;
+            memcpy(&value, FIELD(i), sizeof(int));
+            if (value < best) best = value;
+        }
+        if (state->count == 0 || best < state->int_best) state->int_best = best;
+    } else {
+        for (int i = 1; i < count; i++) {
+            int value;
+            memcpy(&value, FIELD(i), sizeof(int));
+            if (value > best) best = value;
+        }
+        if (state->count == 0 || best > state->int_best) state->int_best = best;
+    }
+}
+
+static void fold_double(const AggregateSpec* spec, AggregateState* state, const char* rows,
+                        int row_size, const uint16_t* selection, int count) {
+    int offset = spec->source.offset;
+    if (spec->function == AGG_SUM || spec->function == AGG_AVG) {
+        double sum = 0;
+        for (int i = 0; i < count; i++) {
+            double value;
+            memcpy(&value, FIELD(i), sizeof(double));
+            sum += value;
+        }
+        state->double_sum += sum;
+        return;
+    }
+
+    double best;
+    memcpy(&best, FIELD(0), sizeof(double));
+    if (spec->function == AGG_MIN) {
+        for (int i = 1; i < count; i++) {
+            double value;
+            memcpy(&value, FIELD(i), sizeof(double));
+            if (value < best) best = value;
+        }
+        if (state->count == 0 || best < state->double_best) state->double_best = best;
+    } else {
+        for (int i = 1; i < count; i++) {
+            double value;
+            memcpy(&value, FIELD(i), sizeof(double));
+            if (value > best) best = value;
+        }
+        if (state->count == 0 || best > state->double_best) state->double_best = best;
+    }
+}
+
+static void fold_text(const AggregateSpec* spec, AggregateState* state, const char* rows, int row_size,
+                      const uint16_t* selection, int count, const char* overflow) {
+    const ColumnSchema* column = &spec->source;
+    int offset = column->offset;
+    int sign = spec->function == AGG_MIN ? -1 : 1;
+    const char* best = FIELD(0);
+    for (int i = 1; i < count; i++) {
+        if (compare_text(column, FIELD(i), best, overflow) * sign > 0) best = FIELD(i);
+    }
+    if (state->count == 0 || compare_text(column, best, state->text_best, overflow) * sign > 0) {
+        memcpy(state->text_best, best, column->width);
+    }
+}
+
+void aggregation_add(Aggregation* aggregation, const char* rows, int row_size,
+                     const uint16_t* selection, int count, const char* overflow) {
+    if (count == 0) return;
+    if (aggregation->groups) {
+        group_table_add(aggregation->groups, rows, row_size, selection, count, overflow);
+        return;
+    }
+    const AggregatePlan* plan = aggregation->plan;
+    for (int a = 0; a < plan->count; a++) {
+        const AggregateSpec* spec = &plan->specs[a];
+        AggregateState* state = &aggregation->states[a];
+        if (spec->function != AGG_COUNT) {
+            switch (spec->source.type) {
+                case TYPE_INT:
+                case TYPE_DATE:
+                    fold_int(spec, state, rows, row_size, selection, count);
+                    break;
+                case TYPE_DOUBLE:
+                    fold_double(spec, state, rows, row_size, selection, count);
+                    break;
+                case TYPE_VARCHAR:
+                    fold_text(spec, state, rows, row_size, selection, count, overflow);
+                    break;
+                default:
+                    break;
+            }
+        }
+        state->count += count;
+    }
+}
+
+void aggregation_add_count(Aggregation* aggregation, long long rows) {
+    for (int a = 0; a < aggregation->plan->count; a++) {
+        aggregation->states[a].count += rows;
+    }
+}
+
+/* State of aggregate a for the i-th folded row's group */
+#define GROUP_STATE(i) ((AggregateState*)(groups + group_ids[i] * stride) + a)
+
+void aggregate_fold_groups(const AggregatePlan* plan, char* groups, size_t stride,
+                           const uint32_t* group_ids, const char* rows, int row_size,
+                           const uint16_t* selection, int count, const char* overflow) {
+    for (int a = 0; a < plan->count; a++) {
+        const AggregateSpec* spec = &plan->specs[a];
+        const ColumnSchema* column = &spec->source;
+        int offset = column->offset;
+        int min = spec->function == AGG_MIN;
+
+        if (spec->function == AGG_COUNT) {
+            for (int i = 0; i < count; i++) {
+                GROUP_STATE(i)->count++;
+            }
+        } else if (column->type == TYPE_DOUBLE) {
+            for (int i = 0; i < count; i++) {
+                AggregateState* state = GROUP_STATE(i);
+                double value;
+                memcpy(&value, FIELD(i), sizeof(double));
+                if (spec->function == AGG_SUM || spec->function == AGG_AVG) {
+                    state->double_sum += value;
+                } else if (state->count == 0 || (min ? value < state->double_best : value > state->double_best)) {
+                    state->double_best = value;
+                }
+                state->count++;
+            }
+        } else if (column->type == TYPE_VARCHAR) {
+            for (int i = 0; i < count; i++) {
+                AggregateState* state = GROUP_STATE(i);
+                if (state->count == 0 ||
+                    compare_text(column, FIELD(i), state->text_best, overflow) * (min ? -1 : 1) > 0) {
+                    memcpy(state->text_best, FIELD(i), column->width);
+                }
+                state->count++;
+            }
+        } else {
+            for (int i = 0; i < count; i++) {
+                AggregateState* state = GROUP_STATE(i);
+                int value;
+                memcpy(&value, FIELD(i), sizeof(int));
+                if (spec->function == AGG_SUM || spec->function == AGG_AVG) {
+                    state->int_sum += value;
+                } else if (state->count == 0 || (min ? value < state->int_best : value > state->int_best)) {
+                    state->int_best = value;
+                }
+                state->count++;
+            }
+        }
+    }
+}
+
+/* Order of two states' MIN/MAX values */
+static int compare_best(const ColumnSchema* column, const AggregateState* a, const AggregateState* b,
+                        const char* overflow) {
+    switch (column->type) {
+        case TYPE_DOUBLE:
+            return (a->double_best > b->double_best) - (a->double_best < b->double_best);
+        case TYPE_VARCHAR:
+            return compare_text(column, a->text_best, b->text_best, overflow);
+        default:
+            return (a->int_best > b->int_best) - (a->int_best < b->int_best);
+    }
+}
+
+void aggregate_merge_states(const AggregatePlan* plan, AggregateState* into,
+                            const AggregateState* from, const char* overflow) {
+    for (int a = 0; a < plan->count; a++) {
+        const AggregateSpec* spec = &plan->specs[a];
+        AggregateState* total = &into[a];
+        const AggregateState* part = &from[a];
+        if (part->count == 0) continue;
+
+        if (spec->function == AGG_MIN || spec->function == AGG_MAX) {
+            int sign = spec->function == AGG_MIN ? -1 : 1;
+            if (total->count == 0 || compare_best(&spec->source, part, total, overflow) * sign > 0) {
+                total->int_best = part->int_best;
+                total->double_best = part->double_best;
+                memcpy(total->text_best, part->text_best, sizeof(total->text_best));
+            }
+        }
+        total->count += part->count;
+        total->int_sum += part->int_sum;
+        total->double_sum += part->double_sum;
+    }
+}
+
+void aggregation_merge(Aggregation* into, Aggregation* from, const char* overflow) {
+    if (into->groups) {
+        group_table_merge(into->groups, from->groups, overflow);
+        from->groups = NULL;
+    } else {
+        aggregate_merge_states(into->plan, into->states, from->states, overflow);
+    }
+    aggregation_free(from);
+}
+
+/* Final value of one aggregate */
+static void finish_state(const AggregateSpec* spec, const AggregateState* state, char* dest) {
+    int double_source = spec->source.type == TYPE_DOUBLE;
+    switch (spec->function) {
+        case AGG_COUNT:
+            memcpy(dest, &state->count, sizeof(long long));
+            break;
+        case AGG_SUM:
+            if (double_source) {
+                memcpy(dest, &state->double_sum, sizeof(double));
+            } else {
+                memcpy(dest, &state->int_sum, sizeof(long long));
+            }
+            break;
+        case AGG_AVG: {
+            double sum = double_source ? state->double_sum : (double)state->int_sum;
+            double average = state->count ? sum / state->count : 0;
+            memcpy(dest, &average, sizeof(double));
+            break;
+        }
+        case AGG_MIN:
+        case AGG_MAX:
+            if (state->count == 0) break;   // Zero bytes: 0, 0.00 or ''
+            if (spec->source.type == TYPE_VARCHAR) {
+                memcpy(dest, state->text_best, spec->source.width);
+            } else if (double_source) {
+                memcpy(dest, &state->double_best, sizeof(double));
+            } else {
+                memcpy(dest, &state->int_best, sizeof(int));
+            }
+            break;
+    }
+}
+
+void aggregate_result_row(const AggregatePlan* plan, const char* key, const AggregateState* states,
+                          char* row) {
+    memset(row, 0, plan->result.row_size);
+    for (int i = 0; i < plan->result.column_count; i++) {
+        const ColumnSchema* column = &plan->result.columns[i];
+        int output = plan->outputs[i];
+        if (output >= 0) {
+            finish_state(&plan->specs[output], &states[output], row + column->offset);
+        } else {
+            const AggregateKey* group = &plan->keys[-1 - output];
+            memcpy(row + column->offset, key + group->offset, column->width);
+        }
+    }
+}
+
+void aggregation_finish(Aggregation* aggregation, const char* overflow, AggregateEmit emit,
+                        void* context) {
+    if (aggregation->groups) {
+        group_table_finish(aggregation->groups, overflow, emit, context);
+        return;
+    }
+    char* row = malloc(aggregation->plan->result.row_size);
+    aggregate_result_row(aggregation->plan, NULL, aggregation->states, row);
+    emit(context, row);
+    free(row);
+}
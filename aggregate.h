@@ -0,0 +1,148 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include <stdint.h>
+#include "ast.h"
+#include "executor.h"
+
+/* =======================
+   AGGREGATE FUNCTIONS
+   ======================= */
+
+/*
+ * SELECT COUNT(*), COUNT(col), SUM(col), MIN(col), MAX(col), AVG(col)
+ * returns a single row computed inside the engine. The scan hands the
+ * rows its WHERE clause selected to the result sink a block at a time
+ * (result_rows), and a sink carrying an Aggregation folds each block
+ * into running states with one tight loop per function and column type,
+ * reading the stored int, double and varchar bytes directly. Parallel
+ * workers fold into private states that are merged when the scan ends.
+ * Without a WHERE clause, a statement of only COUNTs is answered from
+ * the table's row count header and reads no rows at all.
+ *
+ * With GROUP BY, or SELECT DISTINCT (grouping on every selected column
+ * with no aggregates), the states live per group in a hash table keyed
+ * on the group columns' stored bytes (group.h), and the result has one
+ * row per group, in no particular order. Plain columns in the select
+ * list must then be GROUP BY columns.
+ *
+ * The result has one column per select-list entry: COUNT is a BIGINT,
+ * SUM of an int or date a BIGINT and of a double a DOUBLE, AVG a DOUBLE,
+ * and MIN and MAX keep their column's type. Columns hold no NULLs, so
+ * COUNT(col) is COUNT(*), and over no rows every aggregate is zero (an
+ * empty string for a varchar MIN or MAX).
+ */
+
+typedef enum {
+    AGG_COUNT,
+    AGG_SUM,
+    AGG_MIN,
+    AGG_MAX,
+    AGG_AVG
+} AggregateFunction;
+
+typedef struct {
+    AggregateFunction function;
+    int column;             // Schema index of the argument, -1 for COUNT(*)
+    ColumnSchema source;    // Copy of the argument column
+} AggregateSpec;
+
+/* A GROUP BY column: its stored bytes form part of the group key */
+typedef struct {
+    int column;             // Schema index
+    ColumnSchema source;    // Copy of the column, offset in the table row
+    int offset;             // Offset inside the key
+} AggregateKey;
+
+typedef struct AggregatePlan {
+    AggregateSpec* specs;
+    int count;
+    AggregateKey* keys;     // GROUP BY or DISTINCT columns, none without
+    int key_count;
+    int key_size;           // Bytes of a group key
+    int key_descriptors;    // Keys include long varchars, compared by text
+    int* outputs;           // Per result column: aggregate index, or -1 - key
+    TableSchema result;     // The result columns, laid out as a row
+    int* result_columns;
+    long* result_offsets;
+} AggregatePlan;
+
+/* Running state of one aggregate */
+typedef struct {
+    long long count;        // Rows folded in
+    long long int_sum;
+    double double_sum;
+    int int_best;           // MIN/MAX so far, by type
+    double double_best;
+    char text_best[VARCHAR_LEGACY_WIDTH];
+} AggregateState;
+
+typedef struct Aggregation {
+    const AggregatePlan* plan;
+    AggregateState* states;     // Without keys: one per aggregate
+    struct GroupTable* groups;  // With keys
+    char db_name[128];          // Where the groups spill
+    size_t budget;              // Memory the groups may hold
+} Aggregation;
+
+/* Whether a SELECT column list calls an aggregate function */
+int has_aggregates(ASTNode* column_list);
+
+/* Resolve the aggregates and group keys of a SELECT against the table
+   schema: group_by is the GROUP BY column list or NULL, distinct is set
+   for SELECT DISTINCT. Returns NULL and prints an error for an unknown
+   column, a plain column that is not grouped on, * next to aggregates,
+   or SUM/AVG of a varchar. */
+AggregatePlan* aggregate_plan(ASTNode* column_list, ASTNode* group_by, int distinct,
+                              TableSchema* schema, Arena* arena);
+
+/* Copy of a plan for a scan that runs outside the engine lock */
+AggregatePlan* aggregate_plan_copy(const AggregatePlan* plan, Arena* arena);
+
+/* Whether the plan is ungrouped COUNTs only, answered by a row count */
+int aggregate_plan_counts_only(const AggregatePlan* plan);
+
+/* Fresh states for a whole result (heap); groups spill into db_name's
+   directory once they hold more than budget bytes */
+Aggregation* aggregation_new(const AggregatePlan* plan, const char* db_name, size_t budget);
+
+/* Private states for one parallel worker, with its share of the budget */
+Aggregation* aggregation_fork(const Aggregation* parent);
+void aggregation_free(Aggregation* aggregation);
+
+/* Fold count rows into the states: the rows at the given positions, or
+   rows [0, count) if selection is NULL. overflow is the table's mapped
+   overflow file, for long varchar keys and MIN/MAX. */
+void aggregation_add(Aggregation* aggregation, const char* rows, int row_size,
+                     const uint16_t* selection, int count, const char* overflow);
+
+/* Count rows without reading them (COUNT-only plans) */
+void aggregation_add_count(Aggregation* aggregation, long long rows);
+
+/* Fold a worker's states into the total, and free them */
+void aggregation_merge(Aggregation* into, Aggregation* from, const char* overflow);
+
+/* Pass each result row (a row of plan->result) to emit */
+typedef void (*AggregateEmit)(void* context, const char* row);
+void aggregation_finish(Aggregation* aggregation, const char* overflow, AggregateEmit emit,
+                        void* context);
+
+/* ============================================
+   STATE OPERATIONS (for the group table)
+   ============================================ */
+
+/* Fold rows into per-group states: the i-th row goes to the states at
+   groups + group_ids[i] * stride, aggregate a's at index a */
+void aggregate_fold_groups(const AggregatePlan* plan, char* groups, size_t stride,
+                           const uint32_t* group_ids, const char* rows, int row_size,
+                           const uint16_t* selection, int count, const char* overflow);
+
+/* Combine two partial states of the same group */
+void aggregate_merge_states(const AggregatePlan* plan, AggregateState* into,
+                            const AggregateState* from, const char* overflow);
+
+/* Build a result row from a group key (NULL without keys) and its states */
+void aggregate_result_row(const AggregatePlan* plan, const char* key, const AggregateState* states,
+                          char* row);
+
+#endif
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+void arena_init(Arena* arena, size_t block_size) {
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+}
+
+static ArenaBlock* new_block(size_t size) {
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + size);
+    if (!block) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    ArenaBlock* block = arena->current;
+    while (!block || block->used + size > block->size) {
+        if (block && block->next) {
+            // Blocks after the current one are free since the last reset
+            block = block->next;
+            block->used = 0;
+            continue;
+        }
+
+        ArenaBlock* fresh = new_block(size > arena->block_size ? size : arena->block_size);
+        if (block) {
+            block->next = fresh;
+        } else {
+            arena->first = fresh;
+        }
+        block = fresh;
+    }
+
+    arena->current = block;
+    void* result = block->data + block->used;
+    block->used += size;
+    return result;
+}
+
+void* arena_calloc(Arena* arena, size_t size) {
+    void* result = arena_alloc(arena, size);
+    memset(result, 0, size);
+    return result;
+}
+
+char* arena_strndup(Arena* arena, const char* text, size_t length) {
+    char* copy = arena_alloc(arena, length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+char* arena_strdup(Arena* arena, const char* text) {
+    return arena_strndup(arena, text, strlen(text));
+}
+
+void arena_reset(Arena* arena) {
+    arena->current = arena->first;
+    if (arena->first) {
+        arena->first->used = 0;
+    }
+}
+
+void arena_free(Arena* arena) {
+    ArenaBlock* block = arena->first;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->first = NULL;
+    arena->current = NULL;
+}
@@ -0,0 +1,50 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* =======================
+   STATEMENT ARENA
+   ======================= */
+
+/*
+ * Bump allocator for memory that lives exactly as long as one statement:
+ * tokens, AST nodes, compiled predicates and executor scratch buffers.
+ * Allocation is a pointer bump inside the current block; arena_reset()
+ * releases everything at once in O(1) and keeps the blocks for the next
+ * statement, so a long session settles at its largest statement's size.
+ */
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 16
+
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size;            // Usable bytes in data
+    size_t used;
+    char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock* first;
+    ArenaBlock* current;
+    size_t block_size;
+} Arena;
+
+void arena_init(Arena* arena, size_t block_size);
+
+/* Allocate size bytes aligned to ARENA_ALIGNMENT; never returns NULL */
+void* arena_alloc(Arena* arena, size_t size);
+void* arena_calloc(Arena* arena, size_t size);
+
+/* Copy a string (or its first length bytes) into the arena */
+char* arena_strdup(Arena* arena, const char* text);
+char* arena_strndup(Arena* arena, const char* text, size_t length);
+
+/* Release everything allocated so far, keeping the blocks */
+void arena_reset(Arena* arena);
+
+/* Return all blocks to the system */
+void arena_free(Arena* arena);
+
+#endif
@@ -1,12 +1,10 @@
 #include "ast.h"
 
-ASTNode* ast_new(ASTNodeType type, const char* value) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+ASTNode* ast_new(Arena* arena, ASTNodeType type, const char* value) {
+    ASTNode* node = arena_alloc(arena, sizeof(ASTNode));
     node->type = type;
-    if (value)
-        strncpy(node->value, value, 63);
-    else
-        node->value[0] = '\0';
+    node->value = value ? value : "";
+    node->param = 0;
     node->left = NULL;
     node->right = NULL;
     return node;
@@ -19,27 +17,32 @@ void print_ast(ASTNode* node, int indent) {
     for (int i = 0; i < indent; i++) printf("  ");
 
     switch (node->type) {
-        case AST_SELECT: printf("SELECT\n"); break;
+        case AST_SELECT: printf("SELECT%s\n", *node->value ? " DISTINCT" : ""); break;
         case AST_INSERT: printf("INSERT\n"); break;
         case AST_CREATE: printf("CREATE\n"); break;
         case AST_SHOW: printf("SHOW\n"); break;
+        case AST_USE: printf("USE\n"); break;
+        case AST_LOAD: printf("LOAD(%s)\n", node->value); break;
+        case AST_PREPARE: printf("PREPARE(%s)\n", node->value); break;
+        case AST_EXECUTE: printf("EXECUTE(%s)\n", node->value); break;
+        case AST_VALUES: printf("VALUES\n"); break;
+        case AST_JOIN: printf("JOIN(%s)\n", node->value); break;
         case AST_WHERE: printf("WHERE\n"); break;
+        case AST_GROUP_BY: printf("GROUP BY\n"); break;
+        case AST_ORDER_BY: printf("ORDER BY\n"); break;
+        case AST_SORT_KEY: printf("SORT KEY(%s)\n", node->value); break;
+        case AST_LIMIT: printf("LIMIT\n"); break;
+        case AST_OFFSET: printf("OFFSET\n"); break;
         case AST_CONDITION: printf("CONDITION\n"); break;
         case AST_STAR: printf("STAR\n"); break;
         case AST_IDENTIFIER: printf("IDENTIFIER(%s)\n", node->value); break;
         case AST_LITERAL_NUMBER: printf("NUMBER(%s)\n", node->value); break;
         case AST_LITERAL_STRING: printf("STRING(%s)\n", node->value); break;
+        case AST_PARAM: printf("PARAM(%d)\n", node->param); break;
+        case AST_AGGREGATE: printf("AGGREGATE(%s)\n", node->value); break;
         case AST_DATATYPE: printf("DATATYPE(%s)\n", node->value); break;
     }
 
     if (node->left) print_ast(node->left, indent + 1);
     if (node->right) print_ast(node->right, indent + 1);
 }
-
-/* Free AST memory recursively */
-void free_ast(ASTNode* node) {
-    if (!node) return;
-    free_ast(node->left);
-    free_ast(node->right);
-    free(node);
-}
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "arena.h"
 
 /* =======================
    AST NODE TYPES
@@ -16,9 +17,21 @@ typedef enum {
     AST_CREATE,
     AST_SHOW,
     AST_USE,
+    AST_LOAD,           // LOAD DATA 'file' INTO table
+    AST_PREPARE,        // PREPARE name AS statement
+    AST_EXECUTE,        // EXECUTE name(values)
+
+    /* Data */
+    AST_VALUES,         // One VALUES (...) tuple
 
     /* Clauses */
-    AST_WHERE,
+    AST_JOIN,           // JOIN table (value) ON left: an AST_CONDITION on two columns
+    AST_WHERE,          // Clauses follow the table name, chained through right
+    AST_GROUP_BY,       // GROUP BY columns in left
+    AST_ORDER_BY,       // ORDER BY: AST_SORT_KEY items in left
+    AST_SORT_KEY,       // Column in left, value "asc" or "desc"
+    AST_LIMIT,          // LIMIT: number or parameter in left
+    AST_OFFSET,         // OFFSET: number or parameter in left
     AST_CONDITION,      // AND/OR conditions
 
     /* Expressions / Columns / Tables */
@@ -26,13 +39,16 @@ typedef enum {
     AST_IDENTIFIER,
     AST_LITERAL_NUMBER,
     AST_LITERAL_STRING,
+    AST_PARAM,          // ? placeholder, numbered in param
+    AST_AGGREGATE,      // count/sum/min/max/avg(left), left is AST_STAR or a column
     AST_DATATYPE         // INT, VARCHAR, DOUBLE, DATE
 } ASTNodeType;
 
-/* AST node structure */
+/* AST node structure; nodes live in the statement arena */
 typedef struct ASTNode {
     ASTNodeType type;
-    char value[64];           // For identifiers or literals
+    const char* value;        // For identifiers or literals, never NULL
+    int param;                // 1-based parameter number for AST_PARAM
     struct ASTNode* left;     // Child node (columns, table, condition)
     struct ASTNode* right;    // Right child or next node
 } ASTNode;
@@ -41,13 +57,11 @@ typedef struct ASTNode {
    AST FUNCTIONS
    ======================= */
 
-/* Create a new AST node */
-ASTNode* ast_new(ASTNodeType type, const char* value);
+/* Create a new AST node in the arena. The value is referenced, not
+   copied: it must live in the same arena (see token_text) or be a literal. */
+ASTNode* ast_new(Arena* arena, ASTNodeType type, const char* value);
 
 /* Print AST recursively */
 void print_ast(ASTNode* node, int indent);
 
-/* Free AST memory recursively */
-void free_ast(ASTNode* node);
-
 #endif
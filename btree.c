@@ -0,0 +1,439 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "btree.h"
+#include "buffer_pool.h"
+
+/* ============================================
+   PAGE I/O
+   ============================================ */
+
+static int compare_entries(BTreeEntry a, BTreeEntry b) {
+    if (a.key != b.key) return a.key < b.key ? -1 : 1;
+    if (a.row_id != b.row_id) return a.row_id < b.row_id ? -1 : 1;
+    return 0;
+}
+
+static void write_header(BTree* tree) {
+    char page[BTREE_PAGE_SIZE] = {0};
+    memcpy(page, &tree->header, sizeof(BTreeHeader));
+    bp_write(tree->file_id, 0, page, BTREE_PAGE_SIZE);
+    tree->header_dirty = 0;
+}
+
+static int read_node(BTree* tree, int page_no, BTreeNode* node) {
+    if (page_no <= 0 || page_no >= tree->header.page_count) {
+        return 0;
+    }
+
+    // Decode straight out of the pinned buffer pool frame
+    char* page = bp_pin(tree->file_id, page_no);
+    if (!page) {
+        return 0;
+    }
+    char* cursor = page;
+    node->page_no = page_no;
+    memcpy(&node->is_leaf, cursor, sizeof(int));
+    cursor += sizeof(int);
+    memcpy(&node->key_count, cursor, sizeof(int));
+    cursor += sizeof(int);
+    memcpy(&node->next_leaf, cursor, sizeof(int));
+    cursor += sizeof(int);
+    memcpy(node->keys, cursor, sizeof(BTreeEntry) * BTREE_MAX_KEYS);
+    cursor += sizeof(BTreeEntry) * BTREE_MAX_KEYS;
+    memcpy(node->children, cursor, sizeof(int) * (BTREE_MAX_KEYS + 1));
+
+    bp_unpin(tree->file_id, page_no, 0);
+
+    // A torn or foreign page must not index past the key arrays
+    return node->key_count >= 0 && node->key_count <= (int)BTREE_MAX_KEYS;
+}
+
+static void write_node(BTree* tree, BTreeNode* node) {
+    char page[BTREE_PAGE_SIZE] = {0};
+    char* cursor = page;
+    memcpy(cursor, &node->is_leaf, sizeof(int));
+    cursor += sizeof(int);
+    memcpy(cursor, &node->key_count, sizeof(int));
+    cursor += sizeof(int);
+    memcpy(cursor, &node->next_leaf, sizeof(int));
+    cursor += sizeof(int);
+    memcpy(cursor, node->keys, sizeof(BTreeEntry) * BTREE_MAX_KEYS);
+    cursor += sizeof(BTreeEntry) * BTREE_MAX_KEYS;
+    memcpy(cursor, node->children, sizeof(int) * (BTREE_MAX_KEYS + 1));
+
+    bp_write(tree->file_id, (long)node->page_no * BTREE_PAGE_SIZE, page, BTREE_PAGE_SIZE);
+}
+
+static BTreeNode* new_node(BTree* tree, int is_leaf) {
+    BTreeNode* node = calloc(1, sizeof(BTreeNode));
+    node->page_no = tree->header.page_count++;
+    node->is_leaf = is_leaf;
+    tree->header_dirty = 1;
+    return node;
+}
+
+/* ============================================
+   OPEN / CREATE / CLOSE
+   ============================================ */
+
+int btree_create(const char* path, int key_column) {
+    int file_id = bp_create(path);
+    if (file_id == -1) {
+        return 0;
+    }
+
+    BTree tree;
+    tree.file_id = file_id;
+    tree.header.magic = BTREE_MAGIC;
+    tree.header.version = BTREE_VERSION;
+    tree.header.page_size = BTREE_PAGE_SIZE;
+    tree.header.page_count = 1;
+    tree.header.key_column = key_column;
+    tree.header.entry_count = 0;
+
+    // Root starts as an empty leaf
+    BTreeNode* root = new_node(&tree, 1);
+    tree.header.root_page = root->page_no;
+    write_node(&tree, root);
+    free(root);
+
+    write_header(&tree);
+    bp_release(file_id);
+    return 1;
+}
+
+BTree* btree_open(const char* path) {
+    int file_id = bp_open(path);
+    if (file_id == -1) {
+        return NULL;
+    }
+
+    BTreeHeader header;
+    if (bp_file_size(file_id) < BTREE_PAGE_SIZE) {
+        bp_release(file_id);
+        return NULL;
+    }
+    bp_read(file_id, 0, &header, sizeof(BTreeHeader));
+    if (header.magic != BTREE_MAGIC ||
+        header.version != BTREE_VERSION ||
+        header.page_size != BTREE_PAGE_SIZE) {
+        bp_release(file_id);
+        return NULL;
+    }
+
+    // Pages past a stale header (written back before it) must not be reused
+    long file_pages = bp_file_size(file_id) / BTREE_PAGE_SIZE;
+    if (file_pages > header.page_count) {
+        header.page_count = (int)file_pages;
+    }
+
+    BTree* tree = malloc(sizeof(BTree));
+    tree->file_id = file_id;
+    tree->header = header;
+    tree->header_dirty = 0;
+    return tree;
+}
+
+void btree_close(BTree* tree) {
+    if (!tree) return;
+    if (tree->header_dirty) {
+        write_header(tree);
+    }
+    bp_release(tree->file_id);
+    free(tree);
+}
+
+/* ============================================
+   INSERT
+   ============================================ */
+
+/* Insert into the subtree rooted at page_no. Returns 1 if the node split,
+   in which case *promoted is the separator and *new_page its right sibling. */
+static int insert_into(BTree* tree, int page_no, BTreeEntry entry,
+                       BTreeEntry* promoted, int* new_page) {
+    BTreeNode* node = malloc(sizeof(BTreeNode));
+    if (!read_node(tree, page_no, node)) {
+        free(node);
+        return 0;
+    }
+
+    // Position of the first entry greater than the new one
+    int pos = 0;
+    while (pos < node->key_count && compare_entries(node->keys[pos], entry) <= 0) {
+        pos++;
+    }
+
+    BTreeEntry child_promoted;
+    int child_page = 0;
+
+    if (!node->is_leaf) {
+        if (!insert_into(tree, node->children[pos], entry, &child_promoted, &child_page)) {
+            free(node);
+            return 0;  // Child absorbed the entry
+        }
+        entry = child_promoted;
+    }
+
+    if (node->key_count < (int)BTREE_MAX_KEYS) {
+        memmove(&node->keys[pos + 1], &node->keys[pos],
+                sizeof(BTreeEntry) * (node->key_count - pos));
+        node->keys[pos] = entry;
+        if (!node->is_leaf) {
+            memmove(&node->children[pos + 2], &node->children[pos + 1],
+                    sizeof(int) * (node->key_count - pos));
+            node->children[pos + 1] = child_page;
+        }
+        node->key_count++;
+        write_node(tree, node);
+        free(node);
+        return 0;
+    }
+
+    // Node is full: merge into temporary arrays, then split in half
+    int total = node->key_count + 1;
+    BTreeEntry* keys = malloc(sizeof(BTreeEntry) * total);
+    int* children = malloc(sizeof(int) * (total + 1));
+
+    memcpy(keys, node->keys, sizeof(BTreeEntry) * pos);
+    keys[pos] = entry;
+    memcpy(&keys[pos + 1], &node->keys[pos], sizeof(BTreeEntry) * (node->key_count - pos));
+
+    if (!node->is_leaf) {
+        memcpy(children, node->children, sizeof(int) * (pos + 1));
+        children[pos + 1] = child_page;
+        memcpy(&children[pos + 2], &node->children[pos + 1],
+               sizeof(int) * (node->key_count - pos));
+    }
+
+    BTreeNode* sibling = new_node(tree, node->is_leaf);
+    int mid = total / 2;
+
+    if (node->is_leaf) {
+        // Leaves keep every entry; the separator is a copy of the right's first entry
+        node->key_count = mid;
+        memcpy(node->keys, keys, sizeof(BTreeEntry) * mid);
+        sibling->key_count = total - mid;
+        memcpy(sibling->keys, &keys[mid], sizeof(BTreeEntry) * sibling->key_count);
+        *promoted = sibling->keys[0];
+
+        // Splice the new leaf into the chain
+        sibling->next_leaf = node->next_leaf;
+        node->next_leaf = sibling->page_no;
+    } else {
+        // Internal nodes move the middle separator up
+        node->key_count = mid;
+        memcpy(node->keys, keys, sizeof(BTreeEntry) * mid);
+        memcpy(node->children, children, sizeof(int) * (mid + 1));
+        sibling->key_count = total - mid - 1;
+        memcpy(sibling->keys, &keys[mid + 1], sizeof(BTreeEntry) * sibling->key_count);
+        memcpy(sibling->children, &children[mid + 1], sizeof(int) * (sibling->key_count + 1));
+        *promoted = keys[mid];
+    }
+
+    *new_page = sibling->page_no;
+    write_node(tree, node);
+    write_node(tree, sibling);
+
+    free(keys);
+    free(children);
+    free(sibling);
+    free(node);
+    return 1;
+}
+
+int btree_insert(BTree* tree, int key, int row_id) {
+    BTreeEntry entry = { key, row_id };
+    BTreeEntry promoted;
+    int new_page;
+
+    if (insert_into(tree, tree->header.root_page, entry, &promoted, &new_page)) {
+        // Root split: grow the tree by one level
+        BTreeNode* root = new_node(tree, 0);
+        root->key_count = 1;
+        root->keys[0] = promoted;
+        root->children[0] = tree->header.root_page;
+        root->children[1] = new_page;
+        write_node(tree, root);
+        tree->header.root_page = root->page_no;
+        free(root);
+    }
+
+    tree->header.entry_count++;
+    tree->header_dirty = 1;
+    return 1;
+}
+
+/* ============================================
+   SEARCH
+   ============================================ */
+
+void btree_seek(BTree* tree, int low, BTreeCursor* cursor) {
+    BTreeNode* node = malloc(sizeof(BTreeNode));
+    cursor->tree = tree;
+    cursor->leaf = NULL;
+    cursor->pos = 0;
+
+    if (!read_node(tree, tree->header.root_page, node)) {
+        free(node);
+        return;
+    }
+
+    // Descend towards the leftmost entry with key >= low
+    while (!node->is_leaf) {
+        int i = 0;
+        while (i < node->key_count && node->keys[i].key < low) {
+            i++;
+        }
+        if (!read_node(tree, node->children[i], node)) {
+            free(node);
+            return;
+        }
+    }
+
+    cursor->leaf = node;
+    while (cursor->pos < node->key_count && node->keys[cursor->pos].key < low) {
+        cursor->pos++;
+    }
+}
+
+int btree_cursor_next(BTreeCursor* cursor, BTreeEntry* entry) {
+    BTreeNode* leaf = cursor->leaf;
+    if (!leaf) return 0;
+
+    // Step over exhausted (or empty) leaves
+    while (cursor->pos >= leaf->key_count) {
+        if (leaf->next_leaf == 0 || !read_node(cursor->tree, leaf->next_leaf, leaf)) {
+            return 0;
+        }
+        cursor->pos = 0;
+    }
+
+    *entry = leaf->keys[cursor->pos++];
+    return 1;
+}
+
+void btree_cursor_close(BTreeCursor* cursor) {
+    free(cursor->leaf);
+    cursor->leaf = NULL;
+}
+
+int btree_contains(BTree* tree, int key, int row_id) {
+    BTreeCursor cursor;
+    BTreeEntry entry;
+    int found = 0;
+
+    btree_seek(tree, key, &cursor);
+    while (btree_cursor_next(&cursor, &entry) && entry.key == key && entry.row_id <= row_id) {
+        if (entry.row_id == row_id) {
+            found = 1;
+            break;
+        }
+    }
+    btree_cursor_close(&cursor);
+    return found;
+}
+
+int btree_search_range(BTree* tree, int low, int high, int** row_ids) {
+    int* items = NULL;
+    int count = 0;
+    int capacity = 0;
+
+    if (low <= high) {
+        BTreeCursor cursor;
+        BTreeEntry entry;
+        btree_seek(tree, low, &cursor);
+        while (btree_cursor_next(&cursor, &entry) && entry.key <= high) {
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 16;
+                items = realloc(items, sizeof(int) * capacity);
+            }
+            items[count++] = entry.row_id;
+        }
+        btree_cursor_close(&cursor);
+    }
+
+    *row_ids = items;
+    return count;
+}
+
+/* ============================================
+   VALIDATION
+   ============================================ */
+
+typedef struct {
+    BTreeNode* node;        // Scratch node per depth
+    int visited;
+    long entries;
+    int leaf_depth;
+    int leftmost_leaf;
+} ValidateState;
+
+#define BTREE_MAX_DEPTH 32
+
+/* Check a subtree whose entries must lie within [low, high] */
+static int validate_node(BTree* tree, ValidateState* state, int page_no, int depth,
+                         const BTreeEntry* low, const BTreeEntry* high) {
+    if (depth >= BTREE_MAX_DEPTH || ++state->visited > tree->header.page_count) return 0;
+
+    BTreeNode* node = &state->node[depth];
+    if (!read_node(tree, page_no, node)) return 0;
+    if (!node->is_leaf && node->key_count == 0) return 0;
+
+    for (int i = 0; i < node->key_count; i++) {
+        if (i > 0 && compare_entries(node->keys[i - 1], node->keys[i]) >= 0) return 0;
+        if (low && compare_entries(node->keys[i], *low) < 0) return 0;
+        if (high && compare_entries(node->keys[i], *high) > 0) return 0;
+    }
+
+    if (node->is_leaf) {
+        if (state->leaf_depth == -1) {
+            state->leaf_depth = depth;
+            state->leftmost_leaf = page_no;
+        }
+        state->entries += node->key_count;
+        return state->leaf_depth == depth;
+    }
+
+    // Children decode into deeper slots, so this node's separators stay put
+    for (int i = 0; i <= node->key_count; i++) {
+        const BTreeEntry* child_low = i > 0 ? &node->keys[i - 1] : low;
+        const BTreeEntry* child_high = i < node->key_count ? &node->keys[i] : high;
+        if (!validate_node(tree, state, node->children[i], depth + 1, child_low, child_high)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int btree_validate(BTree* tree, long* entry_count) {
+    ValidateState state;
+    state.node = malloc(sizeof(BTreeNode) * BTREE_MAX_DEPTH);
+    state.visited = 0;
+    state.entries = 0;
+    state.leaf_depth = -1;
+    state.leftmost_leaf = 0;
+
+    int valid = validate_node(tree, &state, tree->header.root_page, 0, NULL, NULL);
+
+    // The leaf chain must reach the same entries without looping
+    if (valid) {
+        long chained = 0;
+        int steps = 0;
+        int page_no = state.leftmost_leaf;
+        while (page_no != 0) {
+            if (++steps > tree->header.page_count || !read_node(tree, page_no, &state.node[0]) ||
+                !state.node[0].is_leaf) {
+                valid = 0;
+                break;
+            }
+            chained += state.node[0].key_count;
+            page_no = state.node[0].next_leaf;
+        }
+        if (chained != state.entries) valid = 0;
+    }
+
+    free(state.node);
+    if (entry_count) *entry_count = state.entries;
+    return valid;
+}
@@ -0,0 +1,100 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include "buffer_pool.h"
+
+/* =======================
+   ON-DISK B-TREE INDEX
+   ======================= */
+
+/*
+ * The .idx file is a sequence of fixed-size pages. Page 0 holds the
+ * header, every other page holds one node. Leaves store every
+ * (key, row_id) entry and are chained left to right through next_leaf;
+ * internal nodes store separator entries and child page numbers.
+ * Entries are ordered by key and then row_id, so duplicate keys are
+ * allowed and every entry is unique.
+ */
+
+#define BTREE_PAGE_SIZE PAGE_SIZE
+#define BTREE_MAGIC 0x58444942      /* "BIDX" */
+#define BTREE_VERSION 2
+
+/* Node page: is_leaf, key_count, next_leaf, entries, child page numbers */
+#define BTREE_NODE_HEADER_SIZE (3 * sizeof(int))
+#define BTREE_MAX_KEYS \
+    ((BTREE_PAGE_SIZE - BTREE_NODE_HEADER_SIZE - sizeof(int)) / (sizeof(BTreeEntry) + sizeof(int)))
+
+typedef struct {
+    int key;
+    int row_id;
+} BTreeEntry;
+
+/* Header stored in page 0 */
+typedef struct {
+    int magic;
+    int version;
+    int page_size;
+    int root_page;
+    int page_count;
+    int key_column;     // Schema index of the indexed column
+    int entry_count;
+} BTreeHeader;
+
+/* Decoded node page */
+typedef struct BTreeNode {
+    int page_no;
+    int is_leaf;
+    int key_count;
+    int next_leaf;      // Right sibling leaf, 0 at the end of the chain
+    BTreeEntry keys[BTREE_MAX_KEYS];
+    int children[BTREE_MAX_KEYS + 1];
+} BTreeNode;
+
+/* Open index handle; pages are read and written through the buffer pool */
+typedef struct {
+    int file_id;
+    BTreeHeader header;
+    int header_dirty;
+} BTree;
+
+/* Position inside the leaf chain */
+typedef struct {
+    BTree* tree;
+    BTreeNode* leaf;
+    int pos;
+} BTreeCursor;
+
+/* Create an empty index file keyed on the given schema column */
+int btree_create(const char* path, int key_column);
+
+/* Open an existing index, returns NULL if missing or not a current-format index */
+BTree* btree_open(const char* path);
+
+/* Write back the header and release the handle */
+void btree_close(BTree* tree);
+
+/* Insert a (key, row_id) entry */
+int btree_insert(BTree* tree, int key, int row_id);
+
+/* Position a cursor on the first entry with key >= low */
+void btree_seek(BTree* tree, int low, BTreeCursor* cursor);
+
+/* Fetch the entry under the cursor and advance, returns 0 at the end */
+int btree_cursor_next(BTreeCursor* cursor, BTreeEntry* entry);
+
+void btree_cursor_close(BTreeCursor* cursor);
+
+/* 1 if the exact (key, row_id) entry is present (WAL replay uses this to
+   stay idempotent) */
+int btree_contains(BTree* tree, int key, int row_id);
+
+/* Walk the whole tree checking page numbers, entry order, leaf depth and
+   the leaf chain. Returns 1 if sound and stores the number of entries. */
+int btree_validate(BTree* tree, long* entry_count);
+
+/* Collect row ids whose key lies in [low, high], ordered by (key, row_id).
+   Returns the number of matches; *row_ids must be freed by the caller. */
+int btree_search_range(BTree* tree, int low, int high, int** row_ids);
+
+#endif
@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "buffer_pool.h"
+#include "platform.h"
+
+typedef struct {
+    char path[256];
+    FILE* file;
+    long size;          // Logical size, may run ahead of the file until flushed
+    int in_use;
+    int refs;           // Holders of the id from bp_open/bp_create not yet released
+} PoolFile;
+
+typedef struct {
+    int file_id;        // -1 when the frame is free
+    long page_no;
+    int pin_count;
+    int dirty;
+    int referenced;     // CLOCK second-chance bit
+    int hash_next;      // Next frame in the same hash bucket, -1 at the end
+    char* data;
+} Frame;
+
+static PoolFile files[BUFFER_POOL_MAX_FILES];
+static Frame* frames = NULL;
+static int* buckets = NULL;
+static int frame_count = 0;
+static int bucket_count = 0;
+static int clock_hand = 0;
+static void (*write_hook)(void) = NULL;
+
+/* ============================================
+   SETUP AND PAGE TABLE
+   ============================================ */
+
+static void flush_all_at_exit(void) {
+    bp_flush_all();
+}
+
+static void bp_init(void) {
+    if (frames) return;
+
+    frame_count = BUFFER_POOL_DEFAULT_PAGES;
+    const char* env = getenv("BRANCHDB_BUFFER_PAGES");
+    if (env && atoi(env) > 0) {
+        frame_count = atoi(env);
+    }
+
+    frames = calloc(frame_count, sizeof(Frame));
+    for (int i = 0; i < frame_count; i++) {
+        frames[i].file_id = -1;
+        frames[i].hash_next = -1;
+        frames[i].data = malloc(PAGE_SIZE);
+    }
+
+    bucket_count = frame_count * 2;
+    buckets = malloc(sizeof(int) * bucket_count);
+    for (int i = 0; i < bucket_count; i++) {
+        buckets[i] = -1;
+    }
+
+    // Write dirty pages back on any normal exit: .exit and the exit(1) paths
+    atexit(flush_all_at_exit);
+}
+
+static int bucket_of(int file_id, long page_no) {
+    unsigned long h = (unsigned long)page_no * 2654435761u + (unsigned long)file_id * 40503u;
+    return (int)(h % bucket_count);
+}
+
+static int find_frame(int file_id, long page_no) {
+    int i = buckets[bucket_of(file_id, page_no)];
+    while (i != -1) {
+        if (frames[i].file_id == file_id && frames[i].page_no == page_no) return i;
+        i = frames[i].hash_next;
+    }
+    return -1;
+}
+
+static void unlink_frame(int index) {
+    int* link = &buckets[bucket_of(frames[index].file_id, frames[index].page_no)];
+    while (*link != -1) {
+        if (*link == index) {
+            *link = frames[index].hash_next;
+            break;
+        }
+        link = &frames[*link].hash_next;
+    }
+    frames[index].hash_next = -1;
+}
+
+/* ============================================
+   PAGE I/O
+   ============================================ */
+
+static void write_back(int index) {
+    Frame* frame = &frames[index];
+    PoolFile* pf = &files[frame->file_id];
+    long start = frame->page_no * PAGE_SIZE;
+    long length = pf->size - start;
+    if (length > PAGE_SIZE) length = PAGE_SIZE;
+
+    if (length > 0) {
+        if (write_hook) write_hook();
+        fseek(pf->file, start, SEEK_SET);
+        fwrite(frame->data, 1, length, pf->file);
+    }
+    frame->dirty = 0;
+}
+
+static void load_page(int index) {
+    Frame* frame = &frames[index];
+    PoolFile* pf = &files[frame->file_id];
+    long start = frame->page_no * PAGE_SIZE;
+    size_t got = 0;
+
+    if (start < pf->size) {
+        fseek(pf->file, start, SEEK_SET);
+        got = fread(frame->data, 1, PAGE_SIZE, pf->file);
+    }
+    memset(frame->data + got, 0, PAGE_SIZE - got);
+}
+
+/* Pick a victim with CLOCK, writing it back if dirty */
+static int evict_frame(void) {
+    for (int sweep = 0; sweep < frame_count * 2; sweep++) {
+        int index = clock_hand;
+        clock_hand = (clock_hand + 1) % frame_count;
+        Frame* frame = &frames[index];
+
+        if (frame->file_id == -1) return index;
+        if (frame->pin_count > 0) continue;
+        if (frame->referenced) {
+            frame->referenced = 0;
+            continue;
+        }
+
+        if (frame->dirty) write_back(index);
+        unlink_frame(index);
+        frame->file_id = -1;
+        return index;
+    }
+
+    fprintf(stderr, "Buffer pool exhausted: all pages pinned\n");
+    exit(1);
+}
+
+/* Drop every cached page of a file, writing dirty ones first if asked */
+static void drop_pages(int file_id, int write_dirty) {
+    for (int i = 0; i < frame_count; i++) {
+        if (frames[i].file_id != file_id) continue;
+        if (write_dirty && frames[i].dirty) write_back(i);
+        unlink_frame(i);
+        frames[i].file_id = -1;
+        frames[i].pin_count = 0;
+        frames[i].dirty = 0;
+    }
+}
+
+char* bp_pin(int file_id, long page_no) {
+    int index = find_frame(file_id, page_no);
+    if (index == -1) {
+        index = evict_frame();
+        Frame* frame = &frames[index];
+        frame->file_id = file_id;
+        frame->page_no = page_no;
+        frame->dirty = 0;
+        frame->pin_count = 0;
+        load_page(index);
+
+        int bucket = bucket_of(file_id, page_no);
+        frame->hash_next = buckets[bucket];
+        buckets[bucket] = index;
+    }
+
+    frames[index].pin_count++;
+    frames[index].referenced = 1;
+    return frames[index].data;
+}
+
+void bp_unpin(int file_id, long page_no, int dirty) {
+    int index = find_frame(file_id, page_no);
+    if (index == -1) return;
+    if (frames[index].pin_count > 0) frames[index].pin_count--;
+    if (dirty) frames[index].dirty = 1;
+}
+
+void bp_read(int file_id, long offset, void* buffer, size_t length) {
+    char* out = buffer;
+    while (length > 0) {
+        long page_no = offset / PAGE_SIZE;
+        size_t in_page = offset % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - in_page;
+        if (chunk > length) chunk = length;
+
+        char* page = bp_pin(file_id, page_no);
+        memcpy(out, page + in_page, chunk);
+        bp_unpin(file_id, page_no, 0);
+
+        out += chunk;
+        offset += chunk;
+        length -= chunk;
+    }
+}
+
+void bp_write(int file_id, long offset, const void* buffer, size_t length) {
+    // Grow the logical size first so an eviction mid-write keeps the new bytes
+    if (offset + (long)length > files[file_id].size) {
+        files[file_id].size = offset + length;
+    }
+
+    const char* in = buffer;
+    while (length > 0) {
+        long page_no = offset / PAGE_SIZE;
+        size_t in_page = offset % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - in_page;
+        if (chunk > length) chunk = length;
+
+        char* page = bp_pin(file_id, page_no);
+        memcpy(page + in_page, in, chunk);
+        bp_unpin(file_id, page_no, 1);
+
+        in += chunk;
+        offset += chunk;
+        length -= chunk;
+    }
+}
+
+/* ============================================
+   FILES
+   ============================================ */
+
+static int find_file(const char* path) {
+    for (int i = 0; i < BUFFER_POOL_MAX_FILES; i++) {
+        if (files[i].in_use && strcmp(files[i].path, path) == 0) return i;
+    }
+    return -1;
+}
+
+static void close_file(int file_id, int write_dirty) {
+    drop_pages(file_id, write_dirty);
+    fclose(files[file_id].file);
+    files[file_id].in_use = 0;
+}
+
+/* Find a free slot, closing an idle file if the table is full. A file
+   someone still holds keeps its id: -1 if every file is held. */
+static int free_file_slot(void) {
+    for (int i = 0; i < BUFFER_POOL_MAX_FILES; i++) {
+        if (!files[i].in_use) return i;
+    }
+    for (int i = 0; i < BUFFER_POOL_MAX_FILES; i++) {
+        if (files[i].refs > 0) continue;
+        int pinned = 0;
+        for (int f = 0; f < frame_count; f++) {
+            if (frames[f].file_id == i && frames[f].pin_count > 0) pinned = 1;
+        }
+        if (!pinned) {
+            close_file(i, 1);
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int attach_file(const char* path, const char* mode) {
+    int slot = free_file_slot();
+    if (slot == -1) return -1;
+
+    FILE* file = fopen(path, mode);
+    if (!file) return -1;
+
+    fseek(file, 0, SEEK_END);
+    files[slot].size = ftell(file);
+    files[slot].file = file;
+    files[slot].in_use = 1;
+    files[slot].refs = 1;
+    strncpy(files[slot].path, path, sizeof(files[slot].path) - 1);
+    files[slot].path[sizeof(files[slot].path) - 1] = '\0';
+    return slot;
+}
+
+int bp_open(const char* path) {
+    bp_init();
+    int file_id = find_file(path);
+    if (file_id != -1) {
+        files[file_id].refs++;
+        return file_id;
+    }
+    return attach_file(path, "r+b");
+}
+
+int bp_create(const char* path) {
+    bp_init();
+    int file_id = find_file(path);
+    if (file_id == -1) return attach_file(path, "w+b");
+
+    // Truncate in place: other holders keep a valid id for the new file
+    PoolFile* pf = &files[file_id];
+    drop_pages(file_id, 0);
+    pf->file = freopen(path, "w+b", pf->file);
+    if (!pf->file) {
+        pf->in_use = 0;
+        pf->refs = 0;
+        return -1;
+    }
+    pf->size = 0;
+    pf->refs++;
+    return file_id;
+}
+
+void bp_release(int file_id) {
+    if (file_id < 0 || !files[file_id].in_use) return;
+    if (files[file_id].refs > 0) files[file_id].refs--;
+}
+
+void bp_close_path(const char* path) {
+    if (!frames) return;
+    int file_id = find_file(path);
+    if (file_id != -1) close_file(file_id, 1);
+}
+
+long bp_file_size(int file_id) {
+    return files[file_id].size;
+}
+
+void bp_flush(int file_id) {
+    for (int i = 0; i < frame_count; i++) {
+        if (frames[i].file_id == file_id && frames[i].dirty) write_back(i);
+    }
+    fflush(files[file_id].file);
+}
+
+void bp_flush_all(void) {
+    for (int i = 0; i < frame_count; i++) {
+        if (frames[i].file_id != -1 && frames[i].dirty) write_back(i);
+    }
+    for (int i = 0; i < BUFFER_POOL_MAX_FILES; i++) {
+        if (files[i].in_use) fflush(files[i].file);
+    }
+}
+
+void bp_sync_all(void) {
+    if (!frames) return;
+    bp_flush_all();
+    for (int i = 0; i < BUFFER_POOL_MAX_FILES; i++) {
+        if (files[i].in_use) file_sync(files[i].file);
+    }
+}
+
+void bp_set_write_hook(void (*hook)(void)) {
+    write_hook = hook;
+}
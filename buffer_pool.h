@@ -0,0 +1,60 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+
+/* =======================
+   BUFFER POOL
+   ======================= */
+
+/*
+ * Shared cache of fixed-size pages for .table and .idx files. Files stay
+ * open across statements and are addressed by a small integer id. Pages
+ * are pinned while in use, evicted with the CLOCK algorithm, and dirty
+ * pages are written back on eviction or by an explicit flush.
+ *
+ * Each bp_open/bp_create hands out a reference that bp_release returns.
+ * When all BUFFER_POOL_MAX_FILES slots are taken, a file nobody holds is
+ * closed to make room; a held file keeps its id until it is released.
+ */
+
+#define PAGE_SIZE 4096
+#define BUFFER_POOL_DEFAULT_PAGES 2048      // 8 MB
+#define BUFFER_POOL_MAX_FILES 64
+
+/* Open (or reuse) a file in the pool, returns a file id or -1 if it
+   cannot be opened or every slot is held */
+int bp_open(const char* path);
+
+/* Create or truncate a file, dropping any of its cached pages */
+int bp_create(const char* path);
+
+/* Done with an id from bp_open/bp_create; the file stays cached */
+void bp_release(int file_id);
+
+/* Flush and close a file by path, dropping its cached pages (before DROP) */
+void bp_close_path(const char* path);
+
+/* Logical size of the file in bytes */
+long bp_file_size(int file_id);
+
+/* Pin a page and return its frame; pages past the end read as zeros */
+char* bp_pin(int file_id, long page_no);
+void bp_unpin(int file_id, long page_no, int dirty);
+
+/* Copy bytes in or out through the pool; ranges may span pages */
+void bp_read(int file_id, long offset, void* buffer, size_t length);
+void bp_write(int file_id, long offset, const void* buffer, size_t length);
+
+/* Write back dirty pages; pages stay cached */
+void bp_flush(int file_id);
+void bp_flush_all(void);
+
+/* Write back every dirty page and force all pool files to disk */
+void bp_sync_all(void);
+
+/* Called before any dirty page reaches its file; the write-ahead log uses
+   this to make its records durable ahead of the pages they describe */
+void bp_set_write_hook(void (*hook)(void));
+
+#endif
@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <string.h>
+#include "catalog.h"
+
+typedef struct CatalogEntry {
+    char db_name[128];
+    char table_name[64];
+    TableSchema* schema;
+    struct CatalogEntry* next;
+} CatalogEntry;
+
+static CatalogEntry* buckets[CATALOG_BUCKETS];
+static unsigned int version;
+
+static unsigned int catalog_hash(const char* db_name, const char* table_name) {
+    unsigned int hash = 2166136261u;  // FNV-1a over "db/table"
+    for (const char* p = db_name; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    hash = (hash ^ '/') * 16777619u;
+    for (const char* p = table_name; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    return hash % CATALOG_BUCKETS;
+}
+
+TableSchema* catalog_get(const char* db_name, const char* table_name) {
+    unsigned int bucket = catalog_hash(db_name, table_name);
+    for (CatalogEntry* entry = buckets[bucket]; entry; entry = entry->next) {
+        if (strcmp(entry->db_name, db_name) == 0 && strcmp(entry->table_name, table_name) == 0) {
+            return entry->schema;
+        }
+    }
+
+    // Miss: parse the .schema file once and keep it
+    TableSchema* schema = read_schema(db_name, table_name);
+    if (!schema) {
+        return NULL;
+    }
+
+    CatalogEntry* entry = malloc(sizeof(CatalogEntry));
+    strncpy(entry->db_name, db_name, sizeof(entry->db_name) - 1);
+    entry->db_name[sizeof(entry->db_name) - 1] = '\0';
+    strncpy(entry->table_name, table_name, sizeof(entry->table_name) - 1);
+    entry->table_name[sizeof(entry->table_name) - 1] = '\0';
+    entry->schema = schema;
+    entry->next = buckets[bucket];
+    buckets[bucket] = entry;
+    return schema;
+}
+
+unsigned int catalog_version(void) {
+    return version;
+}
+
+void catalog_invalidate(const char* db_name, const char* table_name) {
+    version++;
+    CatalogEntry** link = &buckets[catalog_hash(db_name, table_name)];
+    while (*link) {
+        CatalogEntry* entry = *link;
+        if (strcmp(entry->db_name, db_name) == 0 && strcmp(entry->table_name, table_name) == 0) {
+            *link = entry->next;
+            free_schema(entry->schema);
+            free(entry);
+        } else {
+            link = &entry->next;
+        }
+    }
+}
+
+void catalog_invalidate_database(const char* db_name) {
+    version++;
+    for (int i = 0; i < CATALOG_BUCKETS; i++) {
+        CatalogEntry** link = &buckets[i];
+        while (*link) {
+            CatalogEntry* entry = *link;
+            if (strcmp(entry->db_name, db_name) == 0) {
+                *link = entry->next;
+                free_schema(entry->schema);
+                free(entry);
+            } else {
+                link = &entry->next;
+            }
+        }
+    }
+}
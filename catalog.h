@@ -0,0 +1,31 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "executor.h"
+
+/* =======================
+   SCHEMA CATALOG CACHE
+   ======================= */
+
+/*
+ * Process-wide cache of parsed table schemas keyed by (database, table).
+ * A schema is read from its .schema file once, with each column's type
+ * enum, byte offset and width resolved, and is then shared by every
+ * statement until CREATE or DROP invalidates it. Returned schemas are
+ * owned by the catalog; callers must not free them.
+ */
+
+#define CATALOG_BUCKETS 128
+
+/* Cached schema for a table, or NULL if the table does not exist */
+TableSchema* catalog_get(const char* db_name, const char* table_name);
+
+/* Forget one table (CREATE/DROP TABLE) or every table of a database */
+void catalog_invalidate(const char* db_name, const char* table_name);
+void catalog_invalidate_database(const char* db_name);
+
+/* Bumped by every invalidation; anything holding a schema pointer across
+   statements compares it to know the pointer may be stale */
+unsigned int catalog_version(void);
+
+#endif
@@ -0,0 +1,65 @@
+#include <stdlib.h>
+#include <string.h>
+#include "client.h"
+#include "net.h"
+
+struct BranchClient {
+    Socket socket;
+    char* output;
+    size_t capacity;
+};
+
+static void reserve(BranchClient* client, size_t size) {
+    if (size > client->capacity) {
+        client->capacity = size;
+        client->output = realloc(client->output, client->capacity);
+    }
+}
+
+BranchClient* branch_connect(const char* host, int port) {
+    if (!net_init()) return NULL;
+    Socket socket = net_connect(host, port);
+    if (socket == NET_INVALID) return NULL;
+
+    BranchClient* client = calloc(1, sizeof(BranchClient));
+    client->socket = socket;
+    return client;
+}
+
+int branch_query(BranchClient* client, const char* statement, const char** output, size_t* length) {
+    // One write for the length and the text, so it goes out as one packet
+    size_t size = strlen(statement);
+    reserve(client, size + 4);
+    net_put_u32((unsigned char*)client->output, (uint32_t)size);
+    memcpy(client->output + 4, statement, size);
+    if (!net_send_all(client->socket, client->output, size + 4)) {
+        return -1;
+    }
+
+    unsigned char header[RESPONSE_HEADER_SIZE];
+    if (!net_recv_all(client->socket, header, RESPONSE_HEADER_SIZE)) {
+        return -1;
+    }
+    uint32_t response_length = net_get_u32(header);
+    if (response_length < 1) {
+        return -1;
+    }
+
+    size_t output_length = response_length - 1;
+    reserve(client, output_length + 1);
+    if (!net_recv_all(client->socket, client->output, output_length)) {
+        return -1;
+    }
+    client->output[output_length] = '\0';
+
+    *output = client->output;
+    *length = output_length;
+    return header[4];
+}
+
+void branch_close(BranchClient* client) {
+    if (!client) return;
+    net_close(client->socket);
+    free(client->output);
+    free(client);
+}
@@ -0,0 +1,37 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <stddef.h>
+
+/* =======================
+   CLIENT LIBRARY
+   ======================= */
+
+/*
+ * Talks to branchdb-server. A connection is one session: USE, PREPARE and
+ * .mode apply to later statements on the same connection only.
+ *
+ *   BranchClient* client = branch_connect(NULL, NET_DEFAULT_PORT);
+ *   const char* output;
+ *   size_t length;
+ *   branch_query(client, "USE shop", &output, &length);
+ *   branch_query(client, "SELECT * FROM items", &output, &length);
+ *   branch_close(client);
+ *
+ * The output is exactly what the statement would have printed in the
+ * REPL, in the session's output mode.
+ */
+
+typedef struct BranchClient BranchClient;
+
+/* Connect to host:port (NULL host is loopback); NULL on failure */
+BranchClient* branch_connect(const char* host, int port);
+
+/* Run one statement or meta-command. Returns STATUS_OK, STATUS_ERROR if
+   the server could not run it, or -1 if the connection failed. The output
+   stays valid until the next call on this client. */
+int branch_query(BranchClient* client, const char* statement, const char** output, size_t* length);
+
+void branch_close(BranchClient* client);
+
+#endif
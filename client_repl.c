@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "client.h"
+#include "input_buffer.h"
+#include "net.h"
+
+/* =======================
+   BRANCHDB CLIENT
+   ======================= */
+
+/* branchdb-client [-h host] [-p port]: the REPL, against a server */
+
+int main(int argc, char* argv[]) {
+    const char* host = NULL;
+    int port = NET_DEFAULT_PORT;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) {
+            host = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else {
+            printf("Usage: %s [-h host] [-p port]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    BranchClient* client = branch_connect(host, port);
+    if (!client) {
+        printf("Cannot connect to %s:%d\n", host ? host : "127.0.0.1", port);
+        return 1;
+    }
+
+    InputBuffer* input_buffer = new_input_buffer();
+    while (1) {
+        printf("branchdb > ");
+        if (!read_input(input_buffer)) {
+            printf("\n");
+            break;
+        }
+
+        const char* output;
+        size_t length;
+        if (branch_query(client, input_buffer->buffer, &output, &length) < 0) {
+            printf("Connection to server lost\n");
+            break;
+        }
+        fwrite(output, 1, length, stdout);
+        if (strcmp(input_buffer->buffer, ".exit") == 0) {
+            break;
+        }
+    }
+
+    close_input_buffer(input_buffer);
+    branch_close(client);
+    return 0;
+}
@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+#include "column_store.h"
+#include "buffer_pool.h"
+#include "filter.h"
+#include "output.h"
+
+void column_file_path(char* path, size_t size, const char* db_name, const char* table_name,
+                      int column) {
+    if (column < 0) {
+        snprintf(path, size, "databases\\%s\\%s.table", db_name, table_name);
+    } else {
+        snprintf(path, size, "databases\\%s\\%s.%d.col", db_name, table_name, column);
+    }
+}
+
+void create_column_files(const char* db_name, const char* table_name, TableSchema* schema) {
+    char column_path[256];
+    for (int i = 0; i < schema->column_count; i++) {
+        column_file_path(column_path, sizeof(column_path), db_name, table_name, i);
+        int column_file = bp_create(column_path);
+        if (column_file == -1) {
+            out_perror("Failed to create column file");
+            return;
+        }
+        ColumnFileHeader header = { COLUMN_FILE_HEADER_SIZE, 0, 0 };
+        bp_write(column_file, 0, &header, sizeof(header));
+        bp_release(column_file);
+    }
+    out_printf("Column files created: %d in databases\\%s\n", schema->column_count, db_name);
+}
+
+void delete_column_files(const char* db_name, const char* table_name, int column_count) {
+    char column_path[256];
+    for (int i = 0; i < column_count; i++) {
+        column_file_path(column_path, sizeof(column_path), db_name, table_name, i);
+        table_unmap(column_path);
+        bp_close_path(column_path);
+        DeleteFile(column_path);
+    }
+}
+
+/* ============================================
+   APPENDING
+   ============================================ */
+
+static void add_write(ColumnWrites* writes, int column, long offset, char* data, size_t length) {
+    if (writes->count == writes->capacity) {
+        writes->capacity = writes->capacity ? writes->capacity * 2 : 16;
+        writes->writes = realloc(writes->writes, sizeof(ColumnWrite) * writes->capacity);
+    }
+    ColumnWrite* write = &writes->writes[writes->count++];
+    write->column = column;
+    write->offset = offset;
+    write->length = (uint32_t)length;
+    write->data = data;
+}
+
+static char* copy_bytes(const void* data, size_t length) {
+    char* copy = malloc(length);
+    memcpy(copy, data, length);
+    return copy;
+}
+
+/* Header of a raw segment that is still taking values */
+static void open_segment_header(char* out, int width, uint32_t count) {
+    SegmentHeader header = { ENCODING_RAW, 0, (uint16_t)width, count, 0, count * (uint32_t)width, 0 };
+    memcpy(out, &header, sizeof(header));
+}
+
+/* One column's share of an append */
+static void plan_column(int column_file, int index, const ColumnSchema* column, const char* rows,
+                        int row_size, int count, ColumnWrites* writes) {
+    int width = column->width;
+    ColumnFileHeader header;
+    bp_read(column_file, 0, &header, sizeof(header));
+
+    uint32_t open_count = header.rows % SEGMENT_ROWS;
+    long open_offset = open_count ? (long)header.used - SEGMENT_HEADER_SIZE - (long)open_count * width
+                                  : (long)header.used;
+
+    if (open_count + count < SEGMENT_ROWS) {
+        // The open segment takes every value: append them and bump its header
+        char* values = malloc((size_t)count * width);
+        for (int i = 0; i < count; i++) {
+            memcpy(values + (size_t)i * width, rows + (long)i * row_size + column->offset, width);
+        }
+        char* segment_header = malloc(SEGMENT_HEADER_SIZE);
+        open_segment_header(segment_header, width, open_count + count);
+        add_write(writes, index, open_offset, segment_header, SEGMENT_HEADER_SIZE);
+        add_write(writes, index, open_offset + SEGMENT_HEADER_SIZE + (long)open_count * width,
+                  values, (size_t)count * width);
+        header.used = open_offset + SEGMENT_HEADER_SIZE + (uint64_t)(open_count + count) * width;
+    } else {
+        // The open segment fills up: encode every full segment over it and
+        // start a new open segment with what is left
+        uint32_t total = open_count + count;
+        char* values = malloc((size_t)total * width);
+        bp_read(column_file, open_offset + SEGMENT_HEADER_SIZE, values, (size_t)open_count * width);
+        for (int i = 0; i < count; i++) {
+            memcpy(values + (size_t)(open_count + i) * width, rows + (long)i * row_size + column->offset,
+                   width);
+        }
+
+        uint32_t full = total / SEGMENT_ROWS;
+        uint32_t left = total % SEGMENT_ROWS;
+        size_t bound = full * segment_bound(width, SEGMENT_ROWS) + segment_bound(width, left);
+        char* out = malloc(bound);
+        size_t length = 0;
+        for (uint32_t s = 0; s < full; s++) {
+            length += segment_encode(column->type, width, column->overflow,
+                                     values + (size_t)s * SEGMENT_ROWS * width, SEGMENT_ROWS, out + length);
+        }
+        if (left > 0) {
+            open_segment_header(out + length, width, left);
+            memcpy(out + length + SEGMENT_HEADER_SIZE, values + (size_t)full * SEGMENT_ROWS * width,
+                   (size_t)left * width);
+            length += SEGMENT_HEADER_SIZE + (size_t)left * width;
+        }
+        free(values);
+        add_write(writes, index, open_offset, out, length);
+        header.used = open_offset + length;
+    }
+
+    header.rows += count;
+    add_write(writes, index, 0, copy_bytes(&header, sizeof(header)), sizeof(header));
+}
+
+void column_plan_append(const char* db_name, const char* table_name, TableSchema* schema,
+                        int row_count, const char* rows, int count, ColumnWrites* writes) {
+    char column_path[256];
+    for (int i = 0; i < schema->column_count; i++) {
+        column_file_path(column_path, sizeof(column_path), db_name, table_name, i);
+        int column_file = bp_open(column_path);
+        if (column_file == -1) {
+            out_perror("Failed to open column file");
+            continue;
+        }
+        plan_column(column_file, i, &schema->columns[i], rows, schema->row_size, count, writes);
+        bp_release(column_file);
+    }
+
+    // The row count goes last, once every column holds the rows
+    int new_count = row_count + count;
+    add_write(writes, -1, 0, copy_bytes(&new_count, sizeof(int)), sizeof(int));
+}
+
+void column_apply_writes(const char* db_name, const char* table_name, ColumnWrites* writes) {
+    char path[256];
+    for (int i = 0; i < writes->count; i++) {
+        ColumnWrite* write = &writes->writes[i];
+        column_file_path(path, sizeof(path), db_name, table_name, write->column);
+        int file = bp_open(path);
+        if (file != -1) {
+            bp_write(file, write->offset, write->data, write->length);
+            bp_release(file);
+        }
+        free(write->data);
+    }
+    free(writes->writes);
+    memset(writes, 0, sizeof(*writes));
+}
+
+/* ============================================
+   SCANNING
+   ============================================ */
+
+int column_scan_open(ColumnScan* scan, const char* db_name, const char* table_name,
+                     TableSchema* schema, const char* needed, int row_count, Arena* arena) {
+    scan->schema = schema;
+    scan->row_count = row_count;
+    scan->columns = arena_calloc(arena, sizeof(ScannedColumn) * schema->column_count);
+    scan->scratch_size = 0;
+
+    int segment_count = (row_count + SEGMENT_ROWS - 1) / SEGMENT_ROWS;
+    char column_path[256];
+    for (int i = 0; i < schema->column_count; i++) {
+        if (!needed[i]) continue;
+
+        column_file_path(column_path, sizeof(column_path), db_name, table_name, i);
+        int column_file = bp_open(column_path);
+        if (column_file == -1) {
+            column_scan_close(scan);
+            return 0;
+        }
+        ColumnFileHeader header;
+        bp_read(column_file, 0, &header, sizeof(header));
+        bp_flush(column_file);
+        bp_release(column_file);
+
+        ScannedColumn* column = &scan->columns[i];
+        column->map = table_map(column_path, (long)header.used);
+        if (!column->map) {
+            column_scan_close(scan);
+            return 0;
+        }
+
+        // Segment sizes vary with their encoding: walk the headers once
+        column->segments = arena_alloc(arena, sizeof(long) * (segment_count + 1));
+        long offset = COLUMN_FILE_HEADER_SIZE;
+        for (int s = 0; s < segment_count; s++) {
+            if (offset + SEGMENT_HEADER_SIZE > column->map->size) {
+                column_scan_close(scan);
+                return 0;
+            }
+            column->segments[s] = offset;
+            offset += (long)segment_size(column->map->data + offset);
+        }
+
+        int scratch = FILTER_BATCH_SIZE * schema->columns[i].width;
+        if (scratch > scan->scratch_size) scan->scratch_size = scratch;
+    }
+    return 1;
+}
+
+void column_scan_close(ColumnScan* scan) {
+    for (int i = 0; i < scan->schema->column_count; i++) {
+        table_release(scan->columns[i].map);
+        scan->columns[i].map = NULL;
+    }
+}
+
+static const char* segment_of(const ScannedColumn* column, int row) {
+    return column->map->data + column->segments[row / SEGMENT_ROWS];
+}
+
+static void column_bitmap(const ColumnScan* scan, const Predicate* p, int start, int count,
+                          uint64_t* bits) {
+    switch (p->kind) {
+        case PRED_AND:
+        case PRED_OR: {
+            uint64_t other[FILTER_BITMAP_WORDS];
+            column_bitmap(scan, p->left, start, count, bits);
+            column_bitmap(scan, p->right, start, count, other);
+            for (int w = 0; w < FILTER_BITMAP_WORDS; w++) {
+                bits[w] = p->kind == PRED_AND ? bits[w] & other[w] : bits[w] | other[w];
+            }
+            return;
+        }
+        case PRED_FALSE:
+            memset(bits, 0, sizeof(uint64_t) * FILTER_BITMAP_WORDS);
+            return;
+        case PRED_COMPARE:
+            segment_filter(segment_of(&scan->columns[p->column], start), p, start % SEGMENT_ROWS, count,
+                           bits);
+            return;
+    }
+}
+
+int column_scan_filter(const ColumnScan* scan, const Predicate* predicate, int start, int count,
+                       uint16_t* selection) {
+    uint64_t bits[FILTER_BITMAP_WORDS];
+    column_bitmap(scan, predicate, start, count, bits);
+
+    int selected = 0;
+    for (int w = 0; w < FILTER_BITMAP_WORDS; w++) {
+        uint64_t word = bits[w];
+        while (word) {
+            int position = w * 64 + __builtin_ctzll(word);
+            if (position >= count) return selected;
+            selection[selected++] = (uint16_t)position;
+            word &= word - 1;
+        }
+    }
+    return selected;
+}
+
+void column_scan_rows(const ColumnScan* scan, int start, int count, const uint16_t* selection,
+                      int selected, char* rows, char* scratch) {
+    int row_size = scan->schema->row_size;
+    uint32_t first = start % SEGMENT_ROWS;
+    for (int c = 0; c < scan->schema->column_count; c++) {
+        const ScannedColumn* column = &scan->columns[c];
+        if (!column->map) continue;
+        const char* segment = segment_of(column, start);
+        int width = scan->schema->columns[c].width;
+        int offset = scan->schema->columns[c].offset;
+
+        if (selection && selected * 4 < count) {
+            // Few matches: decode just their values
+            for (int i = 0; i < selected; i++) {
+                segment_decode(segment, first + selection[i], 1, rows + (long)i * row_size + offset);
+            }
+            continue;
+        }
+        segment_decode(segment, first, count, scratch);
+        for (int i = 0; i < selected; i++) {
+            int position = selection ? selection[i] : i;
+            memcpy(rows + (long)i * row_size + offset, scratch + (long)position * width, width);
+        }
+    }
+}
+
+void column_scan_fetch(const ColumnScan* scan, int row_id, char* row) {
+    for (int c = 0; c < scan->schema->column_count; c++) {
+        const ScannedColumn* column = &scan->columns[c];
+        if (column->map) {
+            segment_decode(segment_of(column, row_id), row_id % SEGMENT_ROWS, 1,
+                           row + scan->schema->columns[c].offset);
+        }
+    }
+}
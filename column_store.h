@@ -0,0 +1,120 @@
+#ifndef COLUMN_STORE_H
+#define COLUMN_STORE_H
+
+#include <stdint.h>
+#include "executor.h"
+#include "encoding.h"
+#include "table_map.h"
+#include "predicate.h"
+#include "buffer_pool.h"
+
+/* =======================
+   COLUMN STORAGE
+   ======================= */
+
+/*
+ * A table created with STORAGE = COLUMN keeps each column in its own file,
+ * <table>.<n>.col for the n-th column, next to the usual .schema and .idx
+ * files; its .table file holds only the row count header. A column file
+ * is a ColumnFileHeader followed by encoded segments of SEGMENT_ROWS
+ * values (see encoding.h), the last of which may be a raw, open segment
+ * that collects new values until it is full and is then encoded in place.
+ * Segments start on the same row in every column, so row i of the table
+ * is value i of each column file.
+ *
+ * An append is planned as a list of byte-range writes to the column
+ * files, which the appender logs to the WAL and applies once its batch
+ * has committed; recovery replays them like any other page image. A scan
+ * maps only the columns the statement references, evaluates the WHERE
+ * clause on the encoded segments and stitches the values of the selected
+ * rows back into fixed-width rows by position, so predicates and the
+ * result sink work on them unchanged.
+ */
+
+typedef struct {
+    uint64_t used;          // Bytes in use, header included
+    uint32_t rows;          // Values stored
+    uint32_t reserved;
+} ColumnFileHeader;
+
+#define COLUMN_FILE_HEADER_SIZE ((long)sizeof(ColumnFileHeader))
+
+/* Column files share the buffer pool's file slots with the table's .table,
+   .ovf and .idx files, so a column table has at most this many columns */
+#define COLUMN_MAX_COLUMNS (BUFFER_POOL_MAX_FILES - 3)
+
+/* Path of a column file; column -1 names the table's .table file */
+void column_file_path(char* path, size_t size, const char* db_name, const char* table_name,
+                      int column);
+
+/* Create the empty column files of a new table */
+void create_column_files(const char* db_name, const char* table_name, TableSchema* schema);
+
+/* Unmap, close and delete a table's column files (DROP TABLE) */
+void delete_column_files(const char* db_name, const char* table_name, int column_count);
+
+/* ============================================
+   APPENDING
+   ============================================ */
+
+typedef struct {
+    int column;             // Column file, or -1 for the .table file
+    long offset;
+    uint32_t length;
+    char* data;
+} ColumnWrite;
+
+typedef struct {
+    ColumnWrite* writes;
+    int count;
+    int capacity;
+} ColumnWrites;
+
+/* Plan appending count rows (encoded row-major, schema->row_size apart)
+   to every column file, with row_count the rows already stored. Adds the
+   writes to `writes`, including the .table row count header. */
+void column_plan_append(const char* db_name, const char* table_name, TableSchema* schema,
+                        int row_count, const char* rows, int count, ColumnWrites* writes);
+
+/* Apply planned writes through the buffer pool, then free them */
+void column_apply_writes(const char* db_name, const char* table_name, ColumnWrites* writes);
+
+/* ============================================
+   SCANNING
+   ============================================ */
+
+typedef struct {
+    MappedTable* map;       // NULL for a column the scan does not read
+    long* segments;         // Offset of each segment in the mapping
+} ScannedColumn;
+
+typedef struct {
+    TableSchema* schema;
+    int row_count;
+    ScannedColumn* columns; // One per schema column
+    int scratch_size;       // Bytes of scratch space column_scan_rows needs
+} ColumnScan;
+
+/* Map the columns flagged in `needed` (one flag per schema column) with
+   segments covering row_count rows. Returns 0 if a file cannot be mapped. */
+int column_scan_open(ColumnScan* scan, const char* db_name, const char* table_name,
+                     TableSchema* schema, const char* needed, int row_count, Arena* arena);
+
+void column_scan_close(ColumnScan* scan);
+
+/* Evaluate a WHERE clause on rows [start, start + count), a block of at
+   most FILTER_BATCH_SIZE rows inside one segment. Writes the positions of
+   matching rows to selection and returns how many matched. */
+int column_scan_filter(const ColumnScan* scan, const Predicate* predicate, int start, int count,
+                       uint16_t* selection);
+
+/* Stitch the needed columns of block rows into fixed-width rows, one per
+   selected position (or every row if selection is NULL), packed from
+   rows. scratch holds scan->scratch_size bytes. */
+void column_scan_rows(const ColumnScan* scan, int start, int count, const uint16_t* selection,
+                      int selected, char* rows, char* scratch);
+
+/* Stitch one row by id */
+void column_scan_fetch(const ColumnScan* scan, int row_id, char* row);
+
+#endif
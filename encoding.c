@@ -0,0 +1,434 @@
+#include <stdlib.h>
+#include <string.h>
+#include "encoding.h"
+#include "filter.h"
+#include "platform.h"
+
+#define SET_BIT(bits, i) ((bits)[(i) >> 6] |= (uint64_t)1 << ((i) & 63))
+
+/* ============================================
+   BIT PACKING
+   ============================================ */
+
+/* Bytes for count packed values of `bits` bits; one spare word lets
+   unpack() always read the word after the one a value starts in */
+static size_t packed_size(uint32_t count, int bits) {
+    return (((uint64_t)count * bits + 63) / 64) * 8 + 8;
+}
+
+static int bits_for(uint64_t max_value) {
+    return max_value ? 64 - __builtin_clzll(max_value) : 0;
+}
+
+static inline uint64_t load_word(const char* data, uint64_t word) {
+    uint64_t value;
+    memcpy(&value, data + word * 8, sizeof(value));
+    return value;
+}
+
+static inline void store_word(char* data, uint64_t word, uint64_t value) {
+    memcpy(data + word * 8, &value, sizeof(value));
+}
+
+/* data must be zeroed before the first pack() */
+static void pack(char* data, uint32_t index, int bits, uint64_t value) {
+    if (bits == 0) return;
+    uint64_t position = (uint64_t)index * bits;
+    uint64_t word = position >> 6;
+    int shift = (int)(position & 63);
+    store_word(data, word, load_word(data, word) | value << shift);
+    if (shift + bits > 64) {
+        store_word(data, word + 1, load_word(data, word + 1) | value >> (64 - shift));
+    }
+}
+
+static inline uint64_t unpack(const char* data, uint32_t index, int bits) {
+    if (bits == 0) return 0;
+    uint64_t position = (uint64_t)index * bits;
+    uint64_t word = position >> 6;
+    int shift = (int)(position & 63);
+    uint64_t value = load_word(data, word) >> shift;
+    if (shift + bits > 64) {
+        value |= load_word(data, word + 1) << (64 - shift);
+    }
+    return value & (bits == 64 ? ~(uint64_t)0 : ((uint64_t)1 << bits) - 1);
+}
+
+/* Set bit i for every packed value i in [start, start + count) that lies
+   in [low, high] */
+static void packed_in_range(const char* data, int bits, uint32_t start, int count,
+                            uint64_t low, uint64_t high, uint64_t* out) {
+    uint64_t span = high - low;
+    for (int i = 0; i < count; i++) {
+        if (unpack(data, start + i, bits) - low <= span) SET_BIT(out, i);
+    }
+}
+
+/* ============================================
+   VALUE ORDER
+   ============================================ */
+
+/* Dictionaries sort with the same order the predicates compare in. Ties
+   fall back to the bytes, so -0.0 and 0.0 stay distinct entries. */
+static THREAD_LOCAL ColumnType sort_type;
+static THREAD_LOCAL int sort_width;
+
+static int compare_values(const void* a, const void* b) {
+    int cmp = 0;
+    if (sort_type == TYPE_INT || sort_type == TYPE_DATE) {
+        int x, y;
+        memcpy(&x, a, sizeof(int));
+        memcpy(&y, b, sizeof(int));
+        cmp = (x > y) - (x < y);
+    } else if (sort_type == TYPE_DOUBLE) {
+        double x, y;
+        memcpy(&x, a, sizeof(double));
+        memcpy(&y, b, sizeof(double));
+        cmp = (x > y) - (x < y);
+    }
+    return cmp ? cmp : memcmp(a, b, sort_width);
+}
+
+/* Index of value in a sorted dictionary of entry_count entries */
+static uint32_t dictionary_code(const char* entries, uint32_t entry_count, const char* value) {
+    uint32_t low = 0, high = entry_count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (compare_values(entries + (size_t)middle * sort_width, value) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/* ============================================
+   ENCODING
+   ============================================ */
+
+size_t segment_bound(int width, uint32_t count) {
+    return SEGMENT_HEADER_SIZE + (size_t)width * count;
+}
+
+static size_t align8(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+static size_t encode_raw(const char* values, size_t size, char* data) {
+    memcpy(data, values, size);
+    return size;
+}
+
+static size_t encode_rle(const char* values, int width, uint32_t count, uint32_t runs,
+                         char* data) {
+    char* ends = data + (size_t)runs * width;
+    uint32_t run = 0;
+    for (uint32_t i = 1; i <= count; i++) {
+        if (i == count || memcmp(values + (size_t)i * width, values + (size_t)(i - 1) * width, width) != 0) {
+            memcpy(data + (size_t)run * width, values + (size_t)(i - 1) * width, width);
+            memcpy(ends + (size_t)run * sizeof(uint32_t), &i, sizeof(uint32_t));
+            run++;
+        }
+    }
+    return (size_t)runs * (width + sizeof(uint32_t));
+}
+
+static size_t encode_dictionary(const char* values, int width, uint32_t count,
+                                const char* entries, uint32_t entry_count, int bits, char* data) {
+    size_t entries_size = (size_t)entry_count * width;
+    memcpy(data, entries, entries_size);
+    memset(data + entries_size, 0, align8(entries_size) - entries_size);
+
+    char* codes = data + align8(entries_size);
+    size_t codes_size = packed_size(count, bits);
+    memset(codes, 0, codes_size);
+    for (uint32_t i = 0; i < count; i++) {
+        pack(codes, i, bits, dictionary_code(entries, entry_count, values + (size_t)i * width));
+    }
+    return align8(entries_size) + codes_size;
+}
+
+static size_t encode_frame(const char* values, uint32_t count, int64_t base, int bits, char* data) {
+    size_t size = packed_size(count, bits);
+    memset(data, 0, size);
+    for (uint32_t i = 0; i < count; i++) {
+        int value;
+        memcpy(&value, values + (size_t)i * sizeof(int), sizeof(int));
+        pack(data, i, bits, (uint64_t)((int64_t)value - base));
+    }
+    return size;
+}
+
+size_t segment_encode(ColumnType type, int width, int descriptor, const char* values,
+                      uint32_t count, char* out) {
+    SegmentHeader header = { ENCODING_RAW, 0, (uint16_t)width, count, 0, 0, 0 };
+    size_t raw_size = (size_t)width * count;
+    size_t best = raw_size;
+
+    // Runs
+    uint32_t runs = count ? 1 : 0;
+    for (uint32_t i = 1; i < count; i++) {
+        runs += memcmp(values + (size_t)i * width, values + (size_t)(i - 1) * width, width) != 0;
+    }
+    size_t rle_size = (size_t)runs * (width + sizeof(uint32_t));
+    if (rle_size < best) {
+        best = rle_size;
+        header.encoding = ENCODING_RLE;
+        header.entries = runs;
+    }
+
+    // Frame of reference
+    int64_t min = 0, max = 0;
+    if ((type == TYPE_INT || type == TYPE_DATE) && count > 0) {
+        int value;
+        memcpy(&value, values, sizeof(int));
+        min = max = value;
+        for (uint32_t i = 1; i < count; i++) {
+            memcpy(&value, values + (size_t)i * sizeof(int), sizeof(int));
+            if (value < min) min = value;
+            if (value > max) max = value;
+        }
+        int bits = bits_for((uint64_t)(max - min));
+        size_t frame_size = packed_size(count, bits);
+        if (frame_size < best) {
+            best = frame_size;
+            header.encoding = ENCODING_FRAME;
+            header.bits = (uint8_t)bits;
+            header.entries = 0;
+            header.base = min;
+        }
+    }
+
+    // Dictionary of the sorted distinct values
+    char* entries = NULL;
+    uint32_t entry_count = 0;
+    sort_type = type;
+    sort_width = width;
+    if (!descriptor && count > 0 && runs > 1) {
+        entries = malloc(raw_size);
+        memcpy(entries, values, raw_size);
+        qsort(entries, count, width, compare_values);
+        entry_count = 1;
+        for (uint32_t i = 1; i < count; i++) {
+            char* entry = entries + (size_t)i * width;
+            if (memcmp(entry, entries + (size_t)(entry_count - 1) * width, width) != 0) {
+                memmove(entries + (size_t)entry_count * width, entry, width);
+                entry_count++;
+            }
+        }
+        int bits = bits_for(entry_count - 1);
+        size_t dictionary_size = align8((size_t)entry_count * width) + packed_size(count, bits);
+        if (entry_count <= SEGMENT_DICTIONARY_MAX && dictionary_size < best) {
+            best = dictionary_size;
+            header.encoding = ENCODING_DICTIONARY;
+            header.bits = (uint8_t)bits;
+            header.entries = entry_count;
+            header.base = 0;
+        }
+    }
+
+    char* data = out + SEGMENT_HEADER_SIZE;
+    switch (header.encoding) {
+        case ENCODING_RLE:
+            header.size = (uint32_t)encode_rle(values, width, count, runs, data);
+            break;
+        case ENCODING_DICTIONARY:
+            header.size = (uint32_t)encode_dictionary(values, width, count, entries, entry_count,
+                                                      header.bits, data);
+            break;
+        case ENCODING_FRAME:
+            header.size = (uint32_t)encode_frame(values, count, header.base, header.bits, data);
+            break;
+        default:
+            header.size = (uint32_t)encode_raw(values, raw_size, data);
+            break;
+    }
+    free(entries);
+
+    memcpy(out, &header, sizeof(header));
+    return SEGMENT_HEADER_SIZE + header.size;
+}
+
+/* ============================================
+   DECODING
+   ============================================ */
+
+void segment_header(const char* segment, SegmentHeader* header) {
+    memcpy(header, segment, sizeof(*header));
+}
+
+size_t segment_size(const char* segment) {
+    SegmentHeader header;
+    segment_header(segment, &header);
+    return SEGMENT_HEADER_SIZE + header.size;
+}
+
+static uint32_t run_end(const char* ends, uint32_t run) {
+    uint32_t end;
+    memcpy(&end, ends + (size_t)run * sizeof(uint32_t), sizeof(end));
+    return end;
+}
+
+/* First run that ends after position */
+static uint32_t find_run(const char* ends, uint32_t runs, uint32_t position) {
+    uint32_t low = 0, high = runs;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (run_end(ends, middle) <= position) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+void segment_decode(const char* segment, uint32_t start, uint32_t count, char* values) {
+    SegmentHeader header;
+    segment_header(segment, &header);
+    const char* data = segment + SEGMENT_HEADER_SIZE;
+    int width = header.width;
+
+    switch (header.encoding) {
+        case ENCODING_RLE: {
+            const char* ends = data + (size_t)header.entries * width;
+            uint32_t run = find_run(ends, header.entries, start);
+            uint32_t end = run_end(ends, run);
+            for (uint32_t i = 0; i < count; i++) {
+                while (start + i >= end) end = run_end(ends, ++run);
+                memcpy(values + (size_t)i * width, data + (size_t)run * width, width);
+            }
+            break;
+        }
+        case ENCODING_DICTIONARY: {
+            const char* codes = data + align8((size_t)header.entries * width);
+            for (uint32_t i = 0; i < count; i++) {
+                uint64_t code = unpack(codes, start + i, header.bits);
+                memcpy(values + (size_t)i * width, data + code * width, width);
+            }
+            break;
+        }
+        case ENCODING_FRAME:
+            for (uint32_t i = 0; i < count; i++) {
+                int value = (int)(header.base + (int64_t)unpack(data, start + i, header.bits));
+                memcpy(values + (size_t)i * sizeof(int), &value, sizeof(int));
+            }
+            break;
+        default:
+            memcpy(values, data + (size_t)start * width, (size_t)count * width);
+            break;
+    }
+}
+
+/* ============================================
+   FILTERING
+   ============================================ */
+
+/* Matching entries of a sorted dictionary form the range [*low, *high) */
+static void dictionary_range(const Predicate* p, const char* entries, uint32_t entry_count,
+                             int width, uint32_t* low, uint32_t* high) {
+    // first: first entry >= constant; after: first entry > constant
+    uint32_t first = 0, after = 0;
+    uint32_t l = 0, h = entry_count;
+    while (l < h) {
+        uint32_t m = l + (h - l) / 2;
+        if (predicate_compare(p, entries + (size_t)m * width) < 0) l = m + 1; else h = m;
+    }
+    first = l;
+    h = entry_count;
+    while (l < h) {
+        uint32_t m = l + (h - l) / 2;
+        if (predicate_compare(p, entries + (size_t)m * width) <= 0) l = m + 1; else h = m;
+    }
+    after = l;
+
+    switch (p->op) {
+        case CMP_EQ: *low = first; *high = after; break;
+        case CMP_GT: *low = after; *high = entry_count; break;
+        case CMP_GE: *low = first; *high = entry_count; break;
+        case CMP_LT: *low = 0; *high = first; break;
+        default:     *low = 0; *high = after; break;
+    }
+}
+
+/* Matching offsets from the frame base form the range [*low, *high];
+   returns 0 if none can match */
+static int frame_range(const Predicate* p, int64_t base, int bits, uint64_t* low, uint64_t* high) {
+    int64_t top = bits ? (int64_t)(((uint64_t)1 << bits) - 1) : 0;
+    int64_t offset = (int64_t)p->int_value - base;
+    int64_t from = 0, to = top;
+    switch (p->op) {
+        case CMP_EQ: from = offset; to = offset; break;
+        case CMP_GT: from = offset + 1; break;
+        case CMP_GE: from = offset; break;
+        case CMP_LT: to = offset - 1; break;
+        default:     to = offset; break;
+    }
+    if (from < 0) from = 0;
+    if (to > top) to = top;
+    if (from > to) return 0;
+    *low = (uint64_t)from;
+    *high = (uint64_t)to;
+    return 1;
+}
+
+void segment_filter(const char* segment, const Predicate* comparison, uint32_t start,
+                    int count, uint64_t* bits) {
+    memset(bits, 0, sizeof(uint64_t) * FILTER_BITMAP_WORDS);
+    if (comparison->kind != PRED_COMPARE) return;
+
+    SegmentHeader header;
+    segment_header(segment, &header);
+    const char* data = segment + SEGMENT_HEADER_SIZE;
+    int width = header.width;
+
+    switch (header.encoding) {
+        case ENCODING_RLE: {
+            const char* ends = data + (size_t)header.entries * width;
+            uint32_t end = start + count;
+            uint32_t position = start;
+            for (uint32_t run = find_run(ends, header.entries, start); position < end; run++) {
+                uint32_t run_stop = run_end(ends, run);
+                if (run_stop > end) run_stop = end;
+                if (predicate_test(comparison, data + (size_t)run * width)) {
+                    for (uint32_t i = position; i < run_stop; i++) SET_BIT(bits, i - start);
+                }
+                position = run_stop;
+            }
+            break;
+        }
+        case ENCODING_DICTIONARY: {
+            uint32_t low, high;
+            dictionary_range(comparison, data, header.entries, width, &low, &high);
+            if (low < high) {
+                const char* codes = data + align8((size_t)header.entries * width);
+                packed_in_range(codes, header.bits, start, count, low, high - 1, bits);
+            }
+            break;
+        }
+        case ENCODING_FRAME: {
+            uint64_t low, high;
+            if (frame_range(comparison, header.base, header.bits, &low, &high)) {
+                packed_in_range(data, header.bits, start, count, low, high, bits);
+            }
+            break;
+        }
+        default: {
+            // Raw values are a table of one-column rows for the batch kernels
+            Predicate column = *comparison;
+            column.offset = 0;
+            filter_bitmap(&column, data + (size_t)start * width, width, count, bits);
+            break;
+        }
+    }
+}
+
+const char* encoding_name(Encoding encoding) {
+    switch (encoding) {
+        case ENCODING_RLE: return "rle";
+        case ENCODING_DICTIONARY: return "dictionary";
+        case ENCODING_FRAME: return "frame";
+        default: return "raw";
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "predicate.h"
+
+/* =======================
+   COLUMN SEGMENT ENCODINGS
+   ======================= */
+
+/*
+ * A segment holds up to SEGMENT_ROWS consecutive values of one column.
+ * When it is written, the encoder sizes every encoding that applies and
+ * keeps the smallest:
+ *
+ *   raw         the fixed-width values back to back
+ *   rle         run values, then the u32 end position of each run
+ *   dictionary  the distinct values in sorted order, then one bit-packed
+ *               code per value (not for long varchar descriptors, whose
+ *               bytes do not sort like their text)
+ *   frame       int and date: the segment minimum as base, then each
+ *               value's offset from it bit-packed in as few bits as the
+ *               segment's range needs
+ *
+ * A comparison is evaluated on the encoded form: once per run for rle,
+ * as a range of codes found by binary search in the sorted dictionary,
+ * and as a range of offsets for frame-of-reference, so the packed data
+ * is only unpacked to integers and never to values.
+ */
+
+#define SEGMENT_ROWS (64 * 1024)
+#define SEGMENT_DICTIONARY_MAX 65536    // Most distinct values a dictionary takes
+
+typedef enum {
+    ENCODING_RAW,
+    ENCODING_RLE,
+    ENCODING_DICTIONARY,
+    ENCODING_FRAME
+} Encoding;
+
+/* Start of every encoded segment; the encoded data follows */
+typedef struct {
+    uint8_t encoding;
+    uint8_t bits;           // Bits per packed code or offset
+    uint16_t width;         // Bytes per value
+    uint32_t count;         // Values in the segment
+    uint32_t entries;       // Runs or dictionary entries
+    uint32_t size;          // Encoded bytes after the header
+    int64_t base;           // Frame-of-reference minimum
+} SegmentHeader;
+
+#define SEGMENT_HEADER_SIZE ((int)sizeof(SegmentHeader))
+
+/* Largest encoding of count values of the given width, header included */
+size_t segment_bound(int width, uint32_t count);
+
+/* Encode count values laid out every width bytes (descriptor: long
+   varchar descriptors) into out, which must hold segment_bound() bytes.
+   Returns the bytes written. */
+size_t segment_encode(ColumnType type, int width, int descriptor, const char* values,
+                      uint32_t count, char* out);
+
+/* Header of an encoded segment, which may sit at any alignment */
+void segment_header(const char* segment, SegmentHeader* header);
+
+/* Total size of an encoded segment */
+size_t segment_size(const char* segment);
+
+/* Decode values [start, start + count) of a segment to fixed-width values */
+void segment_decode(const char* segment, uint32_t start, uint32_t count, char* values);
+
+/* Evaluate one comparison (PRED_COMPARE or PRED_FALSE) on values
+   [start, start + count) of a segment, count <= FILTER_BATCH_SIZE: sets
+   bit i of the FILTER_BITMAP_WORDS-word bitmap for each match */
+void segment_filter(const char* segment, const Predicate* comparison, uint32_t start,
+                    int count, uint64_t* bits);
+
+/* Name of an encoding for diagnostics */
+const char* encoding_name(Encoding encoding);
+
+#endif
@@ -3,73 +3,246 @@
 #include <string.h>
 #include <direct.h>
 #include <errno.h>
+#include <limits.h>
 #include <sys/stat.h>
 #include <windows.h>
 #include "executor.h"
+#include "buffer_pool.h"
+#include "table_map.h"
+#include "predicate.h"
+#include "filter.h"
+#include "catalog.h"
+#include "wal.h"
+#include "plan.h"
+#include "result.h"
+#include "pool.h"
+#include "platform.h"
 #include "ast.h"
+#include "output.h"
+#include "column_store.h"
+#include "aggregate.h"
+#include "sort.h"
+#include "spill.h"
+#include "join.h"
 
 // Global to track current database
-char current_database[128] = "";
+THREAD_LOCAL char current_database[128] = "";
+long long rows_processed = 0;
+int parallel_scan_ordered = 1;
+
+static Mutex engine_mutex;
+static int engine_shared;
+
+void engine_share(void) {
+    mutex_init(&engine_mutex);
+    engine_shared = 1;
+}
+
+void engine_lock(void) {
+    if (engine_shared) mutex_lock(&engine_mutex);
+}
+
+void engine_unlock(void) {
+    if (engine_shared) mutex_unlock(&engine_mutex);
+}
+
+static THREAD_LOCAL Wal* pending_wal;       // Held log of a commit not yet waited for
+static THREAD_LOCAL uint64_t pending_lsn;
+static THREAD_LOCAL char pending_database[128];
+
+/* Wait for this thread's pending commit now, under the lock */
+static void commit_pending(void) {
+    if (pending_wal) {
+        wal_commit_held(pending_wal, pending_lsn);
+        pending_wal = NULL;
+    }
+}
+
+/* Leave a commit for the caller to wait for after engine_unlock() */
+static void defer_commit(Wal* wal, uint64_t lsn) {
+    if (pending_wal != wal) {
+        commit_pending();
+        wal_hold(wal);
+        pending_wal = wal;
+        strcpy(pending_database, current_database);
+    }
+    pending_lsn = lsn;
+}
+
+int engine_take_commit(Wal** wal, uint64_t* lsn) {
+    if (!pending_wal) return 0;
+    *wal = pending_wal;
+    *lsn = pending_lsn;
+    pending_wal = NULL;
+    return 1;
+}
+
+/* The log of a database. Opening another database's log may recycle the
+   held one, so a pending commit there is waited for first. */
+static Wal* database_wal(const char* db_name) {
+    if (pending_wal && strcmp(pending_database, db_name) != 0) {
+        commit_pending();
+    }
+    return wal_get(db_name);
+}
 
 /* ============================================
    HELPER FUNCTIONS (Must be defined first)
    ============================================ */
 
-/* Calculate row size based on schema */
+/* Map a schema type name to its type enum */
+ColumnType column_type_of(const char* data_type) {
+    if (strcasecmp(data_type, "int") == 0) return TYPE_INT;
+    if (strcasecmp(data_type, "varchar") == 0 || strncasecmp(data_type, "varchar(", 8) == 0) {
+        return TYPE_VARCHAR;
+    }
+    if (strcasecmp(data_type, "double") == 0) return TYPE_DOUBLE;
+    if (strcasecmp(data_type, "date") == 0) return TYPE_DATE;
+    return TYPE_UNKNOWN;
+}
+
+/* Stored width of a column in bytes */
+int column_width(ColumnType type) {
+    switch (type) {
+        case TYPE_INT: return sizeof(int);
+        case TYPE_VARCHAR: return VARCHAR_LEGACY_WIDTH;  // Plain VARCHAR
+        case TYPE_DOUBLE: return sizeof(double);
+        case TYPE_DATE: return sizeof(int);  // Store as Unix timestamp
+        case TYPE_BIGINT: return sizeof(long long);
+        default: return 0;
+    }
+}
+
+/* Declared n of "varchar(n)": 0 for plain varchar, -1 if n is out of range */
+int varchar_length(const char* data_type) {
+    if (strncasecmp(data_type, "varchar(", 8) != 0) return 0;
+    char* end;
+    long length = strtol(data_type + 8, &end, 10);
+    if (*end != ')' || length < 1 || length > VARCHAR_MAX_LENGTH) return -1;
+    return (int)length;
+}
+
+/* Type, width and varchar storage of a column from its data_type */
+static void resolve_column(ColumnSchema* column) {
+    column->type = column_type_of(column->data_type);
+    column->width = column_width(column->type);
+    column->length = 0;
+    column->overflow = 0;
+    if (column->type == TYPE_VARCHAR) {
+        int length = varchar_length(column->data_type);
+        if (length > VARCHAR_INLINE_MAX) {
+            column->length = length;
+            column->overflow = 1;
+            column->width = VARCHAR_DESCRIPTOR_SIZE;
+        } else if (length > 0) {
+            column->length = length;
+            column->width = length;
+        }
+    }
+}
+
+/* Row size, resolved when the schema was read */
 int calculate_row_size(TableSchema* schema) {
-    int size = 0;
-    for (int i = 0; i < schema->column_count; i++) {
-        if (strcmp(schema->columns[i].data_type, "int") == 0) {
-            size += sizeof(int);
-        } else if (strcmp(schema->columns[i].data_type, "varchar") == 0) {
-            size += 64;  // Fixed size for varchar
-        } else if (strcmp(schema->columns[i].data_type, "double") == 0) {
-            size += sizeof(double);
-        } else if (strcmp(schema->columns[i].data_type, "date") == 0) {
-            size += sizeof(int);  // Store as Unix timestamp
-        }
-    }
-    return size;
-}
-
-/* Write a value to the table file based on data type */
-void write_value(FILE* file, const char* value, const char* data_type) {
-    if (strcmp(data_type, "int") == 0) {
-        int int_val = atoi(value);
-        fwrite(&int_val, sizeof(int), 1, file);
-    } else if (strcmp(data_type, "varchar") == 0) {
-        char buffer[64] = {0};  // Initialize with zeros
-        strncpy(buffer, value, 63);  // Copy up to 63 chars (leave room for null terminator)
-        fwrite(buffer, sizeof(char), 64, file);
-    } else if (strcmp(data_type, "double") == 0) {
-        double double_val = atof(value);
-        fwrite(&double_val, sizeof(double), 1, file);
-    } else if (strcmp(data_type, "date") == 0) {
-        // Simple date parsing (you can improve this)
-        int date_val = atoi(value);  // For now, treat as timestamp
-        fwrite(&date_val, sizeof(int), 1, file);
-    }
-}
-
-/* Read a value from table file based on data type */
-void read_value(FILE* file, const char* data_type, char* buffer, size_t buffer_size) {
-    if (strcmp(data_type, "int") == 0) {
-        int val;
-        fread(&val, sizeof(int), 1, file);
-        snprintf(buffer, buffer_size, "%d", val);
-    } else if (strcmp(data_type, "varchar") == 0) {
-        char varchar_buffer[64];
-        fread(varchar_buffer, sizeof(char), 64, file);
-        varchar_buffer[63] = '\0';  // Ensure null termination
-        snprintf(buffer, buffer_size, "%s", varchar_buffer);
-    } else if (strcmp(data_type, "double") == 0) {
-        double val;
-        fread(&val, sizeof(double), 1, file);
-        snprintf(buffer, buffer_size, "%.2f", val);
-    } else if (strcmp(data_type, "date") == 0) {
-        int val;
-        fread(&val, sizeof(int), 1, file);
-        snprintf(buffer, buffer_size, "%d", val);
+    return schema->row_size;
+}
+
+/* Byte offset of a column from the start of its row */
+long column_offset(TableSchema* schema, int col_index) {
+    return schema->columns[col_index].offset;
+}
+
+int varchar_text(const char* field, int width, int descriptor, const char* overflow,
+                 const char** text) {
+    if (!descriptor) {
+        *text = field;
+        return (int)strnlen(field, width);
+    }
+
+    uint32_t length;
+    memcpy(&length, field, sizeof(length));
+    if (length <= VARCHAR_DESCRIPTOR_INLINE) {
+        *text = field + sizeof(uint32_t);
+    } else {
+        uint64_t offset;
+        memcpy(&offset, field + 8, sizeof(offset));
+        *text = overflow + offset;
+    }
+    return (int)length;
+}
+
+/* Whether a value fits its column; plain VARCHAR truncates instead */
+int value_fits(const ColumnSchema* column, const char* value) {
+    return column->type != TYPE_VARCHAR || column->length == 0 ||
+           strlen(value) <= (size_t)column->length;
+}
+
+/* Encode a value into a row buffer based on data type, returns bytes
+   written. A long varchar only gets its descriptor's length and inline
+   bytes here; the appender places the rest in the overflow file. */
+int write_value(char* dest, const char* value, const ColumnSchema* column) {
+    switch (column->type) {
+        case TYPE_INT: {
+            int int_val = atoi(value);
+            memcpy(dest, &int_val, sizeof(int));
+            return sizeof(int);
+        }
+        case TYPE_VARCHAR: {
+            size_t length = strlen(value);
+            memset(dest, 0, column->width);
+            if (column->overflow) {
+                uint32_t stored = (uint32_t)length;
+                memcpy(dest, &stored, sizeof(stored));
+                memcpy(dest + sizeof(uint32_t), value,
+                       length < VARCHAR_DESCRIPTOR_INLINE ? length : VARCHAR_DESCRIPTOR_INLINE);
+            } else {
+                // Plain VARCHAR keeps a terminator; VARCHAR(n) may fill all n bytes
+                size_t room = column->length ? (size_t)column->width : (size_t)column->width - 1;
+                memcpy(dest, value, length < room ? length : room);
+            }
+            return column->width;
+        }
+        case TYPE_DOUBLE: {
+            double double_val = atof(value);
+            memcpy(dest, &double_val, sizeof(double));
+            return sizeof(double);
+        }
+        case TYPE_DATE: {
+            // Simple date parsing (you can improve this)
+            int date_val = atoi(value);  // For now, treat as timestamp
+            memcpy(dest, &date_val, sizeof(int));
+            return sizeof(int);
+        }
+        default:
+            return 0;
+    }
+}
+
+/* Format a value from a row buffer based on data type, returns bytes consumed */
+int read_value(const char* src, const ColumnSchema* column, const char* overflow,
+               char* buffer, size_t buffer_size) {
+    switch (column->type) {
+        case TYPE_INT:
+        case TYPE_DATE: {
+            int val;
+            memcpy(&val, src, sizeof(int));
+            snprintf(buffer, buffer_size, "%d", val);
+            return sizeof(int);
+        }
+        case TYPE_VARCHAR: {
+            const char* text;
+            int length = varchar_text(src, column->width, column->overflow, overflow, &text);
+            snprintf(buffer, buffer_size, "%.*s", length, text);
+            return column->width;
+        }
+        case TYPE_DOUBLE: {
+            double val;
+            memcpy(&val, src, sizeof(double));
+            snprintf(buffer, buffer_size, "%.2f", val);
+            return sizeof(double);
+        }
+        default:
+            buffer[0] = '\0';
+            return 0;
     }
 }
 
@@ -92,95 +265,27 @@ int should_select_column(ASTNode* column_list, const char* column_name) {
     return 0;
 }
 
-/* Evaluate WHERE condition for a row */
-int evaluate_condition(ASTNode* condition, TableSchema* schema, FILE* table_file, long row_offset) {
-    if (!condition) return 1;  // No condition means select all
-    
-    if (condition->type == AST_WHERE) {
-        return evaluate_condition(condition->left, schema, table_file, row_offset);
-    }
-    
-    if (condition->type == AST_CONDITION) {
-        // Get column name from left child
-        if (!condition->left || condition->left->type != AST_IDENTIFIER) {
-            return 0;
-        }
-        
-        const char* column_name = condition->left->value;
-        const char* operator = condition->value;
-        
-        // Get expected value from right child
-        if (!condition->right) return 0;
-        const char* expected_value = condition->right->value;
-        
-        // Find column index in schema
-        int col_index = -1;
-        for (int i = 0; i < schema->column_count; i++) {
-            if (strcmp(schema->columns[i].column_name, column_name) == 0) {
-                col_index = i;
-                break;
-            }
-        }
-        
-        if (col_index == -1) {
-            printf("Column '%s' not found\n", column_name);
-            return 0;
-        }
-        
-        // Seek to the column in the row
-        long offset = row_offset;
-        for (int i = 0; i < col_index; i++) {
-            if (strcmp(schema->columns[i].data_type, "int") == 0) {
-                offset += sizeof(int);
-            } else if (strcmp(schema->columns[i].data_type, "varchar") == 0) {
-                offset += 64;
-            } else if (strcmp(schema->columns[i].data_type, "double") == 0) {
-                offset += sizeof(double);
-            } else if (strcmp(schema->columns[i].data_type, "date") == 0) {
-                offset += sizeof(int);
-            }
-        }
-        
-        fseek(table_file, offset, SEEK_SET);
-        
-        // Read the actual value
-        char actual_value[256];
-        read_value(table_file, schema->columns[col_index].data_type, actual_value, sizeof(actual_value));
-        
-        // Compare based on operator
-        if (strcmp(operator, "=") == 0) {
-            return strcmp(actual_value, expected_value) == 0;
-        } else if (strcmp(operator, ">") == 0) {
-            return atoi(actual_value) > atoi(expected_value);
-        } else if (strcmp(operator, "<") == 0) {
-            return atoi(actual_value) < atoi(expected_value);
-        } else if (strcmp(operator, ">=") == 0) {
-            return atoi(actual_value) >= atoi(expected_value);
-        } else if (strcmp(operator, "<=") == 0) {
-            return atoi(actual_value) <= atoi(expected_value);
-        }
-    }
-    
-    return 0;
-}
-
 /* ============================================
    SCHEMA OPERATIONS
    ============================================ */
 
 /* Write schema to .schema file */
-void write_schema(const char* db_name, const char* table_name, ASTNode* columns) {
+void write_schema(const char* db_name, const char* table_name, ASTNode* columns,
+                  TableStorage storage) {
     char schema_path[256];
     snprintf(schema_path, sizeof(schema_path), "databases\\%s\\%s.schema", db_name, table_name);
     
     FILE* schema_file = fopen(schema_path, "w");
     if (!schema_file) {
-        perror("Failed to create schema file");
+        out_perror("Failed to create schema file");
         return;
     }
     
     // Write table name
     fprintf(schema_file, "TABLE:%s\n", table_name);
+    if (storage == STORAGE_COLUMN) {
+        fprintf(schema_file, "STORAGE:COLUMN\n");
+    }
     fprintf(schema_file, "COLUMNS:\n");
     
     // Traverse column list
@@ -205,7 +310,7 @@ void write_schema(const char* db_name, const char* table_name, ASTNode* columns)
     }
     
     fclose(schema_file);
-    printf("Schema file created: %s\n", schema_path);
+    out_printf("Schema file created: %s\n", schema_path);
 }
 
 /* Read schema from .schema file */
@@ -223,36 +328,56 @@ TableSchema* read_schema(const char* db_name, const char* table_name) {
     
     // Read table name
     fgets(line, sizeof(line), schema_file);
-    sscanf(line, "TABLE:%s", schema->table_name);
+    sscanf(line, "TABLE:%63s", schema->table_name);
     
-    // Skip "COLUMNS:" line
+    // Optional "STORAGE:" line (row tables leave it out), then "COLUMNS:"
+    schema->storage = STORAGE_ROW;
     fgets(line, sizeof(line), schema_file);
-    
-    // Count columns
-    schema->column_count = 0;
-    long pos = ftell(schema_file);
-    while (fgets(line, sizeof(line), schema_file)) {
-        schema->column_count++;
+    if (strncmp(line, "STORAGE:COLUMN", 14) == 0) {
+        schema->storage = STORAGE_COLUMN;
+        fgets(line, sizeof(line), schema_file);
     }
     
-    // Allocate column array
-    schema->columns = malloc(sizeof(ColumnSchema) * schema->column_count);
+    // Read columns in one pass, resolving type, offset and width as we go
+    int capacity = 8;
+    schema->columns = malloc(sizeof(ColumnSchema) * capacity);
+    schema->column_count = 0;
+    schema->row_size = 0;
+    schema->overflow_columns = 0;
     
-    // Read columns
-    fseek(schema_file, pos, SEEK_SET);
-    int i = 0;
     while (fgets(line, sizeof(line), schema_file)) {
         char* comma = strchr(line, ',');
-        if (comma) {
-            *comma = '\0';
-            strcpy(schema->columns[i].column_name, line);
-            
-            // Remove newline from data type
-            char* newline = strchr(comma + 1, '\n');
-            if (newline) *newline = '\0';
-            strcpy(schema->columns[i].data_type, comma + 1);
-            i++;
+        if (!comma) continue;
+        
+        // A longer name would be cut and then never match
+        *comma = '\0';
+        size_t name_length = strlen(line);
+        if (name_length >= COLUMN_NAME_SIZE) {
+            out_printf("Invalid schema for '%s': column name longer than %d characters\n", table_name,
+                       COLUMN_NAME_SIZE - 1);
+            fclose(schema_file);
+            free(schema->columns);
+            free(schema);
+            return NULL;
+        }
+        
+        if (schema->column_count == capacity) {
+            capacity *= 2;
+            schema->columns = realloc(schema->columns, sizeof(ColumnSchema) * capacity);
         }
+        
+        ColumnSchema* column = &schema->columns[schema->column_count++];
+        memcpy(column->column_name, line, name_length + 1);
+        
+        // Remove newline from data type
+        char* newline = strpbrk(comma + 1, "\r\n");
+        if (newline) *newline = '\0';
+        snprintf(column->data_type, sizeof(column->data_type), "%s", comma + 1);
+        
+        resolve_column(column);
+        column->offset = schema->row_size;
+        schema->row_size += column->width;
+        schema->overflow_columns += column->overflow;
     }
     
     fclose(schema_file);
@@ -276,18 +401,44 @@ void create_table_file(const char* db_name, const char* table_name) {
     char table_path[256];
     snprintf(table_path, sizeof(table_path), "databases\\%s\\%s.table", db_name, table_name);
     
-    FILE* table_file = fopen(table_path, "wb");
-    if (!table_file) {
-        perror("Failed to create table file");
+    int table_file = bp_create(table_path);
+    if (table_file == -1) {
+        out_perror("Failed to create table file");
         return;
     }
     
     // Write header: number of rows (initially 0)
     int row_count = 0;
-    fwrite(&row_count, sizeof(int), 1, table_file);
+    bp_write(table_file, 0, &row_count, sizeof(int));
+    bp_release(table_file);
+    out_printf("Table file created: %s\n", table_path);
+}
+
+/* Create the empty .ovf file that holds a table's long varchar values */
+void create_overflow_file(const char* db_name, const char* table_name) {
+    char overflow_path[256];
+    snprintf(overflow_path, sizeof(overflow_path), "databases\\%s\\%s.ovf", db_name, table_name);
+    
+    int overflow_file = bp_create(overflow_path);
+    if (overflow_file == -1) {
+        out_perror("Failed to create overflow file");
+        return;
+    }
     
-    fclose(table_file);
-    printf("Table file created: %s\n", table_path);
+    // Header: bytes in use, including the header itself
+    uint64_t used = OVERFLOW_HEADER_SIZE;
+    bp_write(overflow_file, 0, &used, sizeof(used));
+    bp_release(overflow_file);
+}
+
+/* Pick the indexed column: the first int or date column, -1 if none */
+int index_key_column(TableSchema* schema) {
+    for (int i = 0; i < schema->column_count; i++) {
+        if (schema->columns[i].type == TYPE_INT || schema->columns[i].type == TYPE_DATE) {
+            return i;
+        }
+    }
+    return -1;
 }
 
 /* Create empty .idx file for B-tree index */
@@ -295,42 +446,95 @@ void create_index_file(const char* db_name, const char* table_name) {
     char index_path[256];
     snprintf(index_path, sizeof(index_path), "databases\\%s\\%s.idx", db_name, table_name);
     
-    FILE* index_file = fopen(index_path, "wb");
-    if (!index_file) {
-        perror("Failed to create index file");
+    TableSchema* schema = catalog_get(db_name, table_name);
+    int key_column = schema ? index_key_column(schema) : -1;
+    
+    if (!btree_create(index_path, key_column)) {
+        out_perror("Failed to create index file");
         return;
     }
     
-    // Write B-tree metadata
-    int degree = 3;  // Minimum degree (order)
-    int node_count = 0;  // Initially no nodes
-    
-    fwrite(&degree, sizeof(int), 1, index_file);
-    fwrite(&node_count, sizeof(int), 1, index_file);
-    
-    fclose(index_file);
-    printf("Index file created: %s\n", index_path);
+    out_printf("Index file created: %s\n", index_path);
 }
 
-/* Load B-tree index into memory */
-BTreeNode* load_index(const char* db_name, const char* table_name) {
+/* Index a column table from its key column file */
+static void rebuild_column_index(BTree* tree, const char* db_name, const char* table_name,
+                                 TableSchema* schema, int key_column, int row_count) {
+    Arena arena;
+    arena_init(&arena, ARENA_DEFAULT_BLOCK_SIZE);
+    char* needed = arena_calloc(&arena, schema->column_count);
+    needed[key_column] = 1;
+    
+    ColumnScan scan;
+    if (column_scan_open(&scan, db_name, table_name, schema, needed, row_count, &arena)) {
+        char* rows = arena_alloc(&arena, (size_t)FILTER_BATCH_SIZE * schema->row_size);
+        char* scratch = arena_alloc(&arena, scan.scratch_size);
+        for (int start = 0; start < row_count; start += FILTER_BATCH_SIZE) {
+            int count = row_count - start < FILTER_BATCH_SIZE ? row_count - start : FILTER_BATCH_SIZE;
+            column_scan_rows(&scan, start, count, NULL, count, rows, scratch);
+            for (int i = 0; i < count; i++) {
+                int key;
+                memcpy(&key, rows + (long)i * schema->row_size + schema->columns[key_column].offset,
+                       sizeof(int));
+                btree_insert(tree, key, start + i);
+            }
+        }
+        column_scan_close(&scan);
+    }
+    arena_free(&arena);
+}
+
+/* Rebuild the B-tree index from the rows in the .table file */
+BTree* rebuild_index(const char* db_name, const char* table_name) {
+    TableSchema* schema = catalog_get(db_name, table_name);
+    if (!schema) {
+        return NULL;
+    }
+    
     char index_path[256];
+    char table_path[256];
     snprintf(index_path, sizeof(index_path), "databases\\%s\\%s.idx", db_name, table_name);
+    snprintf(table_path, sizeof(table_path), "databases\\%s\\%s.table", db_name, table_name);
     
-    FILE* index_file = fopen(index_path, "rb");
-    if (!index_file) {
+    int key_column = index_key_column(schema);
+    if (!btree_create(index_path, key_column)) {
         return NULL;
     }
     
-    int degree, node_count;
-    fread(&degree, sizeof(int), 1, index_file);
-    fread(&node_count, sizeof(int), 1, index_file);
+    BTree* tree = btree_open(index_path);
+    int table_file = bp_open(table_path);
+    if (tree && table_file != -1 && key_column >= 0) {
+        int row_count = 0;
+        bp_read(table_file, 0, &row_count, sizeof(int));
+        
+        int row_size = calculate_row_size(schema);
+        long key_offset = column_offset(schema, key_column);
+        
+        if (schema->storage == STORAGE_COLUMN) {
+            rebuild_column_index(tree, db_name, table_name, schema, key_column, row_count);
+        } else {
+            for (int row = 0; row < row_count; row++) {
+                int key;
+                bp_read(table_file, sizeof(int) + (long)row * row_size + key_offset, &key, sizeof(int));
+                btree_insert(tree, key, row);
+            }
+        }
+    }
+    bp_release(table_file);
     
-    // TODO: Implement B-tree deserialization
-    // For now, return NULL (empty index)
+    return tree;
+}
+
+/* Load B-tree index, rebuilding it if the file predates the page format */
+BTree* load_index(const char* db_name, const char* table_name) {
+    char index_path[256];
+    snprintf(index_path, sizeof(index_path), "databases\\%s\\%s.idx", db_name, table_name);
     
-    fclose(index_file);
-    return NULL;
+    BTree* tree = btree_open(index_path);
+    if (!tree) {
+        tree = rebuild_index(db_name, table_name);
+    }
+    return tree;
 }
 
 /* ============================================
@@ -347,12 +551,12 @@ void createdatabase(ASTNode *database) {
 
     if (_mkdir(path) == -1) {
         if (errno == EEXIST) {
-            printf("Database already exists\n");
+            out_printf("Database already exists\n");
         } else {
-            perror("mkdir failed");
+            out_perror("mkdir failed");
         }
     } else {
-        printf("Database created: %s\n", path);
+        out_printf("Database created: %s\n", path);
     }
 }
 
@@ -363,10 +567,14 @@ void deletedatabase(const char* db_name) {
     // Check if database exists
     DWORD attributes = GetFileAttributes(path);
     if (attributes == INVALID_FILE_ATTRIBUTES) {
-        printf("Database '%s' does not exist\n", db_name);
+        out_printf("Database '%s' does not exist\n", db_name);
         return;
     }
     
+    // Close the log first; the database's files are going away
+    commit_pending();
+    wal_forget(db_name);
+    
     // Delete all files in the database directory
     char search_path[256];
     snprintf(search_path, sizeof(search_path), "%s\\*", path);
@@ -380,6 +588,8 @@ void deletedatabase(const char* db_name) {
                 strcmp(findFileData.cFileName, "..") != 0) {
                 char file_path[512];
                 snprintf(file_path, sizeof(file_path), "%s\\%s", path, findFileData.cFileName);
+                table_unmap(file_path);
+                bp_close_path(file_path);
                 DeleteFile(file_path);
             }
         } while (FindNextFile(hFind, &findFileData) != 0);
@@ -387,21 +597,23 @@ void deletedatabase(const char* db_name) {
     }
     
     // Remove the directory
+    catalog_invalidate_database(db_name);
+    
     if (_rmdir(path) == 0) {
-        printf("Database '%s' deleted successfully\n", db_name);
+        out_printf("Database '%s' deleted successfully\n", db_name);
         
         // Clear current database if it was deleted
         if (strcmp(current_database, db_name) == 0) {
             current_database[0] = '\0';
         }
     } else {
-        perror("Failed to delete database");
+        out_perror("Failed to delete database");
     }
 }
 
 void use_database(ASTNode* use_node) {
     if (!use_node->right || use_node->right->type != AST_IDENTIFIER) {
-        printf("Invalid database name\n");
+        out_printf("Invalid database name\n");
         return;
     }
     
@@ -413,18 +625,21 @@ void use_database(ASTNode* use_node) {
     DWORD attributes = GetFileAttributes(path);
     
     if (attributes == INVALID_FILE_ATTRIBUTES) {
-        printf("Error: Database '%s' does not exist\n", db_name);
+        out_printf("Error: Database '%s' does not exist\n", db_name);
         return;
     }
     
     if (!(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
-        printf("Error: '%s' is not a database directory\n", db_name);
+        out_printf("Error: '%s' is not a database directory\n", db_name);
         return;
     }
     
+    // Replay the database's log if the last session did not checkpoint it
+    database_wal(db_name);
+    
     // Successfully switch database
     strcpy(current_database, db_name);
-    printf("Database changed to '%s'\n", current_database);
+    out_printf("Database changed to '%s'\n", current_database);
 }
 
 void show_databases() {
@@ -433,13 +648,13 @@ void show_databases() {
 
     hFind = FindFirstFile("databases\\*", &findFileData);
     if (hFind == INVALID_HANDLE_VALUE) {
-        printf("Error: 'databases' directory not found\n");
+        out_printf("Error: 'databases' directory not found\n");
         return;
     }
 
     int found = 0;
-    printf("Databases:\n");
-    printf("+------------------+\n");
+    out_printf("Databases:\n");
+    out_printf("+------------------+\n");
 
     do {
         // Skip "." and ".."
@@ -450,15 +665,15 @@ void show_databases() {
 
         // Check if it's a directory
         if (findFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-            printf("| %-16s |\n", findFileData.cFileName);
+            out_printf("| %-16s |\n", findFileData.cFileName);
             found = 1;
         }
     } while (FindNextFile(hFind, &findFileData) != 0);
 
-    printf("+------------------+\n");
+    out_printf("+------------------+\n");
 
     if (!found) {
-        printf("No databases found.\n");
+        out_printf("No databases found.\n");
     }
 
     FindClose(hFind);
@@ -470,12 +685,12 @@ void show_databases() {
 
 void createtable(ASTNode* table) {
     if (current_database[0] == '\0') {
-        printf("No database selected. Use 'USE <database>;' first.\n");
+        out_printf("No database selected. Use 'USE <database>;' first.\n");
         return;
     }
     
     if (!table->right || table->right->type != AST_IDENTIFIER) {
-        printf("Invalid table structure\n");
+        out_printf("Invalid table structure\n");
         return;
     }
     
@@ -483,20 +698,46 @@ void createtable(ASTNode* table) {
     ASTNode* columns = table->right->left;
     
     if (!columns) {
-        printf("No columns defined for table\n");
+        out_printf("No columns defined for table\n");
         return;
     }
     
     // Check if table already exists
-    TableSchema* existing = read_schema(current_database, table_name);
+    TableSchema* existing = catalog_get(current_database, table_name);
     if (existing) {
-        printf("Table '%s' already exists\n", table_name);
-        free_schema(existing);
+        out_printf("Table '%s' already exists\n", table_name);
+        return;
+    }
+    
+    // VARCHAR(n) lengths are checked here; the parser only reads the number
+    for (ASTNode* column = columns; column; column = column->right ? column->right->right : NULL) {
+        if (strlen(column->value) >= COLUMN_NAME_SIZE) {
+            out_printf("Column name '%s' is too long: at most %d characters\n", column->value,
+                       COLUMN_NAME_SIZE - 1);
+            return;
+        }
+        if (column->right && varchar_length(column->right->value) < 0) {
+            out_printf("Invalid length for column '%s': VARCHAR(n) takes 1 to %d\n",
+                       column->value, VARCHAR_MAX_LENGTH);
+            return;
+        }
+    }
+    
+    // Every column of a column table needs a buffer pool file of its own
+    TableStorage storage = strcmp(table->value, "COLUMN") == 0 ? STORAGE_COLUMN : STORAGE_ROW;
+    int column_count = 0;
+    for (ASTNode* column = columns; column; column = column->right ? column->right->right : NULL) {
+        column_count++;
+    }
+    if (storage == STORAGE_COLUMN && column_count > COLUMN_MAX_COLUMNS) {
+        out_printf("Table '%s' has %d columns: STORAGE = COLUMN allows at most %d\n", table_name,
+                   column_count, COLUMN_MAX_COLUMNS);
         return;
     }
     
     // Create schema file
-    write_schema(current_database, table_name, columns);
+    write_schema(current_database, table_name, columns, storage);
+    catalog_invalidate(current_database, table_name);
     
     // Create table data file
     create_table_file(current_database, table_name);
@@ -504,24 +745,43 @@ void createtable(ASTNode* table) {
     // Create index file
     create_index_file(current_database, table_name);
     
-    printf("Table '%s' created successfully in database '%s'\n", table_name, current_database);
+    // Long varchar values live in an overflow file
+    TableSchema* schema = catalog_get(current_database, table_name);
+    if (schema && schema->overflow_columns > 0) {
+        create_overflow_file(current_database, table_name);
+    }
+    
+    // Column tables keep their values in per-column files
+    if (schema && schema->storage == STORAGE_COLUMN) {
+        create_column_files(current_database, table_name, schema);
+    }
+    bp_sync_all();
+    
+    out_printf("Table '%s' created successfully in database '%s'\n", table_name, current_database);
 }
 
 void deletetable(const char* table_name) {
     if (current_database[0] == '\0') {
-        printf("No database selected. Use 'USE <database>;' first.\n");
+        out_printf("No database selected. Use 'USE <database>;' first.\n");
         return;
     }
     
     // Check if table exists
-    TableSchema* schema = read_schema(current_database, table_name);
+    TableSchema* schema = catalog_get(current_database, table_name);
     if (!schema) {
-        printf("Table '%s' does not exist\n", table_name);
+        out_printf("Table '%s' does not exist\n", table_name);
         return;
     }
-    free_schema(schema);
+    int column_files = schema->storage == STORAGE_COLUMN ? schema->column_count : 0;
+    catalog_invalidate(current_database, table_name);
+    
+    // Logged appends must not be replayed into a later table of the same name
+    Wal* wal = database_wal(current_database);
+    if (wal) {
+        wal_checkpoint(wal);
+    }
     
-    // Delete .schema, .table, and .idx files
+    // Delete .schema, .table, .idx, .ovf and .col files
     char file_path[256];
     
     // Delete schema file
@@ -530,18 +790,30 @@ void deletetable(const char* table_name) {
     
     // Delete table file
     snprintf(file_path, sizeof(file_path), "databases\\%s\\%s.table", current_database, table_name);
+    table_unmap(file_path);
+    bp_close_path(file_path);
     DeleteFile(file_path);
     
     // Delete index file
     snprintf(file_path, sizeof(file_path), "databases\\%s\\%s.idx", current_database, table_name);
+    bp_close_path(file_path);
     DeleteFile(file_path);
     
-    printf("Table '%s' deleted successfully\n", table_name);
+    // Delete overflow file, if the table has one
+    snprintf(file_path, sizeof(file_path), "databases\\%s\\%s.ovf", current_database, table_name);
+    table_unmap(file_path);
+    bp_close_path(file_path);
+    DeleteFile(file_path);
+    
+    // Delete column files of a column table
+    delete_column_files(current_database, table_name, column_files);
+    
+    out_printf("Table '%s' deleted successfully\n", table_name);
 }
 
 void show_tables() {
     if (current_database[0] == '\0') {
-        printf("No database selected. Use 'USE <database>;' first.\n");
+        out_printf("No database selected. Use 'USE <database>;' first.\n");
         return;
     }
 
@@ -552,13 +824,13 @@ void show_tables() {
     HANDLE hFind = FindFirstFile(path, &findFileData);
     
     if (hFind == INVALID_HANDLE_VALUE) {
-        printf("Error: Could not open database '%s'\n", current_database);
+        out_printf("Error: Could not open database '%s'\n", current_database);
         return;
     }
 
     int found = 0;
-    printf("Tables in database '%s':\n", current_database);
-    printf("+--------------------------+\n");
+    out_printf("Tables in database '%s':\n", current_database);
+    out_printf("+--------------------------+\n");
 
     do {
         // Skip "." and ".."
@@ -572,15 +844,15 @@ void show_tables() {
         if (ext && strcmp(ext, ".schema") == 0) {
             // Remove .schema extension for display
             *ext = '\0';
-            printf("| %-24s |\n", findFileData.cFileName);
+            out_printf("| %-24s |\n", findFileData.cFileName);
             found = 1;
         }
     } while (FindNextFile(hFind, &findFileData) != 0);
 
-    printf("+--------------------------+\n");
+    out_printf("+--------------------------+\n");
 
     if (!found) {
-        printf("No tables found.\n");
+        out_printf("No tables found.\n");
     }
 
     FindClose(hFind);
@@ -590,224 +862,1259 @@ void show_tables() {
    DATA OPERATIONS
    ============================================ */
 
-void execute_select(ASTNode* select) {
-    if (current_database[0] == '\0') {
-        printf("No database selected. Use 'USE <database>;' first.\n");
+/* Narrow [*low, *high] using the comparisons on the indexed column that are
+   ANDed together in the compiled WHERE clause. Returns 1 if any applied. */
+static int index_key_bounds(Predicate* predicate, int key_column, long long* low, long long* high) {
+    if (!predicate || key_column < 0) return 0;
+    
+    if (predicate->kind == PRED_AND) {
+        int left = index_key_bounds(predicate->left, key_column, low, high);
+        int right = index_key_bounds(predicate->right, key_column, low, high);
+        return left || right;
+    }
+    
+    if (predicate->kind == PRED_FALSE) {
+        // Nothing can match: collapse to an empty range
+        *low = 1;
+        *high = 0;
+        return 1;
+    }
+    
+    if (predicate->kind != PRED_COMPARE || predicate->column != key_column) {
+        return 0;
+    }
+    
+    long long value = predicate->int_value;
+    switch (predicate->op) {
+        case CMP_EQ:
+            if (value > *low) *low = value;
+            if (value < *high) *high = value;
+            break;
+        case CMP_GT:
+            if (value + 1 > *low) *low = value + 1;
+            break;
+        case CMP_GE:
+            if (value > *low) *low = value;
+            break;
+        case CMP_LT:
+            if (value - 1 < *high) *high = value - 1;
+            break;
+        case CMP_LE:
+            if (value < *high) *high = value;
+            break;
+    }
+    return 1;
+}
+
+/* Print one row if it passes the WHERE clause, returns 1 if printed */
+static int select_row(ResultSink* sink, const char* row, Predicate* predicate) {
+    // Evaluate WHERE clause if exists
+    if (predicate && !predicate_matches(predicate, row)) {
+        return 0;  // Skip this row
+    }
+    
+    result_row(sink, row);
+    return 1;
+}
+
+/* Point at a row inside the mapping, or copy it out of the buffer pool */
+static const char* fetch_row(MappedTable* map, int table_file, long row_offset,
+                             char* row_buffer, int row_size) {
+    if (map) {
+        return map->data + row_offset;
+    }
+    bp_read(table_file, row_offset, row_buffer, row_size);
+    return row_buffer;
+}
+
+/* Filter mapped rows [start, end) a block at a time with the vectorized
+   kernels and project the matches into the sink, until its LIMIT is
+   written; returns how many matched */
+static int scan_rows(ResultSink* sink, const char* rows, int row_size, int start, int end,
+                     Predicate* predicate) {
+    uint16_t selection[FILTER_BATCH_SIZE];
+    int rows_selected = 0;
+    for (int block_start = start; block_start < end && !result_done(sink); block_start += FILTER_BATCH_SIZE) {
+        int count = end - block_start < FILTER_BATCH_SIZE ? end - block_start : FILTER_BATCH_SIZE;
+        const char* block = rows + (long)block_start * row_size;
+        if (!predicate) {
+            result_rows(sink, block, row_size, NULL, count);
+            rows_selected += count;
+            continue;
+        }
+        int selected = filter_batch(predicate, block, row_size, count, selection);
+        result_rows(sink, block, row_size, selection, selected);
+        rows_selected += selected;
+    }
+    return rows_selected;
+}
+
+/* Column table version of scan_rows: the WHERE clause runs on the encoded
+   segments, and only the selected rows are stitched together. A block never
+   crosses a segment boundary, whatever row the range starts at. */
+static int scan_column_rows(ResultSink* sink, const ColumnScan* columns, int start, int end,
+                            Predicate* predicate) {
+    int row_size = columns->schema->row_size;
+    uint16_t selection[FILTER_BATCH_SIZE];
+    char* rows = malloc((size_t)FILTER_BATCH_SIZE * row_size + columns->scratch_size);
+    char* scratch = rows + (size_t)FILTER_BATCH_SIZE * row_size;
+    int rows_selected = 0;
+    int count;
+    for (int block_start = start; block_start < end && !result_done(sink); block_start += count) {
+        count = end - block_start < FILTER_BATCH_SIZE ? end - block_start : FILTER_BATCH_SIZE;
+        int segment_left = SEGMENT_ROWS - block_start % SEGMENT_ROWS;
+        if (count > segment_left) count = segment_left;
+        int selected = predicate ? column_scan_filter(columns, predicate, block_start, count, selection)
+                                 : count;
+        if (selected == 0) continue;
+        column_scan_rows(columns, block_start, count, predicate ? selection : NULL, selected, rows, scratch);
+        result_rows(sink, rows, row_size, NULL, selected);
+        rows_selected += selected;
+    }
+    free(rows);
+    return rows_selected;
+}
+
+/* Full scan split into morsels of SCAN_MORSEL_ROWS rows for the thread pool */
+typedef struct {
+    ResultSink* sink;
+    const char* rows;
+    const ColumnScan* columns;  // Column table, instead of mapped rows
+    int row_size;
+    int first_row;
+    int end_row;
+    Predicate* predicate;
+    ResultSink* parts;          // Each morsel's output until it is merged, or
+                                // each worker's partial aggregates or sort
+    int** ids;                  // Limited: each morsel's matching row ids
+    int* id_counts;
+    int limited;                // The sink has a LIMIT or OFFSET
+    int wanted;                 // Limited: most matches one morsel can need
+    int done;                   // Limited: the LIMIT is written, skip the rest
+    char* row_buffer;           // Limited: a column table row being written
+    char* finished;
+    int morsel_count;
+    int next_merge;             // Ordered: first morsel not yet written
+    int ordered;
+    Mutex lock;
+} ParallelScan;
+
+/* Ids of the rows in [start, end) that pass the WHERE clause, at most max */
+static int select_ids(const ParallelScan* scan, int start, int end, int max, int* ids) {
+    uint16_t selection[FILTER_BATCH_SIZE];
+    int found = 0;
+    for (int block_start = start; block_start < end && found < max; block_start += FILTER_BATCH_SIZE) {
+        int count = end - block_start < FILTER_BATCH_SIZE ? end - block_start : FILTER_BATCH_SIZE;
+        int selected = count;
+        if (!scan->predicate) {
+            for (int i = 0; i < count; i++) selection[i] = (uint16_t)i;
+        } else if (scan->columns) {
+            selected = column_scan_filter(scan->columns, scan->predicate, block_start, count, selection);
+        } else {
+            selected = filter_batch(scan->predicate, scan->rows + (long)block_start * scan->row_size,
+                                    scan->row_size, count, selection);
+        }
+        for (int i = 0; i < selected && found < max; i++) {
+            ids[found++] = block_start + selection[i];
+        }
+    }
+    return found;
+}
+
+/* Write a limited morsel's rows to the sink (under the scan lock) */
+static void write_ids(ParallelScan* scan, int morsel) {
+    for (int i = 0; i < scan->id_counts[morsel] && !result_done(scan->sink); i++) {
+        const char* row = scan->rows + (long)scan->ids[morsel][i] * scan->row_size;
+        if (scan->columns) {
+            column_scan_fetch(scan->columns, scan->ids[morsel][i], scan->row_buffer);
+            row = scan->row_buffer;
+        }
+        result_row(scan->sink, row);
+    }
+    free(scan->ids[morsel]);
+    scan->ids[morsel] = NULL;
+    if (result_done(scan->sink)) {
+        __atomic_store_n(&scan->done, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void scan_morsel(void* context, int morsel, int worker) {
+    ParallelScan* scan = context;
+    int start = scan->first_row + morsel * SCAN_MORSEL_ROWS;
+    int end = scan->end_row - start < SCAN_MORSEL_ROWS ? scan->end_row : start + SCAN_MORSEL_ROWS;
+
+    // Aggregates and sorts collect in the worker's part, merged at the end
+    if (scan->sink->aggregation || scan->sink->sorter) {
+        ResultSink* part = &scan->parts[worker];
+        if (scan->columns) {
+            scan_column_rows(part, scan->columns, start, end, scan->predicate);
+        } else {
+            scan_rows(part, scan->rows, scan->row_size, start, end, scan->predicate);
+        }
         return;
     }
+
+    // With a LIMIT or OFFSET only the first matches of a morsel can count:
+    // find their ids, and write them when the morsel's turn comes. Once the
+    // LIMIT is written, the remaining morsels are skipped.
+    if (scan->limited) {
+        int count = 0;
+        if (!__atomic_load_n(&scan->done, __ATOMIC_RELAXED)) {
+            int max = end - start < scan->wanted ? end - start : scan->wanted;
+            scan->ids[morsel] = malloc(sizeof(int) * (max ? max : 1));
+            count = select_ids(scan, start, end, max, scan->ids[morsel]);
+        }
+        mutex_lock(&scan->lock);
+        scan->id_counts[morsel] = count;
+        if (!scan->ordered) {
+            write_ids(scan, morsel);
+        } else {
+            scan->finished[morsel] = 1;
+            while (scan->next_merge < scan->morsel_count && scan->finished[scan->next_merge]) {
+                write_ids(scan, scan->next_merge++);
+            }
+        }
+        mutex_unlock(&scan->lock);
+        return;
+    }
+
+    // Filter and project into a private buffer, then hand it to the output
+    ResultSink* part = &scan->parts[morsel];
+    result_fork(scan->sink, part);
+    if (scan->columns) {
+        scan_column_rows(part, scan->columns, start, end, scan->predicate);
+    } else {
+        scan_rows(part, scan->rows, scan->row_size, start, end, scan->predicate);
+    }
+
+    mutex_lock(&scan->lock);
+    if (!scan->ordered) {
+        result_merge(scan->sink, part);
+    } else {
+        // Write out every finished morsel that is next in table order
+        scan->finished[morsel] = 1;
+        while (scan->next_merge < scan->morsel_count && scan->finished[scan->next_merge]) {
+            result_merge(scan->sink, &scan->parts[scan->next_merge++]);
+        }
+    }
+    mutex_unlock(&scan->lock);
+}
+
+/* Scan rows [first_row, end_row) on the thread pool */
+static int parallel_scan(ResultSink* sink, const char* rows, const ColumnScan* columns, int first_row,
+                         int end_row, int row_size, Predicate* predicate, Arena* arena) {
+    ParallelScan scan;
+    scan.sink = sink;
+    scan.rows = rows;
+    scan.columns = columns;
+    scan.row_size = row_size;
+    scan.first_row = first_row;
+    scan.end_row = end_row;
+    scan.predicate = predicate;
+    scan.morsel_count = (end_row - first_row + SCAN_MORSEL_ROWS - 1) / SCAN_MORSEL_ROWS;
+    scan.parts = arena_alloc(arena, sizeof(ResultSink) * scan.morsel_count);
+    scan.finished = arena_calloc(arena, scan.morsel_count);
+    scan.next_merge = 0;
+    scan.ordered = parallel_scan_ordered;
+    mutex_init(&scan.lock);
+
+    int workers = pool_threads();
+    int collect = sink->aggregation || sink->sorter;
+    if (collect) {
+        scan.parts = arena_alloc(arena, sizeof(ResultSink) * workers);
+        for (int i = 0; i < workers; i++) {
+            result_fork(sink, &scan.parts[i]);
+        }
+    }
+    scan.limited = !collect && (sink->limit >= 0 || sink->skip > 0);
+    if (scan.limited) {
+        long wanted = sink->limit >= 0 ? sink->skip + sink->limit : SCAN_MORSEL_ROWS;
+        scan.wanted = wanted < SCAN_MORSEL_ROWS ? (int)wanted : SCAN_MORSEL_ROWS;
+        scan.ids = arena_calloc(arena, sizeof(int*) * scan.morsel_count);
+        scan.id_counts = arena_calloc(arena, sizeof(int) * scan.morsel_count);
+        scan.done = 0;
+        scan.row_buffer = arena_alloc(arena, row_size);
+    }
     
+    long rows_before = sink->rows;
+    pool_run(scan.morsel_count, scan_morsel, &scan);
+    if (collect) {
+        for (int i = 0; i < workers; i++) {
+            result_merge(sink, &scan.parts[i]);
+        }
+    }
+    mutex_destroy(&scan.lock);
+    return (int)(sink->rows - rows_before);
+}
+
+/* Row count of a LIMIT or OFFSET, from its literal or its bound parameter */
+static int row_count_value(const char* keyword, const char* text, long* count) {
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < 0) {
+        out_printf("%s must be a non-negative integer\n", keyword);
+        return 0;
+    }
+    *count = value;
+    return 1;
+}
+
+/* Resolve a SELECT: schema, projected columns and the compiled WHERE */
+static QueryPlan* plan_select(ASTNode* select, Arena* arena) {
     // Get column list (left child) and table name (right child)
     ASTNode* column_list = select->left;
     ASTNode* table_node = select->right;
     
     if (!table_node || table_node->type != AST_IDENTIFIER) {
-        printf("Invalid SELECT statement\n");
-        return;
+        out_printf("Invalid SELECT statement\n");
+        return NULL;
     }
     
     const char* table_name = table_node->value;
     
-    // Get WHERE clause if it exists (right child of table node)
-    ASTNode* where_clause = table_node->right;
+    // A JOIN names its columns with their tables: qualify them all before
+    // anything looks them up in the joined schema
+    JoinPlan* join = NULL;
+    if (table_node->right && table_node->right->type == AST_JOIN) {
+        join = join_plan(select, current_database, arena);
+        if (!join) {
+            return NULL;
+        }
+    }
+    
+    // JOIN, WHERE, GROUP BY, ORDER BY, LIMIT and OFFSET clauses follow the table node
+    ASTNode* where_clause = NULL;
+    ASTNode* group_by = NULL;
+    ASTNode* order_by = NULL;
+    ASTNode* limit = NULL;
+    ASTNode* offset = NULL;
+    for (ASTNode* clause = table_node->right; clause; clause = clause->right) {
+        if (clause->type == AST_WHERE) where_clause = clause;
+        if (clause->type == AST_GROUP_BY) group_by = clause->left;
+        if (clause->type == AST_ORDER_BY) order_by = clause->left;
+        if (clause->type == AST_LIMIT) limit = clause->left;
+        if (clause->type == AST_OFFSET) offset = clause->left;
+    }
+    int distinct = *select->value != '\0';
     
     // Read schema
-    TableSchema* schema = read_schema(current_database, table_name);
+    TableSchema* schema = join ? &join->schema : catalog_get(current_database, table_name);
     if (!schema) {
-        printf("Table '%s' does not exist\n", table_name);
+        out_printf("Table '%s' does not exist\n", table_name);
+        return NULL;
+    }
+    
+    QueryPlan* plan = arena_calloc(arena, sizeof(QueryPlan));
+    plan->kind = AST_SELECT;
+    plan->table_name = table_name;
+    plan->schema = schema;
+    plan->join = join;
+    plan->limit = -1;
+    
+    if (limit) {
+        if (limit->type == AST_PARAM) {
+            plan->limit_param = limit->param;
+        } else if (!row_count_value("LIMIT", limit->value, &plan->limit)) {
+            return NULL;
+        }
+    }
+    if (offset) {
+        if (offset->type == AST_PARAM) {
+            plan->offset_param = offset->param;
+        } else if (!row_count_value("OFFSET", offset->value, &plan->offset)) {
+            return NULL;
+        }
+    }
+    
+    // Compile the WHERE clause once for the whole scan
+    if (where_clause) {
+        plan->predicate = compile_predicate(where_clause, schema, arena);
+        if (!plan->predicate) {
+            return NULL;
+        }
+    }
+    
+    // Determine which columns to display and where they sit in a row
+    plan->display_columns = arena_alloc(arena, sizeof(int) * schema->column_count);
+    plan->display_offsets = arena_alloc(arena, sizeof(long) * schema->column_count);
+    
+    // With aggregates or grouping, these are the columns they read
+    if (has_aggregates(column_list) || group_by || distinct) {
+        AggregatePlan* aggregates = aggregate_plan(column_list, group_by, distinct, schema, arena);
+        if (!aggregates) {
+            return NULL;
+        }
+        plan->aggregates = aggregates;
+        for (int i = 0; i < schema->column_count; i++) {
+            int used = 0;
+            for (int a = 0; a < aggregates->count; a++) used |= aggregates->specs[a].column == i;
+            for (int k = 0; k < aggregates->key_count; k++) used |= aggregates->keys[k].column == i;
+            if (used) {
+                plan->display_offsets[plan->display_count] = column_offset(schema, i);
+                plan->display_columns[plan->display_count++] = i;
+            }
+        }
+    } else {
+        for (int i = 0; i < schema->column_count; i++) {
+            if (should_select_column(column_list, schema->columns[i].column_name)) {
+                plan->display_offsets[plan->display_count] = column_offset(schema, i);
+                plan->display_columns[plan->display_count++] = i;
+            }
+        }
+    }
+    
+    // ORDER BY sorts the table rows, or the grouped result rows
+    if (order_by) {
+        plan->order = sort_plan(order_by, plan->aggregates ? &plan->aggregates->result : schema, arena);
+        if (!plan->order) {
+            return NULL;
+        }
+    }
+    
+    return plan;
+}
+
+/* Copy of a schema for a scan that runs outside the engine lock, where a
+   concurrent DROP TABLE may free the catalog's */
+static TableSchema* copy_schema(const TableSchema* schema, Arena* arena) {
+    TableSchema* copy = arena_alloc(arena, sizeof(TableSchema));
+    *copy = *schema;
+    copy->columns = arena_alloc(arena, sizeof(ColumnSchema) * schema->column_count);
+    memcpy(copy->columns, schema->columns, sizeof(ColumnSchema) * schema->column_count);
+    return copy;
+}
+
+/* SELECT over FROM a JOIN b: the joined rows go through the same sink as
+   a scan's. Both tables are read under the engine lock. */
+static void run_join(QueryPlan* plan, Arena* arena) {
+    TableSchema* schema = plan->schema;
+    AggregatePlan* aggregates = plan->aggregates;
+    SortPlan* order = plan->order;
+    long limit = plan->limit;
+    long offset = plan->offset;
+    
+    // Only the columns the statement reads are mapped from column tables
+    char* needed = arena_calloc(arena, schema->column_count);
+    for (int i = 0; i < plan->display_count; i++) {
+        needed[plan->display_columns[i]] = 1;
+    }
+    predicate_columns(plan->predicate, needed);
+    for (int k = 0; order && !aggregates && k < order->key_count; k++) {
+        needed[order->keys[k].column] = 1;
+    }
+    
+    JoinScan scan;
+    if (!join_open(&scan, plan->join, current_database, needed, arena)) {
         return;
     }
+    predicate_set_overflow(plan->predicate, scan.overflow);
+    
+    ResultSink sink;
+    if (aggregates) {
+        result_begin(&sink, &aggregates->result, aggregates->result_columns, aggregates->result_offsets,
+                     aggregates->result.column_count, arena);
+        sink.aggregation = aggregation_new(aggregates, current_database, work_memory());
+    } else {
+        result_begin(&sink, schema, plan->display_columns, plan->display_offsets, plan->display_count,
+                     arena);
+    }
+    sink.overflow = scan.overflow;
+    if (order) {
+        sink.sorter = sorter_new(order, aggregates ? aggregates->result.row_size : schema->row_size,
+                                 limit >= 0 ? limit + offset : -1, current_database, work_memory());
+    }
+    sink.skip = offset;
+    sink.limit = limit;
+    
+    long rows_selected = join_rows(&scan, plan->predicate, &sink);
+    
+    result_end(&sink);
+    join_close(&scan);
+    rows_processed += rows_selected;
+}
+
+static void run_select(QueryPlan* plan, Arena* arena) {
+    if (plan->join) {
+        run_join(plan, arena);
+        return;
+    }
+    
+    TableSchema* schema = plan->schema;
+    Predicate* predicate = plan->predicate;
+    int* display_columns = plan->display_columns;
+    long* display_offsets = plan->display_offsets;
+    int display_count = plan->display_count;
+    AggregatePlan* aggregates = plan->aggregates;
+    SortPlan* order = plan->order;
+    long limit = plan->limit;
+    long offset = plan->offset;
     
     // Open table file
     char table_path[256];
-    snprintf(table_path, sizeof(table_path), "databases\\%s\\%s.table", current_database, table_name);
+    snprintf(table_path, sizeof(table_path), "databases\\%s\\%s.table", current_database, plan->table_name);
     
-    FILE* table_file = fopen(table_path, "rb");
-    if (!table_file) {
-        perror("Failed to open table file");
-        free_schema(schema);
+    int table_file = bp_open(table_path);
+    if (table_file == -1) {
+        out_perror("Failed to open table file");
         return;
     }
     
-    // Read row count
+    // Read row count once: the scan sees exactly these rows, however many
+    // are appended while it runs
     int row_count;
-    fread(&row_count, sizeof(int), 1, table_file);
+    bp_read(table_file, 0, &row_count, sizeof(int));
+    
+    // Unfiltered COUNT(*) is the row count itself
+    if (aggregates && !predicate && aggregate_plan_counts_only(aggregates)) {
+        ResultSink sink;
+        result_begin(&sink, &aggregates->result, aggregates->result_columns, aggregates->result_offsets,
+                     aggregates->result.column_count, arena);
+        sink.aggregation = aggregation_new(aggregates, current_database, work_memory());
+        if (order) {
+            sink.sorter = sorter_new(order, aggregates->result.row_size, limit >= 0 ? limit + offset : -1,
+                                     current_database, work_memory());
+        }
+        sink.skip = offset;
+        sink.limit = limit;
+        aggregation_add_count(sink.aggregation, row_count);
+        result_end(&sink);
+        bp_release(table_file);
+        rows_processed += row_count;
+        return;
+    }
     
     // Calculate row size
     int row_size = calculate_row_size(schema);
     
-    // Determine which columns to display
-    int* display_columns = malloc(sizeof(int) * schema->column_count);
-    int display_count = 0;
+    // Unfiltered, ungrouped and unsorted rows come out in table order: the
+    // OFFSET is a row position to start from and the LIMIT ends the range
+    int first_row = 0;
+    int end_row = row_count;
+    if (!predicate && !aggregates && !order) {
+        first_row = offset < row_count ? (int)offset : row_count;
+        if (limit >= 0 && limit < end_row - first_row) {
+            end_row = first_row + (int)limit;
+        }
+        offset = 0;
+        limit = -1;
+    }
     
-    for (int i = 0; i < schema->column_count; i++) {
-        if (should_select_column(column_list, schema->columns[i].column_name)) {
-            display_columns[display_count++] = i;
+    // Scan rows in place from a read-only mapping of the table file. Pending
+    // writes are flushed first so the mapping sees them; if the file cannot
+    // be mapped, rows are copied out of the buffer pool one at a time.
+    // A column table maps just the columns the statement reads instead.
+    int columnar = schema->storage == STORAGE_COLUMN;
+    MappedTable* map = NULL;
+    ColumnScan columns;
+    if (columnar) {
+        char* needed = arena_calloc(arena, schema->column_count);
+        for (int i = 0; i < display_count; i++) {
+            needed[display_columns[i]] = 1;
+        }
+        predicate_columns(predicate, needed);
+        for (int k = 0; order && !aggregates && k < order->key_count; k++) {
+            needed[order->keys[k].column] = 1;
+        }
+        if (!column_scan_open(&columns, current_database, plan->table_name, schema, needed, row_count,
+                              arena)) {
+            out_printf("Failed to map column files for '%s'\n", plan->table_name);
+            bp_release(table_file);
+            return;
+        }
+    } else {
+        bp_flush(table_file);
+        map = table_map(table_path, sizeof(int) + (long)end_row * row_size);
+    }
+    char* row_buffer = map ? NULL : arena_alloc(arena, row_size);
+    
+    // Long varchar values are read in place from the overflow file, which
+    // only grows too: every value the snapshot's rows point to is covered
+    MappedTable* overflow_map = NULL;
+    if (schema->overflow_columns > 0) {
+        char overflow_path[256];
+        snprintf(overflow_path, sizeof(overflow_path), "databases\\%s\\%s.ovf", current_database, plan->table_name);
+        int overflow_file = bp_open(overflow_path);
+        uint64_t overflow_used = 0;
+        if (overflow_file != -1) {
+            bp_read(overflow_file, 0, &overflow_used, sizeof(uint64_t));
+            bp_flush(overflow_file);
+            bp_release(overflow_file);
+            overflow_map = table_map(overflow_path, (long)overflow_used);
+        }
+        if (!overflow_map) {
+            out_printf("Failed to map overflow file for '%s'\n", plan->table_name);
+            table_release(map);
+            if (columnar) column_scan_close(&columns);
+            bp_release(table_file);
+            return;
         }
     }
     
-    // Print column headers
-    printf("+");
-    for (int i = 0; i < display_count; i++) {
-        printf("----------------+");
+    // Use the B-tree when the WHERE clause bounds the indexed column, or
+    // when the rows are wanted in its order
+    int index_order = 0;    // 1 ascending, -1 descending, 0 not read in index order
+    long long low = INT_MIN;
+    long long high = INT_MAX;
+    BTree* index = predicate || (order && !aggregates) ? load_index(current_database, plan->table_name) : NULL;
+    if (index) {
+        int key_column = index->header.key_column;
+        if (order && !aggregates && order->key_count == 1 && order->keys[0].column == key_column) {
+            index_order = order->keys[0].descending ? -1 : 1;
+        }
+        if (index_key_bounds(predicate, key_column, &low, &high) || index_order) {
+            if (low < INT_MIN) low = INT_MIN;
+            if (high > INT_MAX) high = INT_MAX;
+        } else {
+            btree_close(index);
+            index = NULL;
+        }
     }
-    printf("\n|");
     
-    for (int i = 0; i < display_count; i++) {
-        printf(" %-14s |", schema->columns[display_columns[i]].column_name);
+    // A full scan of the mapping needs nothing else from the engine: it runs
+    // on private copies of the plan with the engine lock released, so other
+    // sessions can insert (or reuse this cached plan) meanwhile. Column
+    // files are rewritten in place when an open segment is encoded, so a
+    // column table is scanned under the lock.
+    int full_scan = !index && (map || columnar);
+    int snapshot = full_scan && !columnar;
+    int parallel = full_scan && end_row - first_row > SCAN_MORSEL_ROWS && pool_threads() > 1;
+    if (snapshot) {
+        schema = copy_schema(schema, arena);
+        predicate = predicate_copy(predicate, arena);
+        predicate_set_overflow(predicate, overflow_map ? overflow_map->data : NULL);
+        display_columns = arena_alloc(arena, sizeof(int) * display_count);
+        display_offsets = arena_alloc(arena, sizeof(long) * display_count);
+        memcpy(display_columns, plan->display_columns, sizeof(int) * display_count);
+        memcpy(display_offsets, plan->display_offsets, sizeof(long) * display_count);
+        if (aggregates) {
+            aggregates = aggregate_plan_copy(aggregates, arena);
+        }
+        if (order) {
+            order = sort_plan_copy(order, arena);
+        }
+        engine_unlock();
+    } else {
+        predicate_set_overflow(predicate, overflow_map ? overflow_map->data : NULL);
     }
-    printf("\n+");
     
-    for (int i = 0; i < display_count; i++) {
-        printf("----------------+");
+    // Column headers, then rows straight from the row bytes into the sink,
+    // or into the aggregates and their result rows, through the sort
+    ResultSink sink;
+    if (aggregates) {
+        result_begin(&sink, &aggregates->result, aggregates->result_columns, aggregates->result_offsets,
+                     aggregates->result.column_count, arena);
+        sink.aggregation = aggregation_new(aggregates, current_database, work_memory());
+    } else {
+        result_begin(&sink, schema, display_columns, display_offsets, display_count, arena);
     }
-    printf("\n");
+    sink.overflow = overflow_map ? overflow_map->data : NULL;
+    if (order && !index_order) {
+        // The sort keeps the rows the OFFSET skips as well
+        sink.sorter = sorter_new(order, aggregates ? aggregates->result.row_size : row_size,
+                                 limit >= 0 ? limit + offset : -1, current_database, work_memory());
+    }
+    sink.skip = offset;
+    sink.limit = limit;
     
     // Read and print rows
     int rows_selected = 0;
-    for (int row = 0; row < row_count; row++) {
-        long row_offset = sizeof(int) + (row * row_size);
-        
-        // Evaluate WHERE clause if exists
-        if (where_clause && !evaluate_condition(where_clause, schema, table_file, row_offset)) {
-            continue;  // Skip this row
+    
+    if (index) {
+        // Walk the leaf chain from the lower bound to the upper bound, or for
+        // a descending order collect the row ids and read them backwards,
+        // until the LIMIT is written
+        int* row_ids = NULL;
+        int match_count = 0;
+        BTreeCursor cursor;
+        if (index_order < 0) {
+            match_count = low <= high ? btree_search_range(index, (int)low, (int)high, &row_ids) : 0;
+        } else {
+            btree_seek(index, (int)low, &cursor);
         }
-        
-        // Seek to the beginning of this row
-        fseek(table_file, row_offset, SEEK_SET);
-        
-        // Read all column values into an array first
-        char** row_values = malloc(sizeof(char*) * schema->column_count);
-        for (int col = 0; col < schema->column_count; col++) {
-            row_values[col] = malloc(256);
-            read_value(table_file, schema->columns[col].data_type, row_values[col], 256);
+        for (int n = 0; !result_done(&sink); n++) {
+            int row_id;
+            if (index_order < 0) {
+                if (n == match_count) break;
+                row_id = row_ids[match_count - 1 - n];
+            } else {
+                BTreeEntry entry;
+                if (!btree_cursor_next(&cursor, &entry) || entry.key > high) break;
+                row_id = entry.row_id;
+            }
+            if (row_id >= row_count) continue;
+            const char* row = row_buffer;
+            if (columnar) {
+                column_scan_fetch(&columns, row_id, row_buffer);
+            } else {
+                long row_offset = sizeof(int) + ((long)row_id * row_size);
+                row = fetch_row(map, table_file, row_offset, row_buffer, row_size);
+            }
+            rows_selected += select_row(&sink, row, predicate);
         }
-        
-        // Now print only the columns that should be displayed
-        printf("|");
-        for (int i = 0; i < display_count; i++) {
-            int col_index = display_columns[i];
-            printf(" %-14s |", row_values[col_index]);
+        if (index_order < 0) {
+            free(row_ids);
+        } else {
+            btree_cursor_close(&cursor);
         }
-        printf("\n");
-        
-        // Free row values
-        for (int col = 0; col < schema->column_count; col++) {
-            free(row_values[col]);
+        btree_close(index);
+    } else if (parallel) {
+        // Large full scan: morsels on the thread pool, merged into the sink
+        rows_selected = parallel_scan(&sink, map ? map->data + sizeof(int) : NULL, columnar ? &columns : NULL,
+                                      first_row, end_row, row_size, predicate, arena);
+    } else if (columnar) {
+        rows_selected = scan_column_rows(&sink, &columns, first_row, end_row, predicate);
+    } else if (map && predicate) {
+        rows_selected = scan_rows(&sink, map->data + sizeof(int), row_size, first_row, end_row, predicate);
+    } else {
+        for (int row_id = first_row; row_id < end_row && !result_done(&sink); row_id++) {
+            long row_offset = sizeof(int) + ((long)row_id * row_size);
+            const char* row = fetch_row(map, table_file, row_offset, row_buffer, row_size);
+            rows_selected += select_row(&sink, row, predicate);
         }
-        free(row_values);
-        
-        rows_selected++;
     }
     
-    printf("+");
-    for (int i = 0; i < display_count; i++) {
-        printf("----------------+");
+    result_end(&sink);
+    table_release(map);
+    table_release(overflow_map);
+    if (columnar) {
+        column_scan_close(&columns);
+    }
+    if (snapshot) {
+        engine_lock();
+    }
+    bp_release(table_file);
+    rows_processed += rows_selected;
+}
+
+void execute_select(ASTNode* select, Arena* arena) {
+    QueryPlan* plan = plan_query(select, arena);
+    if (plan) {
+        run_query(plan, NULL, arena);
+    }
+}
+
+/*
+ * Batched row appender shared by INSERT and LOAD DATA. Rows are encoded
+ * into one contiguous buffer and written with a single bp_write per batch;
+ * the row_count header is updated once per batch and the batch's index
+ * keys are sorted before insertion so they walk the B-tree leaves in order.
+ * Each batch is logged and committed in the WAL before it is applied, and
+ * closing the appender waits for that commit to be durable. Long varchar
+ * values collect in a side buffer and are appended to the overflow file
+ * with their batch. A column table's batch is split into its column files
+ * (column_store.h) instead of being written as rows.
+ */
+#define APPEND_BATCH_ROWS 4096
+#define APPEND_OVERFLOW_BYTES (4L * 1024 * 1024)   // Flush a batch early past this
+
+typedef struct {
+    TableSchema* schema;
+    const char* table_name;
+    Wal* wal;               // NULL if the log could not be opened
+    uint64_t commit_lsn;    // Commit record of the last batch
+    int table_file;
+    BTree* index;
+    int key_offset;         // Byte offset of the indexed column, -1 if none
+    int row_count;          // Rows covered by the on-disk header
+    char* rows;             // Encoded rows not yet written
+    BTreeEntry* keys;       // Index entries for those rows
+    int pending;
+    int overflow_file;      // -1 if the table has no long varchar columns
+    uint64_t overflow_used; // Overflow file bytes covered by its header
+    char* overflow;         // Long values of the pending rows
+    size_t overflow_length;
+    size_t overflow_capacity;
+} TableAppender;
+
+static int compare_entries(const void* a, const void* b) {
+    const BTreeEntry* x = a;
+    const BTreeEntry* y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->row_id > y->row_id) - (x->row_id < y->row_id);
+}
+
+static int appender_open(TableAppender* appender, const char* table_name, TableSchema* schema,
+                         Arena* arena) {
+    memset(appender, 0, sizeof(TableAppender));
+    appender->schema = schema;
+    appender->table_name = table_name;
+    appender->wal = database_wal(current_database);
+
+    // Load the index before appending so a rebuild cannot pick up new rows twice
+    appender->index = load_index(current_database, table_name);
+    appender->key_offset = -1;
+    if (appender->index && appender->index->header.key_column >= 0 &&
+        appender->index->header.key_column < schema->column_count) {
+        appender->key_offset = schema->columns[appender->index->header.key_column].offset;
+    }
+
+    char table_path[256];
+    snprintf(table_path, sizeof(table_path), "databases\\%s\\%s.table", current_database, table_name);
+
+    appender->table_file = bp_open(table_path);
+    if (appender->table_file == -1) {
+        out_perror("Failed to open table file");
+        btree_close(appender->index);
+        return 0;
+    }
+
+    bp_read(appender->table_file, 0, &appender->row_count, sizeof(int));
+    
+    appender->overflow_file = -1;
+    if (schema->overflow_columns > 0) {
+        char overflow_path[256];
+        snprintf(overflow_path, sizeof(overflow_path), "databases\\%s\\%s.ovf", current_database, table_name);
+        appender->overflow_file = bp_open(overflow_path);
+        if (appender->overflow_file == -1) {
+            out_perror("Failed to open overflow file");
+            btree_close(appender->index);
+            bp_release(appender->table_file);
+            return 0;
+        }
+        bp_read(appender->overflow_file, 0, &appender->overflow_used, sizeof(uint64_t));
     }
-    printf("\n");
-    
-    printf("%d row(s) selected\n", rows_selected);
     
-    free(display_columns);
-    fclose(table_file);
-    free_schema(schema);
+    appender->rows = arena_alloc(arena, (size_t)APPEND_BATCH_ROWS * schema->row_size);
+    appender->keys = arena_alloc(arena, APPEND_BATCH_ROWS * sizeof(BTreeEntry));
+    return 1;
 }
 
-void execute_insert(ASTNode* insert) {
-    if (current_database[0] == '\0') {
-        printf("No database selected. Use 'USE <database>;' first.\n");
-        return;
+static void appender_flush_batch(TableAppender* appender) {
+    if (appender->pending == 0) return;
+
+    int row_size = appender->schema->row_size;
+    if (appender->key_offset >= 0) {
+        for (int i = 0; i < appender->pending; i++) {
+            memcpy(&appender->keys[i].key, appender->rows + (long)i * row_size + appender->key_offset,
+                   sizeof(int));
+            appender->keys[i].row_id = appender->row_count + i;
+        }
+        qsort(appender->keys, appender->pending, sizeof(BTreeEntry), compare_entries);
+    }
+
+    // A column table's batch becomes writes to its column files
+    int columnar = appender->schema->storage == STORAGE_COLUMN;
+    ColumnWrites column_writes = { NULL, 0, 0 };
+    if (columnar) {
+        column_plan_append(current_database, appender->table_name, appender->schema,
+                           appender->row_count, appender->rows, appender->pending, &column_writes);
+    }
+
+    // Log the batch before any of its pages can reach disk
+    if (appender->wal) {
+        if (appender->overflow_length > 0) {
+            wal_log_overflow(appender->wal, appender->table_name, appender->overflow_used,
+                             appender->overflow, (uint32_t)appender->overflow_length);
+        }
+        if (columnar) {
+            for (int i = 0; i < column_writes.count; i++) {
+                ColumnWrite* write = &column_writes.writes[i];
+                wal_log_column(appender->wal, appender->table_name, write->column, write->offset,
+                               write->data, write->length);
+            }
+        } else {
+            wal_log_rows(appender->wal, appender->table_name, appender->row_count, row_size,
+                         appender->rows, appender->pending);
+        }
+        if (appender->key_offset >= 0) {
+            wal_log_index(appender->wal, appender->table_name, appender->keys, appender->pending);
+        }
+        appender->commit_lsn = wal_log_commit(appender->wal);
+    }
+
+    // Long values first, so no row points past the overflow file's end
+    if (appender->overflow_length > 0) {
+        bp_write(appender->overflow_file, (long)appender->overflow_used, appender->overflow,
+                 appender->overflow_length);
+        appender->overflow_used += appender->overflow_length;
+        bp_write(appender->overflow_file, 0, &appender->overflow_used, sizeof(uint64_t));
+        appender->overflow_length = 0;
     }
     
+    if (columnar) {
+        // Also writes the row count header
+        column_apply_writes(current_database, appender->table_name, &column_writes);
+    } else {
+        bp_write(appender->table_file, sizeof(int) + (long)appender->row_count * row_size,
+                 appender->rows, (size_t)appender->pending * row_size);
+    }
+
+    if (appender->key_offset >= 0) {
+        for (int i = 0; i < appender->pending; i++) {
+            btree_insert(appender->index, appender->keys[i].key, appender->keys[i].row_id);
+        }
+    }
+
+    appender->row_count += appender->pending;
+    if (!columnar) {
+        bp_write(appender->table_file, 0, &appender->row_count, sizeof(int));
+    }
+    appender->pending = 0;
+
+    if (appender->wal) {
+        wal_maybe_checkpoint(appender->wal);
+    }
+}
+
+/* Zeroed slot for the next row; the caller encodes into it */
+static char* appender_next_row(TableAppender* appender) {
+    if (appender->pending == APPEND_BATCH_ROWS || appender->overflow_length > APPEND_OVERFLOW_BYTES) {
+        appender_flush_batch(appender);
+    }
+    char* row = appender->rows + (long)appender->pending * appender->schema->row_size;
+    memset(row, 0, appender->schema->row_size);
+    appender->pending++;
+    return row;
+}
+
+/* Encode one value of the current row; returns where the next one goes.
+   A long varchar's bytes go to the overflow buffer, and its descriptor
+   gets the offset they will have once the batch is written. */
+static char* appender_put(TableAppender* appender, char* dest, const char* value,
+                          const ColumnSchema* column) {
+    int width = write_value(dest, value, column);
+    size_t length = column->overflow ? strlen(value) : 0;
+    if (length > VARCHAR_DESCRIPTOR_INLINE) {
+        if (appender->overflow_length + length > appender->overflow_capacity) {
+            size_t capacity = appender->overflow_capacity ? appender->overflow_capacity : 64 * 1024;
+            while (appender->overflow_length + length > capacity) capacity *= 2;
+            appender->overflow = realloc(appender->overflow, capacity);
+            appender->overflow_capacity = capacity;
+        }
+        uint64_t offset = appender->overflow_used + appender->overflow_length;
+        memcpy(dest + 8, &offset, sizeof(offset));
+        memcpy(appender->overflow + appender->overflow_length, value, length);
+        appender->overflow_length += length;
+    }
+    return dest + width;
+}
+
+static void appender_close(TableAppender* appender) {
+    appender_flush_batch(appender);
+    btree_close(appender->index);
+    bp_release(appender->table_file);
+    bp_release(appender->overflow_file);
+    free(appender->overflow);
+
+    // Durable once the log is; the dirty pages stay cached for the next
+    // statement. A shared engine waits after releasing its lock.
+    if (appender->wal && engine_shared) {
+        defer_commit(appender->wal, appender->commit_lsn);
+    } else if (appender->wal) {
+        wal_commit(appender->wal, appender->commit_lsn);
+    } else {
+        bp_sync_all();
+    }
+}
+
+static void print_expected_columns(TableSchema* schema, const char* table_name) {
+    out_printf("Error: Table '%s' expects %d values (", table_name, schema->column_count);
+    for (int i = 0; i < schema->column_count; i++) {
+        out_printf("%s", schema->columns[i].column_name);
+        if (i < schema->column_count - 1) out_printf(", ");
+    }
+    out_printf(")");
+}
+
+/* Resolve an INSERT: schema, and tuples checked against the column count */
+static QueryPlan* plan_insert(ASTNode* insert, Arena* arena) {
     // Get table name from AST
     if (!insert->right || insert->right->type != AST_IDENTIFIER) {
-        printf("Invalid INSERT statement\n");
-        return;
+        out_printf("Invalid INSERT statement\n");
+        return NULL;
     }
     
     const char* table_name = insert->right->value;
     
     // Read schema
-    TableSchema* schema = read_schema(current_database, table_name);
+    TableSchema* schema = catalog_get(current_database, table_name);
     if (!schema) {
-        printf("Table '%s' does not exist\n", table_name);
-        return;
+        out_printf("Table '%s' does not exist\n", table_name);
+        return NULL;
     }
     
-    // Get values from AST (stored in table_node->right)
-    ASTNode* values_head = insert->right->right;
-    if (!values_head) {
-        printf("No values provided for INSERT\n");
-        free_schema(schema);
-        return;
+    // Get tuples from AST (stored in table_node->right)
+    ASTNode* tuples = insert->right->right;
+    if (!tuples) {
+        out_printf("No values provided for INSERT\n");
+        return NULL;
     }
     
-    // Count values
-    int value_count = 0;
-    ASTNode* temp = values_head;
-    while (temp) {
-        value_count++;
-        temp = temp->right;
+    // Validate every tuple before writing anything
+    int tuple_number = 0;
+    for (ASTNode* tuple = tuples; tuple; tuple = tuple->right) {
+        tuple_number++;
+        int value_count = 0;
+        for (ASTNode* value = tuple->left; value; value = value->right) {
+            value_count++;
+        }
+        if (value_count != schema->column_count) {
+            print_expected_columns(schema, table_name);
+            out_printf(", but row %d has %d\n", tuple_number, value_count);
+            return NULL;
+        }
     }
     
-    // Validate value count matches column count
-    if (value_count != schema->column_count) {
-        printf("Error: Table '%s' expects %d values (", table_name, schema->column_count);
+    QueryPlan* plan = arena_calloc(arena, sizeof(QueryPlan));
+    plan->kind = AST_INSERT;
+    plan->table_name = table_name;
+    plan->schema = schema;
+    plan->tuples = tuples;
+    plan->tuple_count = tuple_number;
+    return plan;
+}
+
+static void run_insert(QueryPlan* plan, const char** params, Arena* arena) {
+    TableSchema* schema = plan->schema;
+    
+    // VARCHAR(n) values must fit before anything is written
+    for (ASTNode* tuple = plan->tuples; tuple; tuple = tuple->right) {
+        ASTNode* current_value = tuple->left;
         for (int i = 0; i < schema->column_count; i++) {
-            printf("%s", schema->columns[i].column_name);
-            if (i < schema->column_count - 1) printf(", ");
+            const char* text = current_value->type == AST_PARAM ? params[current_value->param - 1]
+                                                                : current_value->value;
+            if (!value_fits(&schema->columns[i], text)) {
+                out_printf("Value too long for column '%s' (%s)\n", schema->columns[i].column_name,
+                           schema->columns[i].data_type);
+                return;
+            }
+            current_value = current_value->right;
         }
-        printf("), but got %d\n", value_count);
-        free_schema(schema);
-        return;
     }
     
-    // Open table file for reading and writing
-    char table_path[256];
-    snprintf(table_path, sizeof(table_path), "databases\\%s\\%s.table", current_database, table_name);
-    
-    FILE* table_file = fopen(table_path, "r+b");
-    if (!table_file) {
-        perror("Failed to open table file");
-        free_schema(schema);
+    TableAppender appender;
+    if (!appender_open(&appender, plan->table_name, schema, arena)) {
         return;
     }
     
-    // Read current row count
-    int row_count;
-    fread(&row_count, sizeof(int), 1, table_file);
+    // Encode values in order into the batch
+    for (ASTNode* tuple = plan->tuples; tuple; tuple = tuple->right) {
+        char* cursor = appender_next_row(&appender);
+        ASTNode* current_value = tuple->left;
+        for (int i = 0; i < schema->column_count; i++) {
+            const char* text = current_value->type == AST_PARAM ? params[current_value->param - 1]
+                                                                : current_value->value;
+            cursor = appender_put(&appender, cursor, text, &schema->columns[i]);
+            current_value = current_value->right;
+        }
+    }
     
-    // Seek to end of file to append new row
-    fseek(table_file, 0, SEEK_END);
+    appender_close(&appender);
     
-    // Write values in order
-    ASTNode* current_value = values_head;
-    for (int i = 0; i < schema->column_count; i++) {
-        if (!current_value) break;
-        
-        const char* value_str = current_value->value;
-        const char* data_type = schema->columns[i].data_type;
-        
-        write_value(table_file, value_str, data_type);
-        
-        current_value = current_value->right;
+    rows_processed += plan->tuple_count;
+    out_printf("%d row(s) inserted into '%s'\n", plan->tuple_count, plan->table_name);
+}
+
+void execute_insert(ASTNode* insert, Arena* arena) {
+    QueryPlan* plan = plan_query(insert, arena);
+    if (plan) {
+        run_query(plan, NULL, arena);
+    }
+}
+
+/* Highest parameter number anywhere in the statement */
+static int count_params(ASTNode* node) {
+    int count = 0;
+    for (; node; node = node->right) {
+        if (node->type == AST_PARAM && node->param > count) {
+            count = node->param;
+        }
+        int nested = count_params(node->left);
+        if (nested > count) {
+            count = nested;
+        }
+    }
+    return count;
+}
+
+QueryPlan* plan_query(ASTNode* statement, Arena* arena) {
+    if (current_database[0] == '\0') {
+        out_printf("No database selected. Use 'USE <database>;' first.\n");
+        return NULL;
     }
     
-    // Update row count
-    row_count++;
-    fseek(table_file, 0, SEEK_SET);
-    fwrite(&row_count, sizeof(int), 1, table_file);
+    QueryPlan* plan;
+    switch (statement->type) {
+        case AST_SELECT: plan = plan_select(statement, arena); break;
+        case AST_INSERT: plan = plan_insert(statement, arena); break;
+        default:
+            out_printf("Only SELECT and INSERT can be planned\n");
+            return NULL;
+    }
     
-    fclose(table_file);
-    free_schema(schema);
+    if (plan) {
+        plan->param_count = count_params(statement);
+    }
+    return plan;
+}
+
+void run_query(QueryPlan* plan, const char** params, Arena* arena) {
+    if (plan->param_count > 0 && !params) {
+        out_printf("Statement has ? parameters; use PREPARE and EXECUTE to supply them\n");
+        return;
+    }
     
-    printf("1 row inserted into '%s'\n", table_name);
+    if (plan->kind == AST_SELECT) {
+        if (params) {
+            predicate_bind(plan->predicate, params);
+            if (plan->limit_param &&
+                !row_count_value("LIMIT", params[plan->limit_param - 1], &plan->limit)) {
+                return;
+            }
+            if (plan->offset_param &&
+                !row_count_value("OFFSET", params[plan->offset_param - 1], &plan->offset)) {
+                return;
+            }
+        }
+        run_select(plan, arena);
+    } else {
+        run_insert(plan, params, arena);
+    }
+}
+
+/* Split one CSV line in place. Fields may be double-quoted with "" as an
+   escaped quote. Returns the number of fields, or -1 if there are more
+   than max_fields. */
+static int split_csv_line(char* line, char** fields, int max_fields) {
+    int count = 0;
+    char* p = line;
+
+    while (1) {
+        if (count == max_fields) return -1;
+
+        char* out = p;
+        fields[count++] = out;
+
+        if (*p == '"') {
+            p++;
+            while (*p) {
+                if (*p == '"') {
+                    if (p[1] == '"') {
+                        *out++ = '"';
+                        p += 2;
+                        continue;
+                    }
+                    p++;
+                    break;
+                }
+                *out++ = *p++;
+            }
+            // Ignore anything between the closing quote and the separator
+            while (*p && *p != ',') p++;
+        } else {
+            while (*p && *p != ',') {
+                *out++ = *p++;
+            }
+        }
+
+        if (*p == ',') {
+            *out = '\0';
+            p++;
+        } else {
+            *out = '\0';
+            return count;
+        }
+    }
+}
+
+void execute_load(ASTNode* load, Arena* arena) {
+    if (current_database[0] == '\0') {
+        out_printf("No database selected. Use 'USE <database>;' first.\n");
+        return;
+    }
+
+    if (!load->right || load->right->type != AST_IDENTIFIER) {
+        out_printf("Invalid LOAD DATA statement\n");
+        return;
+    }
+
+    const char* table_name = load->right->value;
+    TableSchema* schema = catalog_get(current_database, table_name);
+    if (!schema) {
+        out_printf("Table '%s' does not exist\n", table_name);
+        return;
+    }
+
+    FILE* csv = fopen(load->value, "r");
+    if (!csv) {
+        out_perror("Failed to open data file");
+        return;
+    }
+    setvbuf(csv, NULL, _IOFBF, 1 << 20);
+
+    TableAppender appender;
+    if (!appender_open(&appender, table_name, schema, arena)) {
+        fclose(csv);
+        return;
+    }
+
+    char** fields = arena_alloc(arena, schema->column_count * sizeof(char*));
+    size_t line_capacity = 4096;
+    char* line = malloc(line_capacity);
+    long line_number = 0;
+    int loaded = 0;
+    int skipped = 0;
+
+    while (fgets(line, (int)line_capacity, csv)) {
+        size_t length = strlen(line);
+
+        // Grow the buffer until the whole line is in it
+        while (length == line_capacity - 1 && line[length - 1] != '\n') {
+            line_capacity *= 2;
+            line = realloc(line, line_capacity);
+            if (!fgets(line + length, (int)(line_capacity - length), csv)) break;
+            length += strlen(line + length);
+        }
+
+        line_number++;
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
+        if (length == 0) continue;
+
+        int field_count = split_csv_line(line, fields, schema->column_count);
+        if (field_count != schema->column_count) {
+            if (skipped++ < 10) {
+                out_printf("Line %ld: expected %d fields, skipped\n", line_number, schema->column_count);
+            }
+            continue;
+        }
+
+        int too_long = -1;
+        for (int i = 0; i < schema->column_count && too_long < 0; i++) {
+            if (!value_fits(&schema->columns[i], fields[i])) too_long = i;
+        }
+        if (too_long >= 0) {
+            if (skipped++ < 10) {
+                out_printf("Line %ld: value too long for column '%s', skipped\n", line_number,
+                           schema->columns[too_long].column_name);
+            }
+            continue;
+        }
+
+        char* cursor = appender_next_row(&appender);
+        for (int i = 0; i < schema->column_count; i++) {
+            cursor = appender_put(&appender, cursor, fields[i], &schema->columns[i]);
+        }
+        loaded++;
+    }
+
+    appender_close(&appender);
+    free(line);
+    fclose(csv);
+
+    if (skipped > 0) {
+        out_printf("%d malformed line(s) skipped\n", skipped);
+    }
+    rows_processed += loaded;
+    out_printf("%d row(s) loaded into '%s'\n", loaded, table_name);
 }
 
 /* ============================================
    MAIN EXECUTOR
    ============================================ */
 
-void execute_statement(ASTNode* root) {
+void execute_statement(ASTNode* root, Arena* arena) {
     if (!root) return;
 
     switch (root->type) {
@@ -834,12 +2141,21 @@ void execute_statement(ASTNode* root) {
             }
             break;
         case AST_SELECT:
-            execute_select(root);
+            execute_select(root, arena);
             break;
         case AST_INSERT:
-            execute_insert(root);
+            execute_insert(root, arena);
+            break;
+        case AST_LOAD:
+            execute_load(root, arena);
+            break;
+        case AST_PREPARE:
+            prepare_statement(root);
+            break;
+        case AST_EXECUTE:
+            execute_prepared(root, arena);
             break;
         default:
-            printf("Unknown statement type\n");
+            out_printf("Unknown statement type\n");
     }
 }
\ No newline at end of file
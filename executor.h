@@ -2,38 +2,122 @@
 #define EXECUTOR_H
 
 #include "ast.h"
+#include "btree.h"
+#include "platform.h"
 #include <stdio.h>
-
-/* Global current database */
-extern char current_database[128];
-
-/* B-Tree Node Structure */
-typedef struct BTreeNode {
-    int* keys;
-    int key_count;
-    struct BTreeNode** children;
-    int is_leaf;
-    int degree;
-} BTreeNode;
+#include <stdint.h>
+
+/* Current database of the session running on this thread */
+extern THREAD_LOCAL char current_database[128];
+extern long long rows_processed;    // Rows selected, inserted or loaded so far
+extern int parallel_scan_ordered;   // Parallel scans keep table order (default)
+
+/* Statements run one at a time under the engine lock. The REPL has no
+   one to share with and never takes it; the server calls engine_share()
+   and holds it around each statement. A full table scan lets go of it
+   while it reads its snapshot, so long scans do not hold up inserts. */
+void engine_share(void);
+void engine_lock(void);
+void engine_unlock(void);
+
+/* With a shared engine an INSERT or LOAD logs its commit under the lock
+   but does not wait for it: this hands back the log (held, see wal.h) and
+   LSN of the thread's last commit, for wal_commit_held() once the lock is
+   released, so commits from different sessions share a flush. Returns 0
+   if there is nothing to wait for. */
+struct Wal;
+int engine_take_commit(struct Wal** wal, uint64_t* lsn);
+
+/* Rows per morsel handed to a worker in a parallel full scan */
+#define SCAN_MORSEL_ROWS (16 * 1024)
+
+/* Column data types */
+typedef enum {
+    TYPE_INT,
+    TYPE_VARCHAR,
+    TYPE_DOUBLE,
+    TYPE_DATE,
+    TYPE_BIGINT,            // 8-byte results of aggregates, not a column type
+    TYPE_UNKNOWN
+} ColumnType;
+
+/*
+ * VARCHAR(n) storage. Up to VARCHAR_INLINE_MAX characters the value sits
+ * in the row, null-padded to n bytes; plain VARCHAR keeps its original
+ * 64-byte field and 63-character limit. Longer declared lengths store a
+ * VARCHAR_DESCRIPTOR_SIZE descriptor in the row: a u32 length, then the
+ * value itself if it fits in the other 12 bytes, or else its first 4
+ * bytes and the u64 offset of the whole value in the table's overflow
+ * file (<table>.ovf, an append-only heap behind an 8-byte used length).
+ */
+#define VARCHAR_MAX_LENGTH 65535
+#define VARCHAR_INLINE_MAX 32
+#define VARCHAR_LEGACY_WIDTH 64
+#define VARCHAR_DESCRIPTOR_SIZE 16
+#define VARCHAR_DESCRIPTOR_INLINE 12
+#define OVERFLOW_HEADER_SIZE 8
+
+#define COLUMN_NAME_SIZE 64     // Bytes of a column name, terminator included
 
 /* Table Schema Structure */
 typedef struct {
-    char column_name[64];
+    char column_name[COLUMN_NAME_SIZE];
     char data_type[32];
+    ColumnType type;        // Resolved from data_type when the schema is read
+    int offset;             // Byte offset inside a row
+    int width;              // Stored width in bytes
+    int length;             // VARCHAR(n): longest value; 0 for plain VARCHAR
+    int overflow;           // VARCHAR(n): stored as a descriptor
 } ColumnSchema;
 
+/* Table layout, from CREATE TABLE ... STORAGE = ROW | COLUMN */
+typedef enum {
+    STORAGE_ROW,            // Fixed-width rows in the .table file
+    STORAGE_COLUMN          // One encoded file per column (column_store.h)
+} TableStorage;
+
 typedef struct {
     char table_name[64];
+    TableStorage storage;
     int column_count;
     ColumnSchema* columns;
+    int row_size;
+    int overflow_columns;   // Columns with values in the overflow file
 } TableSchema;
 
+/* Resolved SELECT or INSERT: schema offsets, projection and the compiled
+   WHERE, ready to run any number of times with different parameters */
+struct Predicate;
+struct AggregatePlan;
+struct SortPlan;
+struct JoinPlan;
+
+typedef struct {
+    ASTNodeType kind;               // AST_SELECT or AST_INSERT
+    const char* table_name;
+    TableSchema* schema;            // Owned by the catalog
+    struct Predicate* predicate;    // SELECT: compiled WHERE, NULL if none
+    int* display_columns;           // SELECT: projected columns
+    long* display_offsets;
+    int display_count;
+    struct AggregatePlan* aggregates;   // SELECT: aggregate functions, NULL if none
+    struct SortPlan* order;         // SELECT: ORDER BY, NULL if none
+    struct JoinPlan* join;          // SELECT: FROM ... JOIN, NULL for one table
+    long limit;                     // SELECT: LIMIT, -1 if none
+    long offset;                    // SELECT: OFFSET, 0 if none
+    int limit_param;                // SELECT: parameters supplying them, 0 if literal
+    int offset_param;
+    ASTNode* tuples;                // INSERT: AST_VALUES chain, may hold parameters
+    int tuple_count;
+    int param_count;                // ? placeholders to bind before running
+} QueryPlan;
+
 /* ============================================
    MAIN EXECUTOR
    ============================================ */
 
-/* Execute AST nodes */
-void execute_statement(ASTNode* root);
+/* Execute AST nodes; scratch memory comes from the statement arena */
+void execute_statement(ASTNode* root, Arena* arena);
 
 /* ============================================
    DATABASE OPERATIONS
@@ -56,14 +140,23 @@ void show_tables();
    DATA OPERATIONS
    ============================================ */
 
-void execute_select(ASTNode* select);
-void execute_insert(ASTNode* insert);
+void execute_select(ASTNode* select, Arena* arena);
+void execute_insert(ASTNode* insert, Arena* arena);
+void execute_load(ASTNode* load, Arena* arena);
+
+/* Plan a SELECT or INSERT into the arena; prints an error and returns NULL
+   if it does not resolve against the current database */
+QueryPlan* plan_query(ASTNode* statement, Arena* arena);
+
+/* Run a plan, binding parameters (text, in parameter order) if it has any */
+void run_query(QueryPlan* plan, const char** params, Arena* arena);
 
 /* ============================================
    SCHEMA OPERATIONS
    ============================================ */
 
-void write_schema(const char* db_name, const char* table_name, ASTNode* columns);
+void write_schema(const char* db_name, const char* table_name, ASTNode* columns,
+                  TableStorage storage);
 TableSchema* read_schema(const char* db_name, const char* table_name);
 void free_schema(TableSchema* schema);
 
@@ -73,21 +166,34 @@ void free_schema(TableSchema* schema);
 
 void create_table_file(const char* db_name, const char* table_name);
 void create_index_file(const char* db_name, const char* table_name);
+void create_overflow_file(const char* db_name, const char* table_name);
 
 /* ============================================
    INDEX OPERATIONS
    ============================================ */
 
-BTreeNode* load_index(const char* db_name, const char* table_name);
+BTree* load_index(const char* db_name, const char* table_name);
+BTree* rebuild_index(const char* db_name, const char* table_name);
+int index_key_column(TableSchema* schema);
 
 /* ============================================
    HELPER FUNCTIONS
    ============================================ */
 
+ColumnType column_type_of(const char* data_type);
+int column_width(ColumnType type);
+int varchar_length(const char* data_type);
 int calculate_row_size(TableSchema* schema);
-void write_value(FILE* file, const char* value, const char* data_type);
-void read_value(FILE* file, const char* data_type, char* buffer, size_t buffer_size);
+long column_offset(TableSchema* schema, int col_index);
+int write_value(char* dest, const char* value, const ColumnSchema* column);
+int read_value(const char* src, const ColumnSchema* column, const char* overflow,
+               char* buffer, size_t buffer_size);
+int value_fits(const ColumnSchema* column, const char* value);
+
+/* Text of a stored varchar field and its length. Inline values point into
+   the row; long ones into overflow, the mapped overflow file. */
+int varchar_text(const char* field, int width, int descriptor, const char* overflow,
+                 const char** text);
 int should_select_column(ASTNode* column_list, const char* column_name);
-int evaluate_condition(ASTNode* condition, TableSchema* schema, FILE* table_file, long row_offset);
 
 #endif
\ No newline at end of file
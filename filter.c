@@ -0,0 +1,347 @@
+#include <string.h>
+#include "filter.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FILTER_X86 1
+#include <immintrin.h>
+#endif
+
+/* Kernels set bit i of `bits` for every row i that satisfies the comparison.
+   `bits` is zeroed by the caller. */
+typedef void (*IntKernel)(const char* base, int stride, int count, CompareOp op,
+                          int constant, uint64_t* bits);
+typedef void (*DoubleKernel)(const char* base, int stride, int count, CompareOp op,
+                             double constant, uint64_t* bits);
+typedef void (*VarcharEqualKernel)(const char* base, int stride, int count,
+                                   const char* constant, uint64_t* bits);
+
+#define SET_BIT(bits, i) ((bits)[(i) >> 6] |= (uint64_t)1 << ((i) & 63))
+#define SET_MASK(bits, i, mask) ((bits)[(i) >> 6] |= (uint64_t)(mask) << ((i) & 63))
+
+/* ============================================
+   SCALAR KERNELS
+   ============================================ */
+
+static int compare_int(int value, CompareOp op, int constant) {
+    switch (op) {
+        case CMP_EQ: return value == constant;
+        case CMP_GT: return value > constant;
+        case CMP_LT: return value < constant;
+        case CMP_GE: return value >= constant;
+        default: return value <= constant;
+    }
+}
+
+static int compare_double(double value, CompareOp op, double constant) {
+    switch (op) {
+        case CMP_EQ: return value == constant;
+        case CMP_GT: return value > constant;
+        case CMP_LT: return value < constant;
+        case CMP_GE: return value >= constant;
+        default: return value <= constant;
+    }
+}
+
+static void int_scalar_from(const char* base, int stride, int start, int count, CompareOp op,
+                            int constant, uint64_t* bits) {
+    for (int i = start; i < count; i++) {
+        int value;
+        memcpy(&value, base + (long)i * stride, sizeof(int));
+        if (compare_int(value, op, constant)) SET_BIT(bits, i);
+    }
+}
+
+static void double_scalar_from(const char* base, int stride, int start, int count, CompareOp op,
+                               double constant, uint64_t* bits) {
+    for (int i = start; i < count; i++) {
+        double value;
+        memcpy(&value, base + (long)i * stride, sizeof(double));
+        if (compare_double(value, op, constant)) SET_BIT(bits, i);
+    }
+}
+
+static void int_scalar(const char* base, int stride, int count, CompareOp op,
+                       int constant, uint64_t* bits) {
+    int_scalar_from(base, stride, 0, count, op, constant, bits);
+}
+
+static void double_scalar(const char* base, int stride, int count, CompareOp op,
+                          double constant, uint64_t* bits) {
+    double_scalar_from(base, stride, 0, count, op, constant, bits);
+}
+
+static void varchar_equal_scalar(const char* base, int stride, int count,
+                                 const char* constant, uint64_t* bits) {
+    for (int i = 0; i < count; i++) {
+        if (memcmp(base + (long)i * stride, constant, 64) == 0) SET_BIT(bits, i);
+    }
+}
+
+/* VARCHAR(n) stored inline in n bytes: compare the padded constant */
+static void varchar_equal_width(const char* base, int stride, int count, int width,
+                                const char* constant, uint64_t* bits) {
+    for (int i = 0; i < count; i++) {
+        if (memcmp(base + (long)i * stride, constant, width) == 0) SET_BIT(bits, i);
+    }
+}
+
+/* ============================================
+   SSE2 KERNELS
+   ============================================ */
+
+#ifdef FILTER_X86
+
+static inline int load_int(const char* p) {
+    int value;
+    memcpy(&value, p, sizeof(int));
+    return value;
+}
+
+static inline double load_double(const char* p) {
+    double value;
+    memcpy(&value, p, sizeof(double));
+    return value;
+}
+
+__attribute__((target("sse2")))
+static void int_sse2(const char* base, int stride, int count, CompareOp op,
+                     int constant, uint64_t* bits) {
+    __m128i c = _mm_set1_epi32(constant);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const char* p = base + (long)i * stride;
+        __m128i v = _mm_setr_epi32(load_int(p), load_int(p + stride),
+                                   load_int(p + 2 * stride), load_int(p + 3 * stride));
+        __m128i m;
+        int negate = 0;
+        switch (op) {
+            case CMP_EQ: m = _mm_cmpeq_epi32(v, c); break;
+            case CMP_GT: m = _mm_cmpgt_epi32(v, c); break;
+            case CMP_LT: m = _mm_cmplt_epi32(v, c); break;
+            case CMP_GE: m = _mm_cmplt_epi32(v, c); negate = 1; break;
+            default: m = _mm_cmpgt_epi32(v, c); negate = 1; break;
+        }
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(m));
+        if (negate) mask ^= 0xF;
+        SET_MASK(bits, i, mask);
+    }
+    int_scalar_from(base, stride, i, count, op, constant, bits);
+}
+
+__attribute__((target("sse2")))
+static void double_sse2(const char* base, int stride, int count, CompareOp op,
+                        double constant, uint64_t* bits) {
+    __m128d c = _mm_set1_pd(constant);
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const char* p = base + (long)i * stride;
+        __m128d v = _mm_setr_pd(load_double(p), load_double(p + stride));
+        __m128d m;
+        switch (op) {
+            case CMP_EQ: m = _mm_cmpeq_pd(v, c); break;
+            case CMP_GT: m = _mm_cmpgt_pd(v, c); break;
+            case CMP_LT: m = _mm_cmplt_pd(v, c); break;
+            case CMP_GE: m = _mm_cmpge_pd(v, c); break;
+            default: m = _mm_cmple_pd(v, c); break;
+        }
+        SET_MASK(bits, i, _mm_movemask_pd(m));
+    }
+    double_scalar_from(base, stride, i, count, op, constant, bits);
+}
+
+__attribute__((target("sse2")))
+static void varchar_equal_sse2(const char* base, int stride, int count,
+                               const char* constant, uint64_t* bits) {
+    __m128i c0 = _mm_loadu_si128((const __m128i*)constant);
+    __m128i c1 = _mm_loadu_si128((const __m128i*)(constant + 16));
+    __m128i c2 = _mm_loadu_si128((const __m128i*)(constant + 32));
+    __m128i c3 = _mm_loadu_si128((const __m128i*)(constant + 48));
+    for (int i = 0; i < count; i++) {
+        const char* p = base + (long)i * stride;
+        __m128i eq = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), c0),
+                          _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 16)), c1)),
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 32)), c2),
+                          _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 48)), c3)));
+        if (_mm_movemask_epi8(eq) == 0xFFFF) SET_BIT(bits, i);
+    }
+}
+
+/* ============================================
+   AVX2 KERNELS
+   ============================================ */
+
+__attribute__((target("avx2")))
+static void int_avx2(const char* base, int stride, int count, CompareOp op,
+                     int constant, uint64_t* bits) {
+    // Gather one column value from each of 8 consecutive rows
+    __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                       _mm256_set1_epi32(stride));
+    __m256i c = _mm256_set1_epi32(constant);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_i32gather_epi32((const int*)(base + (long)i * stride), index, 1);
+        __m256i m;
+        int negate = 0;
+        switch (op) {
+            case CMP_EQ: m = _mm256_cmpeq_epi32(v, c); break;
+            case CMP_GT: m = _mm256_cmpgt_epi32(v, c); break;
+            case CMP_LT: m = _mm256_cmpgt_epi32(c, v); break;
+            case CMP_GE: m = _mm256_cmpgt_epi32(c, v); negate = 1; break;
+            default: m = _mm256_cmpgt_epi32(v, c); negate = 1; break;
+        }
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(m));
+        if (negate) mask ^= 0xFF;
+        SET_MASK(bits, i, mask);
+    }
+    int_scalar_from(base, stride, i, count, op, constant, bits);
+}
+
+__attribute__((target("avx2")))
+static void double_avx2(const char* base, int stride, int count, CompareOp op,
+                        double constant, uint64_t* bits) {
+    __m128i index = _mm_setr_epi32(0, stride, 2 * stride, 3 * stride);
+    __m256d c = _mm256_set1_pd(constant);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d v = _mm256_i32gather_pd((const double*)(base + (long)i * stride), index, 1);
+        __m256d m;
+        switch (op) {
+            case CMP_EQ: m = _mm256_cmp_pd(v, c, _CMP_EQ_OQ); break;
+            case CMP_GT: m = _mm256_cmp_pd(v, c, _CMP_GT_OQ); break;
+            case CMP_LT: m = _mm256_cmp_pd(v, c, _CMP_LT_OQ); break;
+            case CMP_GE: m = _mm256_cmp_pd(v, c, _CMP_GE_OQ); break;
+            default: m = _mm256_cmp_pd(v, c, _CMP_LE_OQ); break;
+        }
+        SET_MASK(bits, i, _mm256_movemask_pd(m));
+    }
+    double_scalar_from(base, stride, i, count, op, constant, bits);
+}
+
+__attribute__((target("avx2")))
+static void varchar_equal_avx2(const char* base, int stride, int count,
+                               const char* constant, uint64_t* bits) {
+    __m256i c0 = _mm256_loadu_si256((const __m256i*)constant);
+    __m256i c1 = _mm256_loadu_si256((const __m256i*)(constant + 32));
+    for (int i = 0; i < count; i++) {
+        const char* p = base + (long)i * stride;
+        __m256i eq = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), c0),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 32)), c1));
+        if (_mm256_movemask_epi8(eq) == -1) SET_BIT(bits, i);
+    }
+}
+
+#endif
+
+/* ============================================
+   DISPATCH
+   ============================================ */
+
+static IntKernel int_kernel = NULL;
+static DoubleKernel double_kernel = NULL;
+static VarcharEqualKernel varchar_equal_kernel = NULL;
+
+static void select_kernels(void) {
+    IntKernel ints = int_scalar;
+    DoubleKernel doubles = double_scalar;
+    VarcharEqualKernel varchars = varchar_equal_scalar;
+
+#ifdef FILTER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        ints = int_avx2;
+        doubles = double_avx2;
+        varchars = varchar_equal_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        ints = int_sse2;
+        doubles = double_sse2;
+        varchars = varchar_equal_sse2;
+    }
+#endif
+
+    // int_kernel is the "selected" flag, so parallel scans may race here:
+    // publish it last
+    double_kernel = doubles;
+    varchar_equal_kernel = varchars;
+    __atomic_store_n(&int_kernel, ints, __ATOMIC_RELEASE);
+}
+
+/* ============================================
+   BATCH EVALUATION
+   ============================================ */
+
+static void evaluate_bitmap(const Predicate* p, const char* rows, int row_size, int count,
+                            uint64_t* bits) {
+    memset(bits, 0, sizeof(uint64_t) * FILTER_BITMAP_WORDS);
+
+    switch (p->kind) {
+        case PRED_FALSE:
+            return;
+        case PRED_AND:
+        case PRED_OR: {
+            uint64_t other[FILTER_BITMAP_WORDS];
+            evaluate_bitmap(p->left, rows, row_size, count, bits);
+            evaluate_bitmap(p->right, rows, row_size, count, other);
+            for (int w = 0; w < FILTER_BITMAP_WORDS; w++) {
+                bits[w] = p->kind == PRED_AND ? bits[w] & other[w] : bits[w] | other[w];
+            }
+            return;
+        }
+        case PRED_COMPARE:
+            break;
+    }
+
+    const char* column = rows + p->offset;
+    switch (p->type) {
+        case TYPE_INT:
+        case TYPE_DATE:
+            int_kernel(column, row_size, count, p->op, p->int_value, bits);
+            break;
+        case TYPE_DOUBLE:
+            double_kernel(column, row_size, count, p->op, p->double_value, bits);
+            break;
+        case TYPE_VARCHAR:
+            if (p->op == CMP_EQ && p->descriptor == 0 && p->text_length > p->width) {
+                return;     // Longer than anything the column can hold
+            }
+            if (p->op == CMP_EQ && p->width == VARCHAR_LEGACY_WIDTH) {
+                varchar_equal_kernel(column, row_size, count, p->string_value, bits);
+            } else if (p->op == CMP_EQ && !p->descriptor) {
+                varchar_equal_width(column, row_size, count, p->width, p->string_value, bits);
+            } else {
+                for (int i = 0; i < count; i++) {
+                    if (predicate_matches(p, rows + (long)i * row_size)) SET_BIT(bits, i);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void filter_bitmap(const Predicate* predicate, const char* rows, int row_size, int count,
+                   uint64_t* bits) {
+    if (!__atomic_load_n(&int_kernel, __ATOMIC_ACQUIRE)) select_kernels();
+    evaluate_bitmap(predicate, rows, row_size, count, bits);
+}
+
+int filter_batch(const Predicate* predicate, const char* rows, int row_size, int count,
+                 uint16_t* selection) {
+    uint64_t bits[FILTER_BITMAP_WORDS];
+    filter_bitmap(predicate, rows, row_size, count, bits);
+
+    // Turn the bitmap into a selection vector
+    int selected = 0;
+    for (int w = 0; w < FILTER_BITMAP_WORDS; w++) {
+        uint64_t word = bits[w];
+        while (word) {
+            int bit = __builtin_ctzll(word);
+            int position = w * 64 + bit;
+            if (position >= count) return selected;
+            selection[selected++] = (uint16_t)position;
+            word &= word - 1;
+        }
+    }
+    return selected;
+}
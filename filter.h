@@ -0,0 +1,34 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+#include "predicate.h"
+
+/* =======================
+   VECTORIZED BATCH FILTER
+   ======================= */
+
+/*
+ * Evaluates a compiled predicate over a block of fixed-width rows at a
+ * time. Each comparison produces a selection bitmap for the block using
+ * AVX2 or SSE2 kernels (picked once at runtime from the CPU features) or
+ * a scalar fallback; AND/OR combine bitmaps, and the result is returned
+ * as a selection vector of row positions within the block. Comparisons on
+ * long varchars, which may live in the overflow file, go row by row.
+ */
+
+#define FILTER_BATCH_SIZE 1024
+#define FILTER_BITMAP_WORDS (FILTER_BATCH_SIZE / 64)
+
+/* Filter `count` (<= FILTER_BATCH_SIZE) rows laid out every row_size bytes
+   from `rows`. Writes the positions of matching rows to `selection` in
+   ascending order and returns how many matched. */
+int filter_batch(const Predicate* predicate, const char* rows, int row_size, int count,
+                 uint16_t* selection);
+
+/* The same evaluation as a bitmap of FILTER_BITMAP_WORDS words, bit i set
+   for each matching row i */
+void filter_bitmap(const Predicate* predicate, const char* rows, int row_size, int count,
+                   uint64_t* bits);
+
+#endif
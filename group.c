@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "group.h"
+#include "spill.h"
+
+struct GroupTable {
+    const AggregatePlan* plan;
+    char db_name[128];
+    size_t budget;
+    int depth;                  // Hash bits already used by partitioning
+    size_t record_size;         // Hash, key and states, 8-byte aligned
+    size_t states_offset;
+    char* records;
+    uint32_t group_count;
+    uint32_t group_capacity;
+    uint64_t* slots;            // Hash << 32 | record index + 1, 0 if empty
+    uint32_t slot_mask;         // Twice the capacity, minus one
+    int spilled;                // Partitions hold records
+    int spill_failed;           // Could not create the spill files: stay in memory
+    SpillFile partitions[GROUP_PARTITIONS];
+    char* batch_keys;           // GROUP_BATCH keys being probed
+};
+
+#define RECORD(table, index) ((table)->records + (size_t)(index) * (table)->record_size)
+
+static size_t align8(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+/* Bytes of records and slots for a capacity */
+static size_t table_memory(const GroupTable* table, uint32_t capacity) {
+    return (size_t)capacity * table->record_size + (size_t)capacity * 2 * sizeof(uint64_t);
+}
+
+static void allocate(GroupTable* table, uint32_t capacity) {
+    table->group_capacity = capacity;
+    table->records = realloc(table->records, (size_t)capacity * table->record_size);
+    free(table->slots);
+    table->slots = calloc((size_t)capacity * 2, sizeof(uint64_t));
+    table->slot_mask = capacity * 2 - 1;
+}
+
+GroupTable* group_table_new(const AggregatePlan* plan, const char* db_name, size_t budget) {
+    GroupTable* table = calloc(1, sizeof(GroupTable));
+    table->plan = plan;
+    snprintf(table->db_name, sizeof(table->db_name), "%s", db_name);
+    table->budget = budget;
+    table->states_offset = align8(sizeof(uint64_t) + plan->key_size);
+    table->record_size = table->states_offset + sizeof(AggregateState) * plan->count;
+    table->batch_keys = malloc((size_t)GROUP_BATCH * (plan->key_size ? plan->key_size : 1));
+    allocate(table, GROUP_INITIAL_CAPACITY);
+    return table;
+}
+
+void group_table_free(GroupTable* table) {
+    if (!table) return;
+    for (int p = 0; p < GROUP_PARTITIONS; p++) {
+        spill_remove(&table->partitions[p]);
+    }
+    free(table->records);
+    free(table->slots);
+    free(table->batch_keys);
+    free(table);
+}
+
+/* ============================================
+   KEYS
+   ============================================ */
+
+static uint64_t mix(uint64_t hash, uint64_t word) {
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 32);
+}
+
+static uint64_t hash_bytes(uint64_t hash, const char* data, size_t length) {
+    for (; length >= 8; data += 8, length -= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        hash = mix(hash, word);
+    }
+    if (length > 0) {
+        uint64_t word = 0;
+        memcpy(&word, data, length);
+        hash = mix(hash, word);
+    }
+    return hash;
+}
+
+/* Hash of a key; long varchars hash their text, everything else its bytes */
+static uint64_t hash_key(const AggregatePlan* plan, const char* key, const char* overflow) {
+    uint64_t hash;
+    if (!plan->key_descriptors) {
+        hash = hash_bytes(0, key, plan->key_size);
+    } else {
+        hash = 0;
+        for (int k = 0; k < plan->key_count; k++) {
+            const AggregateKey* column = &plan->keys[k];
+            const char* field = key + column->offset;
+            if (column->source.overflow) {
+                const char* text;
+                int length = varchar_text(field, column->source.width, 1, overflow, &text);
+                hash = hash_bytes(mix(hash, (uint64_t)length), text, length);
+            } else {
+                hash = hash_bytes(hash, field, column->source.width);
+            }
+        }
+    }
+    // Finish so the top bits (partitions) and low bits (slots) both vary
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ull;
+    return hash ^ (hash >> 32);
+}
+
+static int keys_equal(const AggregatePlan* plan, const char* a, const char* b, const char* overflow) {
+    if (!plan->key_descriptors) {
+        return memcmp(a, b, plan->key_size) == 0;
+    }
+    for (int k = 0; k < plan->key_count; k++) {
+        const AggregateKey* column = &plan->keys[k];
+        const char* x = a + column->offset;
+        const char* y = b + column->offset;
+        if (column->source.overflow) {
+            const char* x_text;
+            const char* y_text;
+            int x_length = varchar_text(x, column->source.width, 1, overflow, &x_text);
+            int y_length = varchar_text(y, column->source.width, 1, overflow, &y_text);
+            if (x_length != y_length || memcmp(x_text, y_text, x_length) != 0) return 0;
+        } else if (memcmp(x, y, column->source.width) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Copy a row's group columns into a key */
+static void extract_key(const AggregatePlan* plan, const char* row, char* key) {
+    for (int k = 0; k < plan->key_count; k++) {
+        const AggregateKey* column = &plan->keys[k];
+        memcpy(key + column->offset, row + column->source.offset, column->source.width);
+        if (column->source.type == TYPE_DOUBLE) {
+            // -0.0 and 0.0 are one group
+            double value;
+            memcpy(&value, key + column->offset, sizeof(double));
+            if (value == 0) {
+                value = 0;
+                memcpy(key + column->offset, &value, sizeof(double));
+            }
+        }
+    }
+}
+
+/* ============================================
+   HASH TABLE
+   ============================================ */
+
+static void insert_slot(GroupTable* table, uint64_t hash, uint32_t index) {
+    uint32_t slot = (uint32_t)hash & table->slot_mask;
+    while (table->slots[slot]) {
+        slot = (slot + 1) & table->slot_mask;
+    }
+    table->slots[slot] = ((uint64_t)(uint32_t)hash << 32) | (index + 1);
+}
+
+static void grow(GroupTable* table) {
+    uint32_t capacity = table->group_capacity * 2;
+    allocate(table, capacity);
+    for (uint32_t i = 0; i < table->group_count; i++) {
+        uint64_t hash;
+        memcpy(&hash, RECORD(table, i), sizeof(hash));
+        insert_slot(table, hash, i);
+    }
+}
+
+/* Index of the key's group, added with zeroed states if it is new */
+static uint32_t find_or_insert(GroupTable* table, uint64_t hash, const char* key, const char* overflow) {
+    const AggregatePlan* plan = table->plan;
+    uint32_t tag = (uint32_t)hash;
+    uint32_t slot = tag & table->slot_mask;
+    for (;;) {
+        uint64_t entry = table->slots[slot];
+        if (!entry) break;
+        uint32_t index = (uint32_t)entry - 1;
+        if ((uint32_t)(entry >> 32) == tag &&
+            keys_equal(plan, RECORD(table, index) + sizeof(uint64_t), key, overflow)) {
+            return index;
+        }
+        slot = (slot + 1) & table->slot_mask;
+    }
+
+    if (table->group_count == table->group_capacity) {
+        grow(table);
+    }
+    uint32_t index = table->group_count++;
+    char* record = RECORD(table, index);
+    memcpy(record, &hash, sizeof(hash));
+    memcpy(record + sizeof(uint64_t), key, plan->key_size);
+    memset(record + table->states_offset, 0, table->record_size - table->states_offset);
+    insert_slot(table, hash, index);
+    return index;
+}
+
+/* ============================================
+   SPILLING
+   ============================================ */
+
+static int partition_of(uint64_t hash, int depth) {
+    return (int)(hash >> (64 - GROUP_PARTITION_BITS * (depth + 1))) & (GROUP_PARTITIONS - 1);
+}
+
+/* Create the partition files on first use; returns 0 if they cannot be */
+static int open_partitions(GroupTable* table) {
+    if (table->spilled) return 1;
+    if (table->spill_failed) return 0;
+    for (int p = 0; p < GROUP_PARTITIONS; p++) {
+        if (!spill_open(&table->partitions[p], table->db_name)) {
+            for (int q = 0; q < p; q++) spill_remove(&table->partitions[q]);
+            table->spill_failed = 1;
+            return 0;
+        }
+    }
+    table->spilled = 1;
+    return 1;
+}
+
+/* Write every record to its partition and empty the table */
+static void spill(GroupTable* table) {
+    if (!open_partitions(table)) return;
+
+    for (uint32_t i = 0; i < table->group_count; i++) {
+        const char* record = RECORD(table, i);
+        uint64_t hash;
+        memcpy(&hash, record, sizeof(hash));
+        fwrite(record, table->record_size, 1, table->partitions[partition_of(hash, table->depth)].file);
+    }
+    table->group_count = 0;
+    memset(table->slots, 0, ((size_t)table->slot_mask + 1) * sizeof(uint64_t));
+}
+
+/* Make room for up to count new groups: spill first if growing for them
+   would pass the budget */
+static void reserve(GroupTable* table, int count) {
+    if (table->group_count + (uint32_t)count <= table->group_capacity) return;
+    if (table->group_count == 0 || table->depth >= GROUP_MAX_DEPTH || table->spill_failed) return;
+    if (table_memory(table, table->group_capacity * 2) > table->budget) {
+        spill(table);
+    }
+}
+
+/* ============================================
+   AGGREGATION
+   ============================================ */
+
+void group_table_add(GroupTable* table, const char* rows, int row_size, const uint16_t* selection,
+                     int count, const char* overflow) {
+    const AggregatePlan* plan = table->plan;
+    uint32_t group_ids[GROUP_BATCH];
+    for (int start = 0; start < count; start += GROUP_BATCH) {
+        int batch = count - start < GROUP_BATCH ? count - start : GROUP_BATCH;
+        const uint16_t* positions = selection ? selection + start : NULL;
+        const char* base = selection ? rows : rows + (long)start * row_size;
+        reserve(table, batch);
+
+        for (int i = 0; i < batch; i++) {
+            const char* row = base + (long)(positions ? positions[i] : i) * row_size;
+            extract_key(plan, row, table->batch_keys + (size_t)i * plan->key_size);
+        }
+        for (int i = 0; i < batch; i++) {
+            const char* key = table->batch_keys + (size_t)i * plan->key_size;
+            group_ids[i] = find_or_insert(table, hash_key(plan, key, overflow), key, overflow);
+        }
+        aggregate_fold_groups(plan, table->records + table->states_offset, table->record_size,
+                              group_ids, base, row_size, positions, batch, overflow);
+    }
+}
+
+/* Fold one partial record (hash, key, states) into the table */
+static void add_record(GroupTable* table, const char* record, const char* overflow) {
+    uint64_t hash;
+    memcpy(&hash, record, sizeof(hash));
+    reserve(table, 1);
+    uint32_t index = find_or_insert(table, hash, record + sizeof(uint64_t), overflow);
+    aggregate_merge_states(table->plan, (AggregateState*)(RECORD(table, index) + table->states_offset),
+                           (const AggregateState*)(record + table->states_offset), overflow);
+}
+
+static void append_file(FILE* to, FILE* from) {
+    char buffer[64 * 1024];
+    fflush(from);
+    rewind(from);
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), from)) > 0) {
+        fwrite(buffer, 1, length, to);
+    }
+}
+
+void group_table_merge(GroupTable* into, GroupTable* from, const char* overflow) {
+    for (uint32_t i = 0; i < from->group_count; i++) {
+        add_record(into, RECORD(from, i), overflow);
+    }
+
+    // Partial records already on disk join the matching partitions
+    if (from->spilled) {
+        int appendable = open_partitions(into);
+        for (int p = 0; p < GROUP_PARTITIONS; p++) {
+            if (!appendable) {
+                // No files of our own: read theirs back into memory
+                spill_rewind(&from->partitions[p]);
+                char* record = malloc(from->record_size);
+                while (fread(record, from->record_size, 1, from->partitions[p].file) == 1) {
+                    add_record(into, record, overflow);
+                }
+                free(record);
+            } else {
+                append_file(into->partitions[p].file, from->partitions[p].file);
+            }
+        }
+    }
+    group_table_free(from);
+}
+
+void group_table_finish(GroupTable* table, const char* overflow, AggregateEmit emit, void* context) {
+    const AggregatePlan* plan = table->plan;
+    if (!table->spilled) {
+        char* row = malloc(plan->result.row_size);
+        for (uint32_t i = 0; i < table->group_count; i++) {
+            const char* record = RECORD(table, i);
+            aggregate_result_row(plan, record + sizeof(uint64_t),
+                                 (const AggregateState*)(record + table->states_offset), row);
+            emit(context, row);
+        }
+        free(row);
+        table->group_count = 0;
+        return;
+    }
+
+    // Every key's partial records are now in one partition: aggregate each
+    // partition on its own, by the next bits of the hash
+    spill(table);
+    char* record = malloc(table->record_size);
+    for (int p = 0; p < GROUP_PARTITIONS; p++) {
+        GroupTable* part = group_table_new(plan, table->db_name, table->budget);
+        part->depth = table->depth + 1;
+        spill_rewind(&table->partitions[p]);
+        while (fread(record, table->record_size, 1, table->partitions[p].file) == 1) {
+            add_record(part, record, overflow);
+        }
+        spill_remove(&table->partitions[p]);
+        group_table_finish(part, overflow, emit, context);
+        group_table_free(part);
+    }
+    free(record);
+    table->spilled = 0;
+}
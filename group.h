@@ -0,0 +1,58 @@
+#ifndef GROUP_H
+#define GROUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aggregate.h"
+
+/* =======================
+   HASH AGGREGATION
+   ======================= */
+
+/*
+ * Groups of GROUP BY and SELECT DISTINCT. A group record is the 64-bit
+ * hash of its key, the key (the group columns' stored bytes, back to
+ * back) and one AggregateState per aggregate; records sit in one dense
+ * array in insertion order. The hash table is open addressing with
+ * linear probing over 8-byte slots that hold the low 32 bits of the hash
+ * next to the record index, so a probe compares hashes within one cache
+ * line and only touches a record to confirm a match. Rows are hashed and
+ * probed a batch at a time, and each aggregate then folds the whole
+ * batch into the groups found.
+ *
+ * When another batch could take the table past its memory budget, every
+ * record is written to one of GROUP_PARTITIONS spill files chosen by the
+ * top bits of its hash, and the table starts empty. A key may then have
+ * partial records in memory and in its partition; at the end everything
+ * goes to the partitions, and each partition is aggregated on its own,
+ * by the next bits of the hash, spilling again if it is still too big.
+ * Parallel workers each aggregate into their own table; merging inserts
+ * one table's records into the other and appends its partitions to the
+ * matching ones.
+ */
+
+#define GROUP_PARTITION_BITS 4
+#define GROUP_PARTITIONS (1 << GROUP_PARTITION_BITS)
+#define GROUP_MAX_DEPTH 8               // Partitioning levels in the hash's top 32 bits
+#define GROUP_BATCH 256                 // Rows hashed and probed together
+#define GROUP_INITIAL_CAPACITY 1024
+
+typedef struct GroupTable GroupTable;
+
+/* Empty table for plan's keys and aggregates; spills go to db_name */
+GroupTable* group_table_new(const AggregatePlan* plan, const char* db_name, size_t budget);
+
+/* Free a table and delete its spill files */
+void group_table_free(GroupTable* table);
+
+/* Fold count rows into their groups (see aggregation_add) */
+void group_table_add(GroupTable* table, const char* rows, int row_size, const uint16_t* selection,
+                     int count, const char* overflow);
+
+/* Merge every group of `from` into `into`, then free `from` */
+void group_table_merge(GroupTable* into, GroupTable* from, const char* overflow);
+
+/* Pass the result row of every group to emit; the table is left empty */
+void group_table_finish(GroupTable* table, const char* overflow, AggregateEmit emit, void* context);
+
+#endif
@@ -11,19 +11,26 @@ InputBuffer* new_input_buffer(void) {
     return input_buffer;
 }
 
-void read_input(InputBuffer* input_buffer) {
+int read_input(InputBuffer* input_buffer) {
     long bytes_read =
         getline(&(input_buffer->buffer),
                 &(input_buffer->buffer_length),
                 stdin);
 
     if (bytes_read <= 0) {
-        printf("Error reading input\n");
-        return;
+        if (ferror(stdin)) {
+            printf("Error reading input\n");
+        }
+        return 0;
     }
 
-    input_buffer->input_length = bytes_read - 1;
-    input_buffer->buffer[bytes_read - 1] = '\0';
+    // The last line of the input may have no newline
+    if (input_buffer->buffer[bytes_read - 1] == '\n') {
+        bytes_read--;
+    }
+    input_buffer->input_length = bytes_read;
+    input_buffer->buffer[bytes_read] = '\0';
+    return 1;
 }
 
 void close_input_buffer(InputBuffer* input_buffer) {
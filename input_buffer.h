@@ -11,7 +11,7 @@ typedef struct {
 
 /* Function declarations */
 InputBuffer* new_input_buffer(void);
-void read_input(InputBuffer* input_buffer);
+int read_input(InputBuffer* input_buffer);     // 0 at end of input
 void close_input_buffer(InputBuffer* input_buffer);
 
 #endif
@@ -0,0 +1,658 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "join.h"
+#include "catalog.h"
+#include "predicate.h"
+#include "filter.h"
+#include "buffer_pool.h"
+#include "spill.h"
+#include "output.h"
+
+static int find_column(const TableSchema* schema, const char* name) {
+    for (int i = 0; i < schema->column_count; i++) {
+        if (strcmp(schema->columns[i].column_name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/* ============================================
+   PLANNING
+   ============================================ */
+
+/* Give a column name its table: "t.c" stays as written, "c" becomes "t.c"
+   for the one table that has it. Returns 0 if both tables have it. */
+static int qualify(const JoinPlan* plan, ASTNode* column, Arena* arena) {
+    if (strchr(column->value, '.')) return 1;
+
+    int table = -1;
+    for (int t = 0; t < 2; t++) {
+        if (find_column(plan->schemas[t], column->value) < 0) continue;
+        if (table >= 0) {
+            out_printf("Column '%s' is ambiguous: name it as %s.%s or %s.%s\n", column->value,
+                       plan->table_names[0], column->value, plan->table_names[1], column->value);
+            return 0;
+        }
+        table = t;
+    }
+    if (table < 0) return 1;    // Reported as not found where it is used
+
+    size_t length = strlen(plan->table_names[table]) + strlen(column->value) + 2;
+    char* name = arena_alloc(arena, length);
+    snprintf(name, length, "%s.%s", plan->table_names[table], column->value);
+    column->value = name;
+    return 1;
+}
+
+/* Qualify a column list entry: a column, an aggregate's argument, or * */
+static int qualify_column(const JoinPlan* plan, ASTNode* column, Arena* arena) {
+    if (column->type == AST_IDENTIFIER) return qualify(plan, column, arena);
+    if (column->type == AST_AGGREGATE && column->left->type == AST_IDENTIFIER) {
+        return qualify(plan, column->left, arena);
+    }
+    return 1;
+}
+
+/* Qualify the columns compared in a WHERE condition tree */
+static int qualify_condition(const JoinPlan* plan, ASTNode* condition, Arena* arena) {
+    if (!condition) return 1;
+    if (condition->left && condition->left->type == AST_IDENTIFIER) {
+        return qualify(plan, condition->left, arena);
+    }
+    return qualify_condition(plan, condition->left, arena) &&
+           qualify_condition(plan, condition->right, arena);
+}
+
+/* Resolve a qualified ON column to its table and schema index */
+static int join_column(const JoinPlan* plan, const char* name, int* table, int* column) {
+    for (int t = 0; t < 2; t++) {
+        size_t length = strlen(plan->table_names[t]);
+        if (strncmp(name, plan->table_names[t], length) == 0 && name[length] == '.') {
+            *table = t;
+            *column = find_column(plan->schemas[t], name + length + 1);
+            return *column >= 0;
+        }
+    }
+    return 0;
+}
+
+JoinPlan* join_plan(ASTNode* select, const char* db_name, Arena* arena) {
+    ASTNode* table_node = select->right;
+    ASTNode* join = table_node->right;
+
+    JoinPlan* plan = arena_calloc(arena, sizeof(JoinPlan));
+    plan->table_names[0] = table_node->value;
+    plan->table_names[1] = join->value;
+    if (strcmp(plan->table_names[0], plan->table_names[1]) == 0) {
+        out_printf("Cannot join table '%s' with itself\n", plan->table_names[0]);
+        return NULL;
+    }
+    for (int t = 0; t < 2; t++) {
+        plan->schemas[t] = catalog_get(db_name, plan->table_names[t]);
+        if (!plan->schemas[t]) {
+            out_printf("Table '%s' does not exist\n", plan->table_names[t]);
+            return NULL;
+        }
+    }
+    if (plan->schemas[0]->overflow_columns > 0 && plan->schemas[1]->overflow_columns > 0) {
+        out_printf("Cannot join '%s' and '%s': only one of them may have long VARCHAR columns\n",
+                   plan->table_names[0], plan->table_names[1]);
+        return NULL;
+    }
+
+    // Every column the statement names, in the select list and the clauses
+    for (ASTNode* column = select->left; column; column = column->right) {
+        if (!qualify_column(plan, column, arena)) return NULL;
+    }
+    ASTNode* condition = join->left;
+    if (!qualify(plan, condition->left, arena) || !qualify(plan, condition->right, arena)) {
+        return NULL;
+    }
+    for (ASTNode* clause = join->right; clause; clause = clause->right) {
+        if (clause->type == AST_WHERE && !qualify_condition(plan, clause->left, arena)) return NULL;
+        for (ASTNode* item = clause->type == AST_GROUP_BY || clause->type == AST_ORDER_BY ? clause->left : NULL;
+             item; item = item->right) {
+            if (!qualify_column(plan, item->type == AST_SORT_KEY ? item->left : item, arena)) return NULL;
+        }
+    }
+
+    // ON compares a column of each table
+    int left_table;
+    int left_column;
+    int right_table;
+    int right_column;
+    if (!join_column(plan, condition->left->value, &left_table, &left_column) ||
+        !join_column(plan, condition->right->value, &right_table, &right_column) ||
+        left_table == right_table) {
+        out_printf("JOIN ... ON must compare a column of '%s' with a column of '%s'\n",
+                   plan->table_names[0], plan->table_names[1]);
+        return NULL;
+    }
+    plan->key_columns[left_table] = left_column;
+    plan->key_columns[right_table] = right_column;
+
+    const ColumnSchema* keys[2] = {
+        &plan->schemas[0]->columns[plan->key_columns[0]],
+        &plan->schemas[1]->columns[plan->key_columns[1]],
+    };
+    if (keys[0]->type != keys[1]->type) {
+        out_printf("Cannot join %s column '%s' with %s column '%s'\n", keys[0]->data_type,
+                   keys[0]->column_name, keys[1]->data_type, keys[1]->column_name);
+        return NULL;
+    }
+
+    // The joined row: the first table's row, then the second's
+    TableSchema* schema = &plan->schema;
+    snprintf(schema->table_name, sizeof(schema->table_name), "%s", plan->table_names[0]);
+    schema->storage = STORAGE_ROW;
+    schema->column_count = plan->schemas[0]->column_count + plan->schemas[1]->column_count;
+    schema->columns = arena_calloc(arena, sizeof(ColumnSchema) * schema->column_count);
+    int column = 0;
+    for (int t = 0; t < 2; t++) {
+        const TableSchema* table = plan->schemas[t];
+        for (int i = 0; i < table->column_count; i++, column++) {
+            ColumnSchema* joined = &schema->columns[column];
+            *joined = table->columns[i];
+            if (snprintf(joined->column_name, sizeof(joined->column_name), "%s.%s", plan->table_names[t],
+                         table->columns[i].column_name) >= (int)sizeof(joined->column_name)) {
+                out_printf("Cannot join: column name %s.%s is longer than %d characters\n",
+                           plan->table_names[t], table->columns[i].column_name, COLUMN_NAME_SIZE - 1);
+                return NULL;
+            }
+            joined->offset += schema->row_size;
+        }
+        schema->row_size += table->row_size;
+        schema->overflow_columns += table->overflow_columns;
+    }
+    return plan;
+}
+
+/* ============================================
+   TABLES
+   ============================================ */
+
+static int open_input(JoinScan* scan, int t, const char* needed, Arena* arena) {
+    const JoinPlan* plan = scan->plan;
+    const char* table_name = plan->table_names[t];
+    JoinInput* input = &scan->inputs[t];
+    input->schema = plan->schemas[t];
+
+    char table_path[256];
+    snprintf(table_path, sizeof(table_path), "databases\\%s\\%s.table", scan->db_name, table_name);
+    input->table_file = bp_open(table_path);
+    if (input->table_file == -1) {
+        out_perror("Failed to open table file");
+        return 0;
+    }
+    bp_read(input->table_file, 0, &input->row_count, sizeof(int));
+    input->size = (long)input->row_count * input->schema->row_size;
+
+    if (input->schema->storage == STORAGE_COLUMN) {
+        char* columns = arena_calloc(arena, input->schema->column_count);
+        int first = t == 0 ? 0 : plan->schemas[0]->column_count;
+        for (int i = 0; i < input->schema->column_count; i++) {
+            columns[i] = needed[first + i] || i == plan->key_columns[t];
+        }
+        if (!column_scan_open(&input->columns, scan->db_name, table_name, input->schema, columns,
+                              input->row_count, arena)) {
+            out_printf("Failed to map column files for '%s'\n", table_name);
+            return 0;
+        }
+        input->columnar = 1;
+    } else {
+        bp_flush(input->table_file);
+        input->map = table_map(table_path, sizeof(int) + input->size);
+    }
+
+    if (input->schema->overflow_columns > 0) {
+        char overflow_path[256];
+        snprintf(overflow_path, sizeof(overflow_path), "databases\\%s\\%s.ovf", scan->db_name, table_name);
+        int overflow_file = bp_open(overflow_path);
+        uint64_t overflow_used = 0;
+        if (overflow_file != -1) {
+            bp_read(overflow_file, 0, &overflow_used, sizeof(uint64_t));
+            bp_flush(overflow_file);
+            bp_release(overflow_file);
+            input->overflow_map = table_map(overflow_path, (long)overflow_used);
+        }
+        if (!input->overflow_map) {
+            out_printf("Failed to map overflow file for '%s'\n", table_name);
+            return 0;
+        }
+        input->size += (long)overflow_used;
+        scan->overflow = input->overflow_map->data;
+    }
+
+    // Only a B-tree on the join column helps
+    input->index = load_index(scan->db_name, table_name);
+    if (input->index && input->index->header.key_column != plan->key_columns[t]) {
+        btree_close(input->index);
+        input->index = NULL;
+    }
+    return 1;
+}
+
+int join_open(JoinScan* scan, const JoinPlan* plan, const char* db_name, const char* needed,
+              Arena* arena) {
+    memset(scan, 0, sizeof(*scan));
+    scan->plan = plan;
+    snprintf(scan->db_name, sizeof(scan->db_name), "%s", db_name);
+    for (int t = 0; t < 2; t++) {
+        if (!open_input(scan, t, needed, arena)) {
+            join_close(scan);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void join_close(JoinScan* scan) {
+    for (int t = 0; t < 2; t++) {
+        JoinInput* input = &scan->inputs[t];
+        table_release(input->map);
+        table_release(input->overflow_map);
+        if (input->columnar) {
+            column_scan_close(&input->columns);
+        }
+        if (input->index) {
+            btree_close(input->index);
+        }
+        if (input->schema) {
+            bp_release(input->table_file);
+        }
+        memset(input, 0, sizeof(*input));
+    }
+}
+
+/* Row row_id of a table: in the mapping, or copied into buffer */
+static const char* fetch_row(const JoinInput* input, int row_id, char* buffer) {
+    long row_offset = sizeof(int) + (long)row_id * input->schema->row_size;
+    if (input->columnar) {
+        column_scan_fetch(&input->columns, row_id, buffer);
+    } else if (input->map) {
+        return input->map->data + row_offset;
+    } else {
+        bp_read(input->table_file, row_offset, buffer, input->schema->row_size);
+    }
+    return buffer;
+}
+
+/* ============================================
+   KEYS
+   ============================================ */
+
+static uint64_t mix(uint64_t hash, uint64_t word) {
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 32);
+}
+
+/* Hash of a row's join key by value, so both tables hash equal keys alike */
+static uint64_t key_hash(const JoinScan* scan, int t, const char* row) {
+    const ColumnSchema* column = &scan->plan->schemas[t]->columns[scan->plan->key_columns[t]];
+    const char* field = row + column->offset;
+    uint64_t hash = 0;
+    switch (column->type) {
+        case TYPE_DOUBLE: {
+            double value;
+            memcpy(&value, field, sizeof(double));
+            if (value == 0.0) value = 0.0;     // -0.0 joins 0.0
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            hash = mix(hash, bits);
+            break;
+        }
+        case TYPE_VARCHAR: {
+            const char* text;
+            int length = varchar_text(field, column->width, column->overflow, scan->overflow, &text);
+            hash = mix(hash, (uint64_t)length);
+            for (; length >= 8; text += 8, length -= 8) {
+                uint64_t word;
+                memcpy(&word, text, 8);
+                hash = mix(hash, word);
+            }
+            if (length > 0) {
+                uint64_t word = 0;
+                memcpy(&word, text, length);
+                hash = mix(hash, word);
+            }
+            break;
+        }
+        default: {
+            int value;
+            memcpy(&value, field, sizeof(int));
+            hash = mix(hash, (uint32_t)value);
+        }
+    }
+    // Finish so the top bits (partitions) and low bits (buckets) both vary
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ull;
+    return hash ^ (hash >> 32);
+}
+
+/* Whether a row of each table has the same join key */
+static int keys_equal(const JoinScan* scan, const char* first, const char* second) {
+    const ColumnSchema* x = &scan->plan->schemas[0]->columns[scan->plan->key_columns[0]];
+    const ColumnSchema* y = &scan->plan->schemas[1]->columns[scan->plan->key_columns[1]];
+    switch (x->type) {
+        case TYPE_DOUBLE: {
+            double a;
+            double b;
+            memcpy(&a, first + x->offset, sizeof(double));
+            memcpy(&b, second + y->offset, sizeof(double));
+            return a == b;
+        }
+        case TYPE_VARCHAR: {
+            const char* a_text;
+            const char* b_text;
+            int a_length = varchar_text(first + x->offset, x->width, x->overflow, scan->overflow, &a_text);
+            int b_length = varchar_text(second + y->offset, y->width, y->overflow, scan->overflow, &b_text);
+            return a_length == b_length && memcmp(a_text, b_text, a_length) == 0;
+        }
+        default:
+            return memcmp(first + x->offset, second + y->offset, sizeof(int)) == 0;
+    }
+}
+
+/* Key of an int or date join column, for an index lookup */
+static int int_key(const JoinScan* scan, int t, const char* row) {
+    int value;
+    memcpy(&value, row + scan->plan->schemas[t]->columns[scan->plan->key_columns[t]].offset, sizeof(int));
+    return value;
+}
+
+/* ============================================
+   ROW STREAMS
+   ============================================ */
+
+/* Rows of one table read in order, or read back from a partition file,
+   where each row follows its key hash */
+typedef struct {
+    const JoinScan* scan;
+    int table;                  // Which table's rows
+    int row_size;
+    const JoinInput* input;     // Table rows, if file is NULL
+    FILE* file;
+    int next;                   // Next row id of the table
+    int block_start;            // Column table: rows stitched into block
+    int block_count;
+    char* block;
+    char* scratch;
+    char* record;               // Hash and row read from a partition or the buffer pool
+} JoinStream;
+
+static void stream_open(JoinStream* stream, const JoinScan* scan, int table, FILE* file) {
+    memset(stream, 0, sizeof(*stream));
+    stream->scan = scan;
+    stream->table = table;
+    stream->row_size = scan->plan->schemas[table]->row_size;
+    stream->input = &scan->inputs[table];
+    stream->file = file;
+    stream->record = malloc(sizeof(uint64_t) + stream->row_size);
+    if (!file && stream->input->columnar) {
+        stream->block = malloc((size_t)FILTER_BATCH_SIZE * stream->row_size);
+        stream->scratch = malloc(stream->input->columns.scratch_size);
+    }
+}
+
+static void stream_close(JoinStream* stream) {
+    free(stream->record);
+    free(stream->block);
+    free(stream->scratch);
+}
+
+/* The next row and its key hash, or NULL at the end */
+static const char* stream_next(JoinStream* stream, uint64_t* hash) {
+    if (stream->file) {
+        if (fread(stream->record, sizeof(uint64_t) + stream->row_size, 1, stream->file) != 1) return NULL;
+        memcpy(hash, stream->record, sizeof(uint64_t));
+        return stream->record + sizeof(uint64_t);
+    }
+
+    const JoinInput* input = stream->input;
+    if (stream->next >= input->row_count) return NULL;
+    int row_id = stream->next++;
+    const char* row;
+    if (input->columnar) {
+        // Stitch a block at a time; blocks start at multiples of the batch size
+        if (row_id >= stream->block_start + stream->block_count) {
+            stream->block_start = row_id;
+            stream->block_count = input->row_count - row_id < FILTER_BATCH_SIZE ? input->row_count - row_id
+                                                                                : FILTER_BATCH_SIZE;
+            column_scan_rows(&input->columns, row_id, stream->block_count, NULL, stream->block_count,
+                             stream->block, stream->scratch);
+        }
+        row = stream->block + (long)(row_id - stream->block_start) * stream->row_size;
+    } else {
+        row = fetch_row(input, row_id, stream->record);
+    }
+    *hash = key_hash(stream->scan, stream->table, row);
+    return row;
+}
+
+/* ============================================
+   OUTPUT
+   ============================================ */
+
+typedef struct {
+    JoinScan* scan;
+    Predicate* predicate;
+    ResultSink* sink;
+    char* joined;               // Joined row being built
+    long matched;
+} JoinOutput;
+
+/* Pass the joined row of a row of each table if it matches the WHERE clause */
+static void emit(JoinOutput* output, const char* first, const char* second) {
+    int first_size = output->scan->plan->schemas[0]->row_size;
+    memcpy(output->joined, first, first_size);
+    memcpy(output->joined + first_size, second, output->scan->plan->schemas[1]->row_size);
+    if (output->predicate && !predicate_matches(output->predicate, output->joined)) return;
+    result_row(output->sink, output->joined);
+    output->matched++;
+}
+
+/* ============================================
+   INDEX NESTED LOOP
+   ============================================ */
+
+static void index_join(JoinOutput* output, int inner) {
+    JoinScan* scan = output->scan;
+    int outer = 1 - inner;
+    const JoinInput* indexed = &scan->inputs[inner];
+    char* buffer = malloc(indexed->schema->row_size);
+
+    JoinStream stream;
+    stream_open(&stream, scan, outer, NULL);
+    uint64_t hash;
+    const char* row;
+    while (!result_done(output->sink) && (row = stream_next(&stream, &hash))) {
+        int key = int_key(scan, outer, row);
+        BTreeCursor cursor;
+        BTreeEntry entry;
+        btree_seek(indexed->index, key, &cursor);
+        while (!result_done(output->sink) && btree_cursor_next(&cursor, &entry) && entry.key == key) {
+            if (entry.row_id >= indexed->row_count) continue;
+            const char* match = fetch_row(indexed, entry.row_id, buffer);
+            if (outer == 0) {
+                emit(output, row, match);
+            } else {
+                emit(output, match, row);
+            }
+        }
+        btree_cursor_close(&cursor);
+    }
+    stream_close(&stream);
+    free(buffer);
+}
+
+/* ============================================
+   HASH JOIN
+   ============================================ */
+
+/* Build-side rows after their hashes, chained per bucket */
+typedef struct {
+    size_t record_size;
+    char* records;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t* buckets;          // First record + 1, 0 if empty
+    uint32_t* chain;            // Next record + 1 in the same bucket
+    uint32_t mask;
+} JoinHash;
+
+#define JOIN_RECORD(hash, index) ((hash)->records + (size_t)(index) * (hash)->record_size)
+
+/* Bytes the hash table holds per build row */
+static size_t hash_row_bytes(int row_size) {
+    return sizeof(uint64_t) + row_size + 3 * sizeof(uint32_t);
+}
+
+/* Load every build row into a hash table and probe it with every probe row */
+static void hash_join(JoinOutput* output, int build, JoinStream* build_rows, JoinStream* probe_rows) {
+    JoinHash hash;
+    memset(&hash, 0, sizeof(hash));
+    hash.record_size = sizeof(uint64_t) + build_rows->row_size;
+
+    uint64_t key;
+    const char* row;
+    while ((row = stream_next(build_rows, &key))) {
+        if (hash.count == hash.capacity) {
+            hash.capacity = hash.capacity ? hash.capacity * 2 : JOIN_INITIAL_ROWS;
+            hash.records = realloc(hash.records, (size_t)hash.capacity * hash.record_size);
+        }
+        char* record = JOIN_RECORD(&hash, hash.count++);
+        memcpy(record, &key, sizeof(uint64_t));
+        memcpy(record + sizeof(uint64_t), row, build_rows->row_size);
+    }
+    if (hash.count == 0) {
+        free(hash.records);
+        return;
+    }
+
+    uint32_t buckets = 1;
+    while (buckets < hash.count) buckets <<= 1;
+    hash.mask = buckets - 1;
+    hash.buckets = calloc(buckets, sizeof(uint32_t));
+    hash.chain = malloc(sizeof(uint32_t) * hash.count);
+    for (uint32_t i = hash.count; i-- > 0;) {
+        uint64_t record_hash;
+        memcpy(&record_hash, JOIN_RECORD(&hash, i), sizeof(uint64_t));
+        uint32_t bucket = (uint32_t)record_hash & hash.mask;
+        hash.chain[i] = hash.buckets[bucket];
+        hash.buckets[bucket] = i + 1;
+    }
+
+    while (!result_done(output->sink) && (row = stream_next(probe_rows, &key))) {
+        for (uint32_t entry = hash.buckets[(uint32_t)key & hash.mask]; entry && !result_done(output->sink);
+             entry = hash.chain[entry - 1]) {
+            const char* record = JOIN_RECORD(&hash, entry - 1);
+            uint64_t record_hash;
+            memcpy(&record_hash, record, sizeof(uint64_t));
+            if (record_hash != key) continue;
+            const char* match = record + sizeof(uint64_t);
+            const char* first = build == 0 ? match : row;
+            const char* second = build == 0 ? row : match;
+            if (keys_equal(output->scan, first, second)) {
+                emit(output, first, second);
+            }
+        }
+    }
+
+    free(hash.records);
+    free(hash.buckets);
+    free(hash.chain);
+}
+
+static int partition_of(uint64_t hash, int depth) {
+    return (int)(hash >> (64 - JOIN_PARTITION_BITS * (depth + 1))) & (JOIN_PARTITIONS - 1);
+}
+
+/* Write a stream's rows to the partition files their hashes select */
+static void partition_rows(JoinStream* stream, SpillFile* partitions, long* counts, int depth) {
+    uint64_t hash;
+    const char* row;
+    while ((row = stream_next(stream, &hash))) {
+        int partition = partition_of(hash, depth);
+        fwrite(&hash, sizeof(uint64_t), 1, partitions[partition].file);
+        fwrite(row, stream->row_size, 1, partitions[partition].file);
+        if (counts) counts[partition]++;
+    }
+}
+
+/* Hash join in memory if the build rows fit the budget; otherwise split
+   both sides into partitions and join each pair the same way */
+static void grace_join(JoinOutput* output, int build, JoinStream* build_rows, long build_count,
+                       JoinStream* probe_rows, int depth) {
+    JoinScan* scan = output->scan;
+    if ((size_t)build_count * hash_row_bytes(build_rows->row_size) <= work_memory() ||
+        depth == JOIN_MAX_DEPTH) {
+        hash_join(output, build, build_rows, probe_rows);
+        return;
+    }
+
+    SpillFile partitions[2][JOIN_PARTITIONS];
+    memset(partitions, 0, sizeof(partitions));
+    int opened = 1;
+    for (int side = 0; side < 2 && opened; side++) {
+        for (int p = 0; p < JOIN_PARTITIONS && opened; p++) {
+            opened = spill_open(&partitions[side][p], scan->db_name);
+        }
+    }
+    if (!opened) {
+        // Could not create the spill files: join in memory after all
+        for (int side = 0; side < 2; side++) {
+            for (int p = 0; p < JOIN_PARTITIONS; p++) spill_remove(&partitions[side][p]);
+        }
+        hash_join(output, build, build_rows, probe_rows);
+        return;
+    }
+
+    long counts[JOIN_PARTITIONS] = { 0 };
+    partition_rows(build_rows, partitions[0], counts, depth);
+    partition_rows(probe_rows, partitions[1], NULL, depth);
+
+    for (int p = 0; p < JOIN_PARTITIONS; p++) {
+        if (counts[p] > 0 && !result_done(output->sink)) {
+            spill_rewind(&partitions[0][p]);
+            spill_rewind(&partitions[1][p]);
+            JoinStream build_part;
+            JoinStream probe_part;
+            stream_open(&build_part, scan, build_rows->table, partitions[0][p].file);
+            stream_open(&probe_part, scan, probe_rows->table, partitions[1][p].file);
+            grace_join(output, build, &build_part, counts[p], &probe_part, depth + 1);
+            stream_close(&build_part);
+            stream_close(&probe_part);
+        }
+        spill_remove(&partitions[0][p]);
+        spill_remove(&partitions[1][p]);
+    }
+}
+
+long join_rows(JoinScan* scan, Predicate* predicate, ResultSink* sink) {
+    JoinOutput output = { scan, predicate, sink, malloc(scan->plan->schema.row_size), 0 };
+
+    // Look rows up in a B-tree on the join column (the larger table's if
+    // both have one) and scan the other table
+    int inner = -1;
+    for (int t = 0; t < 2; t++) {
+        if (scan->inputs[t].index && (inner < 0 || scan->inputs[t].size > scan->inputs[inner].size)) {
+            inner = t;
+        }
+    }
+    if (inner >= 0) {
+        index_join(&output, inner);
+    } else {
+        // Build on the smaller table, probe with the larger
+        int build = scan->inputs[1].size < scan->inputs[0].size ? 1 : 0;
+        JoinStream build_rows;
+        JoinStream probe_rows;
+        stream_open(&build_rows, scan, build, NULL);
+        stream_open(&probe_rows, scan, 1 - build, NULL);
+        grace_join(&output, build, &build_rows, scan->inputs[build].row_count, &probe_rows, 0);
+        stream_close(&build_rows);
+        stream_close(&probe_rows);
+    }
+
+    free(output.joined);
+    return output.matched;
+}
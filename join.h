@@ -0,0 +1,92 @@
+#ifndef JOIN_H
+#define JOIN_H
+
+#include <stdint.h>
+#include "ast.h"
+#include "executor.h"
+#include "column_store.h"
+#include "table_map.h"
+#include "result.h"
+
+/* =======================
+   JOINS
+   ======================= */
+
+/*
+ * SELECT ... FROM a JOIN b ON a.x = b.y is an inner equi-join. Columns
+ * are named table.column; a name without its table is qualified with the
+ * one table that has it. A joined row is a's row followed by b's, so the
+ * WHERE clause, aggregates, GROUP BY, ORDER BY and LIMIT run on joined
+ * rows through the same predicate, aggregate and sort code as one table.
+ *
+ * The join picks one of three methods:
+ *
+ *   index nested loop  when a table's B-tree is keyed on its join column,
+ *                      the other table is scanned and each row looks its
+ *                      matches up in that index (the larger table's, if
+ *                      both have one).
+ *   hash join          otherwise the smaller table, by row count times
+ *                      row size plus its overflow file, is loaded into a
+ *                      chained hash table on the join key, and the larger
+ *                      table is scanned to probe it.
+ *   grace hash join    when the smaller table does not fit in the
+ *                      work_memory budget (spill.h), both tables are
+ *                      first split into JOIN_PARTITIONS spill files by the
+ *                      key's hash, and each pair of partitions is joined
+ *                      on its own, partitioning again on the next hash
+ *                      bits while it is still too big.
+ *
+ * Long varchars are read from one overflow mapping, so at most one of the
+ * two tables may have long VARCHAR(n) columns. Joins run under the engine
+ * lock on a single thread.
+ */
+
+#define JOIN_PARTITION_BITS 4
+#define JOIN_PARTITIONS (1 << JOIN_PARTITION_BITS)
+#define JOIN_MAX_DEPTH 8                // Partitioning levels in the hash's top 32 bits
+#define JOIN_INITIAL_ROWS 1024
+
+typedef struct JoinPlan {
+    const char* table_names[2];
+    TableSchema* schemas[2];        // Owned by the catalog
+    int key_columns[2];             // Join column in each table's schema
+    TableSchema schema;             // Joined rows: a's columns, then b's
+} JoinPlan;
+
+/* One table of a running join */
+typedef struct {
+    TableSchema* schema;
+    int row_count;
+    int table_file;
+    MappedTable* map;               // Row table rows, or NULL
+    int columnar;
+    ColumnScan columns;             // Column table columns
+    MappedTable* overflow_map;
+    BTree* index;                   // B-tree keyed on the join column, or NULL
+    long size;                      // Bytes of rows and long values
+} JoinInput;
+
+typedef struct {
+    const JoinPlan* plan;
+    JoinInput inputs[2];
+    const char* overflow;           // The one overflow mapping, or NULL
+    char db_name[128];
+} JoinScan;
+
+/* Resolve FROM table JOIN ... ON of a SELECT: reads both schemas, lays
+   out the joined row and qualifies every column name in the statement.
+   Returns NULL after printing an error. */
+JoinPlan* join_plan(ASTNode* select, const char* db_name, Arena* arena);
+
+/* Open both tables, mapping the joined columns flagged in needed (one
+   flag per joined column). Returns 0 after printing an error. */
+int join_open(JoinScan* scan, const JoinPlan* plan, const char* db_name, const char* needed,
+              Arena* arena);
+
+/* Join the tables, passing joined rows that match the predicate to the
+   sink until its LIMIT is written. Returns how many rows matched. */
+long join_rows(JoinScan* scan, struct Predicate* predicate, ResultSink* sink);
+
+void join_close(JoinScan* scan);
+
+#endif
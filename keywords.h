@@ -0,0 +1,61 @@
+/* Generated by tools/gen_keywords.c -- do not edit */
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#define KEYWORD_HASH_SEED 248u
+#define KEYWORD_HASH_MASK 127u
+#define KEYWORD_MAX_LENGTH 9
+
+/* Keywords are lowercase; the input is lowercased before hashing */
+static unsigned int keyword_hash(const char* text, int length) {
+    unsigned int h = KEYWORD_HASH_SEED ^ (unsigned int)length;
+    h = h * 31 + (unsigned char)text[0];
+    h = h * 31 + (unsigned char)text[length / 2];
+    h = h * 31 + (unsigned char)text[length - 1];
+    h ^= h >> 7;
+    return h & KEYWORD_HASH_MASK;
+}
+
+static const struct {
+    const char* text;
+    int length;
+    TokenType type;
+} keyword_slots[128] = {
+    [0] = { "insert", 6, TOKEN_INSERT },
+    [6] = { "databases", 9, TOKEN_DATABASES },
+    [9] = { "show", 4, TOKEN_SHOW },
+    [14] = { "database", 8, TOKEN_DATABASE },
+    [15] = { "by", 2, TOKEN_BY },
+    [17] = { "use", 3, TOKEN_USE },
+    [18] = { "or", 2, TOKEN_OR },
+    [19] = { "on", 2, TOKEN_ON },
+    [24] = { "offset", 6, TOKEN_OFFSET },
+    [25] = { "table", 5, TOKEN_TABLE },
+    [26] = { "double", 6, TOKEN_DOUBLE },
+    [30] = { "desc", 4, TOKEN_DESC },
+    [32] = { "where", 5, TOKEN_WHERE },
+    [36] = { "distinct", 8, TOKEN_DISTINCT },
+    [41] = { "values", 6, TOKEN_VALUES },
+    [49] = { "asc", 3, TOKEN_ASC },
+    [60] = { "prepare", 7, TOKEN_PREPARE },
+    [63] = { "limit", 5, TOKEN_LIMIT },
+    [65] = { "select", 6, TOKEN_SELECT },
+    [66] = { "join", 4, TOKEN_JOIN },
+    [76] = { "execute", 7, TOKEN_EXECUTE },
+    [77] = { "load", 4, TOKEN_LOAD },
+    [79] = { "group", 5, TOKEN_GROUP },
+    [83] = { "tables", 6, TOKEN_TABLES },
+    [86] = { "storage", 7, TOKEN_STORAGE },
+    [89] = { "and", 3, TOKEN_AND },
+    [98] = { "varchar", 7, TOKEN_VARCHAR },
+    [100] = { "into", 4, TOKEN_INTO },
+    [101] = { "create", 6, TOKEN_CREATE },
+    [115] = { "data", 4, TOKEN_DATA },
+    [118] = { "int", 3, TOKEN_INT },
+    [121] = { "as", 2, TOKEN_AS },
+    [124] = { "from", 4, TOKEN_FROM },
+    [126] = { "order", 5, TOKEN_ORDER },
+    [127] = { "date", 4, TOKEN_DATE },
+};
+
+#endif
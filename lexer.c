@@ -2,82 +2,26 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include "keywords.h"
 
 
-typedef struct {
-    const char* key;
-    TokenType value;
-} Keyword;
+/* Perfect hash over the keywords, generated by tools/gen_keywords.c */
+static TokenType keyword_lookup(const char* text, int length) {
+    if (length > KEYWORD_MAX_LENGTH) return TOKEN_IDENTIFIER;
 
-#define KEYWORD_TABLE_SIZE 32
-static Keyword keyword_table[KEYWORD_TABLE_SIZE];  
-
-static unsigned int hash(const char* str) {
-    unsigned int hash = 2166136261u;  // FNV offset basis
-    while (*str) {
-        hash ^= (unsigned char)tolower(*str);  // case-insensitive
-        hash *= 16777619u;                     // FNV prime
-        str++;
-    }
-    return hash % KEYWORD_TABLE_SIZE;
-}
-
-
-/* Convert string to lowercase */
-void toLower(char* input) {
-    for (int i = 0; input[i] != '\0'; i++) {
-        input[i] = tolower((unsigned char)input[i]);
-    }
-}
-
-
-static void keyword_insert(const char* key, TokenType value) {
-    unsigned int index = hash(key);
-    while (keyword_table[index].key != NULL) {
-        index = (index + 1) % KEYWORD_TABLE_SIZE;
+    char lower[KEYWORD_MAX_LENGTH];
+    for (int i = 0; i < length; i++) {
+        lower[i] = (char)tolower((unsigned char)text[i]);
     }
-    keyword_table[index].key = key;
-    keyword_table[index].value = value;
-}
-
 
-static TokenType keyword_lookup(const char* key) {
-    unsigned int index = hash(key);
-    while (keyword_table[index].key != NULL) {
-        if (strcasecmp(keyword_table[index].key, key) == 0) {
-            return keyword_table[index].value;
-        }
-        index = (index + 1) % KEYWORD_TABLE_SIZE;
+    unsigned int slot = keyword_hash(lower, length);
+    if (keyword_slots[slot].length == length && memcmp(keyword_slots[slot].text, lower, length) == 0) {
+        return keyword_slots[slot].type;
     }
     return TOKEN_IDENTIFIER;
 }
 
 
-void init_keywords() {
-    keyword_insert("select", TOKEN_SELECT);
-    keyword_insert("create", TOKEN_CREATE);
-    keyword_insert("table", TOKEN_TABLE);
-    keyword_insert("database", TOKEN_DATABASE);
-    keyword_insert("show", TOKEN_SHOW);
-    keyword_insert("databases", TOKEN_DATABASES);
-    keyword_insert("tables", TOKEN_TABLES);
-    keyword_insert("insert", TOKEN_INSERT);
-    keyword_insert("into", TOKEN_INTO);
-    keyword_insert("values", TOKEN_VALUES);
-    keyword_insert("from", TOKEN_FROM);
-    keyword_insert("use", TOKEN_USE);
-    keyword_insert("where", TOKEN_WHERE);
-    keyword_insert("and", TOKEN_AND);
-    keyword_insert("or", TOKEN_OR);
-
-
-    keyword_insert("varchar", TOKEN_VARCHAR);
-    keyword_insert("int", TOKEN_INT);
-    keyword_insert("double", TOKEN_DOUBLE);
-    keyword_insert("date", TOKEN_DATE);
-}
-
-
 
 char peek(Lexer* lexer) {
     return lexer->input[lexer->pos];
@@ -92,13 +36,15 @@ static Token read_word(Lexer* lexer) {
     Token token;
     int start = lexer->pos;
 
-    while (isalnum(peek(lexer)) || peek(lexer) == '_') advance(lexer);
-
-    int length = lexer->pos - start;
-    strncpy(token.lexeme, lexer->input + start, length);
-    token.lexeme[length] = '\0';
+    // A dot between names qualifies a column with its table: orders.id
+    while (isalnum(peek(lexer)) || peek(lexer) == '_' ||
+           (peek(lexer) == '.' && (isalpha(lexer->input[lexer->pos + 1]) || lexer->input[lexer->pos + 1] == '_'))) {
+        advance(lexer);
+    }
 
-    token.type = keyword_lookup(token.lexeme);
+    token.offset = start;
+    token.length = lexer->pos - start;
+    token.type = keyword_lookup(lexer->input + start, token.length);
     return token;
 }
 
@@ -106,11 +52,17 @@ static Token read_number(Lexer* lexer) {
     Token token;
     int start = lexer->pos;
 
+    if (peek(lexer) == '-') advance(lexer);
     while (isdigit(peek(lexer))) advance(lexer);
 
-    int length = lexer->pos - start;
-    strncpy(token.lexeme, lexer->input + start, length);
-    token.lexeme[length] = '\0';
+    // Optional fractional part for double literals
+    if (peek(lexer) == '.' && isdigit(lexer->input[lexer->pos + 1])) {
+        advance(lexer);
+        while (isdigit(peek(lexer))) advance(lexer);
+    }
+
+    token.offset = start;
+    token.length = lexer->pos - start;
     token.type = TOKEN_NUMBER;
     return token;
 }
@@ -122,9 +74,8 @@ static Token read_string(Lexer* lexer) {
 
     while (peek(lexer) != quote && peek(lexer) != '\0') advance(lexer);
 
-    int length = lexer->pos - start;
-    strncpy(token.lexeme, lexer->input + start, length);
-    token.lexeme[length] = '\0';
+    token.offset = start;      // Quotes excluded
+    token.length = lexer->pos - start;
     token.type = TOKEN_STRING;
 
     if (peek(lexer) == quote) advance(lexer);
@@ -138,50 +89,52 @@ Token next_token(Lexer* lexer) {
     while (isspace(peek(lexer))) advance(lexer);
 
     char c = peek(lexer);
+    token.offset = lexer->pos;
+    token.length = 0;
 
     if (c == '\0') {
         token.type = TOKEN_EOF;
-        token.lexeme[0] = '\0';
         return token;
     }
 
     if (isalpha(c)) return read_word(lexer);
     if (isdigit(c)) return read_number(lexer);
+    if (c == '-' && isdigit(lexer->input[lexer->pos + 1])) return read_number(lexer);
     if (c == '"' || c == '\'') return read_string(lexer);
 
     advance(lexer);
+    token.length = 1;
 
     switch (c) {
-        case '*': token.type = TOKEN_STAR; strcpy(token.lexeme, "*"); break;
-        case ',': token.type = TOKEN_COMMA; strcpy(token.lexeme, ","); break;
-        case ';': token.type = TOKEN_SEMICOLON; strcpy(token.lexeme, ";"); break;
-        case '=': token.type = TOKEN_EQUAL; strcpy(token.lexeme, "="); break;
-        case '(': token.type = TOKEN_LEFT_PAREN; strcpy(token.lexeme, "("); break;
-        case ')': token.type = TOKEN_RIGHT_PAREN; strcpy(token.lexeme, ")"); break;
+        case '*': token.type = TOKEN_STAR; break;
+        case ',': token.type = TOKEN_COMMA; break;
+        case ';': token.type = TOKEN_SEMICOLON; break;
+        case '=': token.type = TOKEN_EQUAL; break;
+        case '(': token.type = TOKEN_LEFT_PAREN; break;
+        case ')': token.type = TOKEN_RIGHT_PAREN; break;
+        case '?': token.type = TOKEN_PARAM; break;
 
         case '>':
             if (peek(lexer) == '=') {
                 advance(lexer);
                 token.type = TOKEN_GREATER_EQUAL;
-                strcpy(token.lexeme, ">=");
+                token.length = 2;
             } else {
                 token.type = TOKEN_GREATER;
-                strcpy(token.lexeme, ">");
             }
             break;
         case '<':
             if (peek(lexer) == '=') {
                 advance(lexer);
                 token.type = TOKEN_LESS_EQUAL;
-                strcpy(token.lexeme, "<=");
+                token.length = 2;
             } else {
                 token.type = TOKEN_LESS;
-                strcpy(token.lexeme, "<");
             }
             break;
         default:
             token.type = TOKEN_EOF;
-            token.lexeme[0] = '\0';
+            token.length = 0;
     }
 
     return token;
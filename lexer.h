@@ -25,6 +25,22 @@ typedef enum {
     TOKEN_DATE,
     TOKEN_INTO,
     TOKEN_VALUES,
+    TOKEN_LOAD,
+    TOKEN_DATA,
+    TOKEN_PREPARE,
+    TOKEN_EXECUTE,
+    TOKEN_AS,
+    TOKEN_STORAGE,
+    TOKEN_DISTINCT,
+    TOKEN_GROUP,
+    TOKEN_BY,
+    TOKEN_ORDER,
+    TOKEN_ASC,
+    TOKEN_DESC,
+    TOKEN_LIMIT,
+    TOKEN_OFFSET,
+    TOKEN_JOIN,
+    TOKEN_ON,
 
     /* Symbols */
     TOKEN_STAR,
@@ -42,6 +58,7 @@ typedef enum {
     /* Literals */
     TOKEN_NUMBER,
     TOKEN_STRING,
+    TOKEN_PARAM,        // ? placeholder in a prepared statement
 
     /* Identifiers */
     TOKEN_IDENTIFIER,
@@ -52,9 +69,11 @@ typedef enum {
 
 
 
+/* A token is a slice of the input buffer; nothing is copied while lexing */
 typedef struct {
     TokenType type;
-    char lexeme[64];
+    int offset;             // Start of the lexeme in the input
+    int length;
 } Token;
 
 
@@ -65,13 +84,13 @@ typedef struct {
 } Lexer;
 
 
-void init_keywords(void);
-
-
-void toLower(char* input) ;
-
 Token next_token(Lexer* lexer);
 
+/* First character of a token's lexeme */
+static inline const char* token_start(const Lexer* lexer, Token token) {
+    return lexer->input + token.offset;
+}
+
 
 char peek(Lexer* lexer);
 char advance(Lexer* lexer);
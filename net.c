@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <string.h>
+#include "net.h"
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+
+/* A peer that hangs up mid-response must fail the send, not raise SIGPIPE
+   and end the process. Linux says so per send; BSD and macOS per socket. */
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+int net_init(void) {
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+        printf("Failed to start Winsock\n");
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+static int resolve(const char* host, int port, int passive, struct addrinfo** result) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+    if (getaddrinfo(host ? host : "127.0.0.1", service, &hints, result) != 0) {
+        printf("Cannot resolve '%s'\n", host ? host : "127.0.0.1");
+        return 0;
+    }
+    return 1;
+}
+
+/* Statements and responses are small; send them without Nagle's delay */
+static void set_options(Socket socket) {
+    int on = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+    setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&on, sizeof(on));
+#endif
+}
+
+Socket net_listen(const char* host, int port) {
+    struct addrinfo* address;
+    if (!resolve(host, port, 1, &address)) return NET_INVALID;
+
+    Socket listener = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (listener == NET_INVALID) {
+        perror("Failed to create socket");
+        freeaddrinfo(address);
+        return NET_INVALID;
+    }
+
+    int on = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    if (bind(listener, address->ai_addr, (int)address->ai_addrlen) != 0 || listen(listener, 64) != 0) {
+        perror("Failed to listen");
+        net_close(listener);
+        listener = NET_INVALID;
+    }
+    freeaddrinfo(address);
+    return listener;
+}
+
+Socket net_accept(Socket listener) {
+    Socket client = accept(listener, NULL, NULL);
+    if (client != NET_INVALID) {
+        set_options(client);
+    }
+    return client;
+}
+
+Socket net_connect(const char* host, int port) {
+    struct addrinfo* address;
+    if (!resolve(host, port, 0, &address)) return NET_INVALID;
+
+    Socket connection = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (connection != NET_INVALID &&
+        connect(connection, address->ai_addr, (int)address->ai_addrlen) != 0) {
+        net_close(connection);
+        connection = NET_INVALID;
+    }
+    freeaddrinfo(address);
+    if (connection != NET_INVALID) {
+        set_options(connection);
+    }
+    return connection;
+}
+
+int net_socket_pair(Socket pair[2]) {
+    Socket listener = net_listen(NULL, 0);
+    if (listener == NET_INVALID) return 0;
+
+    // Port 0 picked a free port; connect to whichever it was
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    getsockname(listener, (struct sockaddr*)&address, &length);
+
+    pair[0] = socket(AF_INET, SOCK_STREAM, 0);
+    if (pair[0] == NET_INVALID ||
+        connect(pair[0], (struct sockaddr*)&address, sizeof(address)) != 0) {
+        net_close(listener);
+        return 0;
+    }
+    set_options(pair[0]);
+    pair[1] = net_accept(listener);
+    net_close(listener);
+    return pair[1] != NET_INVALID;
+}
+
+int net_send_all(Socket socket, const void* data, size_t size) {
+    const char* next = data;
+    while (size > 0) {
+        int chunk = size > (1 << 30) ? (1 << 30) : (int)size;
+        int sent = send(socket, next, chunk, SEND_FLAGS);
+        if (sent <= 0) return 0;
+        next += sent;
+        size -= sent;
+    }
+    return 1;
+}
+
+long net_recv(Socket socket, void* data, size_t size) {
+    int chunk = size > (1 << 30) ? (1 << 30) : (int)size;
+    return recv(socket, data, chunk, 0);
+}
+
+int net_recv_all(Socket socket, void* data, size_t size) {
+    char* next = data;
+    while (size > 0) {
+        long received = net_recv(socket, next, size);
+        if (received <= 0) return 0;
+        next += received;
+        size -= received;
+    }
+    return 1;
+}
+
+void net_close(Socket socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+void net_put_u32(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+uint32_t net_get_u32(const unsigned char* in) {
+    return in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
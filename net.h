@@ -0,0 +1,65 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* =======================
+   SOCKETS
+   ======================= */
+
+/*
+ * Blocking TCP sockets over Winsock or BSD sockets, as much as the server
+ * and client library need. Messages on the wire are framed the same way
+ * in both directions:
+ *
+ *   request   u32 length, then the statement or meta-command text
+ *   response  u32 length, u8 status, then the statement's output
+ *
+ * The response length counts the status byte. Little-endian. Requests
+ * on one connection are answered in the order they were sent.
+ */
+
+#ifdef _WIN32
+#include <winsock2.h>
+typedef SOCKET Socket;
+#define NET_INVALID INVALID_SOCKET
+#else
+typedef int Socket;
+#define NET_INVALID (-1)
+#endif
+
+#define NET_DEFAULT_PORT 7707
+#define NET_MAX_MESSAGE (64 * 1024 * 1024)    // Longest request the server accepts
+#define RESPONSE_HEADER_SIZE 5
+
+#define STATUS_OK 0
+#define STATUS_ERROR 1      // Not run: syntax error or unknown meta-command
+
+/* Call once before using sockets (starts Winsock) */
+int net_init(void);
+
+/* Listen on host:port; NULL host means loopback only */
+Socket net_listen(const char* host, int port);
+Socket net_accept(Socket listener);
+Socket net_connect(const char* host, int port);
+
+/* Two connected loopback sockets, for waking a select() loop */
+int net_socket_pair(Socket pair[2]);
+
+/* Write all of data; returns 0 if the connection failed */
+int net_send_all(Socket socket, const void* data, size_t size);
+
+/* Read into data; returns bytes read, 0 at end of stream, -1 on error */
+long net_recv(Socket socket, void* data, size_t size);
+
+/* Read exactly size bytes; returns 0 if the connection ended first */
+int net_recv_all(Socket socket, void* data, size_t size);
+
+void net_close(Socket socket);
+
+/* Little-endian u32 for message lengths */
+void net_put_u32(unsigned char* out, uint32_t value);
+uint32_t net_get_u32(const unsigned char* in);
+
+#endif
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include "output.h"
+#include "platform.h"
+
+static THREAD_LOCAL OutputBuffer* capture;
+
+static char* reserve(OutputBuffer* buffer, size_t size) {
+    if (buffer->length + size + 1 > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (buffer->length + size + 1 > capacity) capacity *= 2;
+        buffer->data = realloc(buffer->data, capacity);
+        buffer->capacity = capacity;
+    }
+    return buffer->data + buffer->length;
+}
+
+void out_printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (!capture) {
+        vprintf(format, args);
+        va_end(args);
+        return;
+    }
+
+    char line[256];
+    va_list again;
+    va_copy(again, args);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    if (length >= 0 && (size_t)length < sizeof(line)) {
+        out_write(line, length);
+    } else if (length >= 0) {
+        vsnprintf(reserve(capture, length), length + 1, format, again);
+        capture->length += length;
+    }
+    va_end(again);
+    va_end(args);
+}
+
+void out_write(const void* data, size_t size) {
+    output_write(capture, data, size);
+}
+
+void output_write(OutputBuffer* target, const void* data, size_t size) {
+    if (!target) {
+        fwrite(data, 1, size, stdout);
+        return;
+    }
+    output_append(target, data, size);
+}
+
+void out_perror(const char* message) {
+    out_printf("%s: %s\n", message, strerror(errno));
+}
+
+void output_capture(OutputBuffer* buffer) {
+    if (!buffer) {
+        fflush(stdout);
+    }
+    capture = buffer;
+}
+
+int output_is_captured(void) {
+    return capture != NULL;
+}
+
+OutputBuffer* output_target(void) {
+    return capture;
+}
+
+void output_append(OutputBuffer* buffer, const void* data, size_t size) {
+    memcpy(reserve(buffer, size), data, size);
+    buffer->length += size;
+}
+
+void output_buffer_free(OutputBuffer* buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
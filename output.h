@@ -0,0 +1,41 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+
+/* =======================
+   STATEMENT OUTPUT
+   ======================= */
+
+/*
+ * Everything a statement prints goes through here. Normally that is
+ * stdout; a server worker captures it into the session's buffer instead,
+ * and sends it back as the response. The capture is per thread.
+ */
+
+typedef struct OutputBuffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+} OutputBuffer;
+
+void out_printf(const char* format, ...);
+void out_write(const void* data, size_t size);
+
+/* Like perror, to the statement output */
+void out_perror(const char* message);
+
+/* Send this thread's output to buffer until output_capture(NULL)
+   restores stdout */
+void output_capture(OutputBuffer* buffer);
+int output_is_captured(void);
+
+/* Where this thread's output goes (NULL for stdout), for writes made on
+   its behalf by other threads, such as parallel scan merges */
+OutputBuffer* output_target(void);
+void output_write(OutputBuffer* target, const void* data, size_t size);
+
+void output_append(OutputBuffer* buffer, const void* data, size_t size);
+void output_buffer_free(OutputBuffer* buffer);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <setjmp.h>
 #include "lexer.h"
 #include "ast.h"
 
@@ -8,17 +9,27 @@
 typedef struct {
     Lexer* lexer;
     Token current;  
+    Arena* arena;       // AST nodes and their strings live here
+    int parameterize;   // Turn literals into parameters (plan cache)
+    int param_count;    // Parameters numbered so far
+    jmp_buf* on_error;  // Set by parse_statement while parsing
+    char error[256];    // Message of the last parse error
 } Parser;
 
 
-void parser_init(Parser* parser, Lexer* lexer);
+void parser_init(Parser* parser, Lexer* lexer, Arena* arena);
 
 
+/* Parse one statement; on a syntax error returns NULL with the message in
+   parser->error, leaving the session running */
 ASTNode* parse_statement(Parser* parser);
 
 
 ASTNode* parse_select(Parser* parser);
 ASTNode* parse_insert(Parser* parser);
+ASTNode* parse_load(Parser* parser);
+ASTNode* parse_prepare(Parser* parser);
+ASTNode* parse_execute(Parser* parser);
 ASTNode* parse_createdatabase(Parser* parser);
 ASTNode* parse_createtable(Parser* parser);
 ASTNode* parse_use(Parser* parser);
@@ -29,8 +40,18 @@ ASTNode* parse_column(Parser* parser);
 ASTNode* parse_column_list(Parser* parser);
 ASTNode* parse_condition(Parser* parser);
 ASTNode* parse_where(Parser* parser);
+ASTNode* parse_join(Parser* parser);
+ASTNode* parse_order_by(Parser* parser);
+ASTNode* parse_row_count(Parser* parser, ASTNodeType type, const char* keyword);
+ASTNode* parse_value(Parser* parser);
 
 void advance_token(Parser* parser);
+
+/* Copy the current token's text into the arena, null-terminated */
+const char* token_text(Parser* parser);
 void expect(Parser* parser, TokenType type);
 
+/* Record a syntax error and unwind to parse_statement */
+_Noreturn void parse_error(Parser* parser, const char* format, ...);
+
 #endif
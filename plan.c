@@ -0,0 +1,345 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "plan.h"
+#include "lexer.h"
+#include "parser.h"
+#include "executor.h"
+#include "catalog.h"
+#include "output.h"
+
+/* ============================================
+   NORMALIZATION
+   ============================================ */
+
+int normalize_statement(const char* input, NormalizedStatement* out, Arena* arena) {
+    Lexer lexer = { input, 0 };
+    Token token = next_token(&lexer);
+    if (token.type != TOKEN_SELECT && token.type != TOKEN_INSERT) {
+        return 0;
+    }
+
+    // Every token shrinks or keeps its length, plus one separating space
+    char* key = arena_alloc(arena, strlen(input) * 2 + 2);
+    const char** slots = arena_alloc(arena, sizeof(const char*) * PLAN_MAX_PARAMS);
+    int length = 0;
+    int slot_count = 0;
+
+    for (; token.type != TOKEN_EOF; token = next_token(&lexer)) {
+        if (length > 0) {
+            key[length++] = ' ';
+        }
+
+        const char* start = token_start(&lexer, token);
+        if (token.type == TOKEN_NUMBER || token.type == TOKEN_STRING || token.type == TOKEN_PARAM) {
+            if (slot_count == PLAN_MAX_PARAMS) {
+                return 0;
+            }
+            slots[slot_count++] = token.type == TOKEN_PARAM ? NULL
+                                                            : arena_strndup(arena, start, token.length);
+            key[length++] = '?';
+        } else if (token.type < TOKEN_STAR) {
+            // Keywords match case-insensitively
+            for (int i = 0; i < token.length; i++) {
+                key[length++] = (char)tolower((unsigned char)start[i]);
+            }
+        } else {
+            memcpy(key + length, start, token.length);
+            length += token.length;
+        }
+    }
+    key[length] = '\0';
+
+    out->text = key;
+    out->slots = slots;
+    out->slot_count = slot_count;
+    return 1;
+}
+
+/* ============================================
+   LRU PLAN CACHE
+   ============================================ */
+
+typedef struct CachedPlan {
+    char* key;                      // "db|normalized text"
+    unsigned int catalog_version;   // Schema pointers are valid while this matches
+    Arena arena;                    // AST and plan
+    QueryPlan* plan;
+    struct CachedPlan* next;        // Hash chain
+    struct CachedPlan* lru_prev;    // Most recently used first
+    struct CachedPlan* lru_next;
+} CachedPlan;
+
+static CachedPlan* buckets[PLAN_CACHE_BUCKETS];
+static CachedPlan* lru_head;
+static CachedPlan* lru_tail;
+static int cached_count;
+
+static unsigned int plan_hash(const char* key) {
+    unsigned int hash = 2166136261u;  // FNV-1a
+    for (const char* p = key; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    return hash % PLAN_CACHE_BUCKETS;
+}
+
+static void lru_unlink(CachedPlan* entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else lru_head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else lru_tail = entry->lru_prev;
+}
+
+static void lru_push_front(CachedPlan* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = entry;
+    lru_head = entry;
+    if (!lru_tail) lru_tail = entry;
+}
+
+static void evict(CachedPlan* entry) {
+    CachedPlan** link = &buckets[plan_hash(entry->key)];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    lru_unlink(entry);
+    cached_count--;
+
+    arena_free(&entry->arena);
+    free(entry->key);
+    free(entry);
+}
+
+/* Cached plan for a normalized statement in the current database, planning
+   statement_text on a miss. Returns NULL if it does not plan, with a syntax
+   error left in *syntax_error (other errors are printed); failed plans are
+   not cached. */
+static QueryPlan* lookup_plan(const char* normalized, const char* statement_text, Arena* scratch,
+                              const char** syntax_error) {
+    size_t key_length = strlen(current_database) + 1 + strlen(normalized);
+    char* key = arena_alloc(scratch, key_length + 1);
+    snprintf(key, key_length + 1, "%s|%s", current_database, normalized);
+
+    unsigned int bucket = plan_hash(key);
+    for (CachedPlan* entry = buckets[bucket]; entry; entry = entry->next) {
+        if (strcmp(entry->key, key) != 0) continue;
+
+        if (entry->catalog_version != catalog_version()) {
+            // A table was created or dropped since; the schema may be gone
+            evict(entry);
+            break;
+        }
+        lru_unlink(entry);
+        lru_push_front(entry);
+        return entry->plan;
+    }
+
+    // Miss: parse with every literal as a parameter and resolve once
+    CachedPlan* entry = malloc(sizeof(CachedPlan));
+    arena_init(&entry->arena, PLAN_ARENA_BLOCK_SIZE);
+
+    char* text = arena_strdup(&entry->arena, statement_text);
+    Lexer lexer = { text, 0 };
+    Parser parser;
+    parser_init(&parser, &lexer, &entry->arena);
+    parser.parameterize = 1;
+
+    ASTNode* root = parse_statement(&parser);
+    if (!root) {
+        *syntax_error = arena_strdup(scratch, parser.error);
+    }
+    entry->plan = root ? plan_query(root, &entry->arena) : NULL;
+    if (!entry->plan) {
+        arena_free(&entry->arena);
+        free(entry);
+        return NULL;
+    }
+
+    if (cached_count == PLAN_CACHE_CAPACITY) {
+        evict(lru_tail);
+    }
+
+    entry->key = malloc(key_length + 1);
+    memcpy(entry->key, key, key_length + 1);
+    entry->catalog_version = catalog_version();
+    entry->next = buckets[bucket];
+    buckets[bucket] = entry;
+    lru_push_front(entry);
+    cached_count++;
+    return entry->plan;
+}
+
+int plan_cache_run(const char* input, const NormalizedStatement* statement, Arena* scratch,
+                   const char** syntax_error) {
+    *syntax_error = NULL;
+    if (current_database[0] == '\0') {
+        return 0;
+    }
+
+    for (int i = 0; i < statement->slot_count; i++) {
+        if (!statement->slots[i]) {
+            out_printf("Statement has ? parameters; use PREPARE and EXECUTE to supply them\n");
+            return 1;
+        }
+    }
+
+    QueryPlan* plan = lookup_plan(statement->text, input, scratch, syntax_error);
+    if (plan) {
+        run_query(plan, statement->slots, scratch);
+    }
+    return 1;
+}
+
+int plan_cache_execute(const char* input, Arena* scratch) {
+    NormalizedStatement statement;
+    if (!normalize_statement(input, &statement, scratch)) {
+        return 0;
+    }
+    const char* syntax_error;
+    int handled = plan_cache_run(input, &statement, scratch, &syntax_error);
+    if (syntax_error) {
+        out_printf("%s", syntax_error);
+    }
+    return handled;
+}
+
+/* ============================================
+   PREPARED STATEMENTS
+   ============================================ */
+
+struct PreparedStatement {
+    char name[64];
+    char* text;                     // Statement as written, replanned on a cache miss
+    char* normalized;
+    char** slots;                   // Literal per parameter, NULL for '?'
+    int slot_count;
+    int param_count;                // '?' placeholders EXECUTE must supply
+    struct PreparedStatement* next;
+};
+
+static THREAD_LOCAL PreparedStatement* prepared_statements;
+
+static void free_prepared(PreparedStatement* prepared) {
+    for (int i = 0; i < prepared->slot_count; i++) {
+        free(prepared->slots[i]);
+    }
+    free(prepared->slots);
+    free(prepared->normalized);
+    free(prepared->text);
+    free(prepared);
+}
+
+PreparedStatement* prepared_statements_swap(PreparedStatement* list) {
+    PreparedStatement* previous = prepared_statements;
+    prepared_statements = list;
+    return previous;
+}
+
+void prepared_statements_free(PreparedStatement* list) {
+    while (list) {
+        PreparedStatement* next = list->next;
+        free_prepared(list);
+        list = next;
+    }
+}
+
+static PreparedStatement** find_prepared(const char* name) {
+    PreparedStatement** link = &prepared_statements;
+    while (*link && strcmp((*link)->name, name) != 0) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+void prepare_statement(ASTNode* prepare) {
+    const char* name = prepare->value;
+    const char* text = prepare->right->value;
+
+    Arena scratch;
+    arena_init(&scratch, PLAN_ARENA_BLOCK_SIZE);
+
+    NormalizedStatement statement;
+    if (!normalize_statement(text, &statement, &scratch)) {
+        out_printf("Statement '%s' has more than %d values\n", name, PLAN_MAX_PARAMS);
+        arena_free(&scratch);
+        return;
+    }
+
+    // Resolve now so a missing table or column is reported at PREPARE
+    const char* syntax_error = NULL;
+    if (!lookup_plan(statement.text, text, &scratch, &syntax_error)) {
+        if (syntax_error) {
+            out_printf("%s", syntax_error);
+        }
+        arena_free(&scratch);
+        return;
+    }
+
+    PreparedStatement* prepared = calloc(1, sizeof(PreparedStatement));
+    strncpy(prepared->name, name, sizeof(prepared->name) - 1);
+    prepared->text = strdup(text);
+    prepared->normalized = strdup(statement.text);
+    prepared->slot_count = statement.slot_count;
+    prepared->slots = calloc(statement.slot_count ? statement.slot_count : 1, sizeof(char*));
+    for (int i = 0; i < statement.slot_count; i++) {
+        if (statement.slots[i]) {
+            prepared->slots[i] = strdup(statement.slots[i]);
+        } else {
+            prepared->param_count++;
+        }
+    }
+    arena_free(&scratch);
+
+    // PREPARE with an existing name replaces it
+    PreparedStatement** link = find_prepared(name);
+    if (*link) {
+        PreparedStatement* old = *link;
+        *link = old->next;
+        free_prepared(old);
+    }
+    prepared->next = prepared_statements;
+    prepared_statements = prepared;
+
+    out_printf("Statement '%s' prepared\n", name);
+}
+
+void execute_prepared(ASTNode* execute, Arena* scratch) {
+    PreparedStatement* prepared = *find_prepared(execute->value);
+    if (!prepared) {
+        out_printf("Prepared statement '%s' does not exist\n", execute->value);
+        return;
+    }
+
+    int arg_count = 0;
+    for (ASTNode* arg = execute->left; arg; arg = arg->right) {
+        arg_count++;
+    }
+    if (arg_count != prepared->param_count) {
+        out_printf("Statement '%s' expects %d parameter(s), got %d\n",
+               prepared->name, prepared->param_count, arg_count);
+        return;
+    }
+
+    // Fill the '?' slots from the arguments in order
+    const char** params = arena_alloc(scratch, sizeof(const char*) * (prepared->slot_count + 1));
+    ASTNode* arg = execute->left;
+    for (int i = 0; i < prepared->slot_count; i++) {
+        if (prepared->slots[i]) {
+            params[i] = prepared->slots[i];
+        } else {
+            params[i] = arg->value;
+            arg = arg->right;
+        }
+    }
+
+    const char* syntax_error = NULL;
+    QueryPlan* plan = lookup_plan(prepared->normalized, prepared->text, scratch, &syntax_error);
+    if (plan) {
+        run_query(plan, params, scratch);
+    } else if (syntax_error) {
+        out_printf("%s", syntax_error);
+    }
+}
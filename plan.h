@@ -0,0 +1,62 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+#include "ast.h"
+#include "arena.h"
+
+/* =======================
+   PLAN CACHE
+   ======================= */
+
+/*
+ * SELECT and INSERT statements are normalized before parsing: keywords are
+ * lowercased, whitespace collapsed and every literal replaced by '?'. The
+ * normalized text (with the current database) keys an LRU cache of resolved
+ * plans, so repeating a statement shape with different constants skips
+ * parsing, schema lookup and predicate compilation; the literals are bound
+ * as parameters on each run. Plans are dropped when the catalog changes.
+ *
+ * PREPARE name AS ... registers a statement whose '?' placeholders are
+ * supplied later with EXECUTE name(value, ...).
+ */
+
+#define PLAN_CACHE_CAPACITY 64
+#define PLAN_CACHE_BUCKETS 128
+#define PLAN_MAX_PARAMS 1024
+#define PLAN_ARENA_BLOCK_SIZE 4096
+
+/* Normalized statement: its cache key and the literal bound to each '?'
+   (NULL where the statement itself wrote '?') */
+typedef struct {
+    char* text;
+    const char** slots;
+    int slot_count;
+} NormalizedStatement;
+
+/* Normalize a SELECT or INSERT into the arena. Returns 0 for any other
+   statement, or one with too many literals to be worth caching. Touches
+   no engine state, so it may run on a different thread than execution. */
+int normalize_statement(const char* input, NormalizedStatement* out, Arena* arena);
+
+/* Run a normalized statement from the plan cache. Returns 0 if there is
+   no current database, in which case it should be executed normally. A
+   syntax error is returned in *syntax_error rather than printed. */
+int plan_cache_run(const char* input, const NormalizedStatement* statement, Arena* scratch,
+                   const char** syntax_error);
+
+/* Normalize and run. Returns 0 if the statement is not cacheable and
+   should be parsed and executed normally. */
+int plan_cache_execute(const char* input, Arena* scratch);
+
+/* PREPARE name AS <statement>; and EXECUTE name(args); */
+void prepare_statement(ASTNode* prepare);
+void execute_prepared(ASTNode* execute, Arena* scratch);
+
+/* Prepared statements belong to a session: the server swaps each
+   session's list in while it runs and back out afterwards */
+typedef struct PreparedStatement PreparedStatement;
+
+PreparedStatement* prepared_statements_swap(PreparedStatement* list);
+void prepared_statements_free(PreparedStatement* list);
+
+#endif
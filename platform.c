@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include "platform.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <process.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+typedef struct {
+    ThreadFunc func;
+    void* arg;
+} ThreadStart;
+
+#ifdef _WIN32
+
+void mutex_init(Mutex* mutex) { InitializeCriticalSection(mutex); }
+void mutex_destroy(Mutex* mutex) { DeleteCriticalSection(mutex); }
+void mutex_lock(Mutex* mutex) { EnterCriticalSection(mutex); }
+void mutex_unlock(Mutex* mutex) { LeaveCriticalSection(mutex); }
+
+void cond_init(CondVar* cond) { InitializeConditionVariable(cond); }
+void cond_destroy(CondVar* cond) { (void)cond; }
+void cond_wait(CondVar* cond, Mutex* mutex) { SleepConditionVariableCS(cond, mutex, INFINITE); }
+void cond_signal(CondVar* cond) { WakeConditionVariable(cond); }
+void cond_broadcast(CondVar* cond) { WakeAllConditionVariable(cond); }
+
+static unsigned __stdcall thread_entry(void* arg) {
+    ThreadStart start = *(ThreadStart*)arg;
+    free(arg);
+    start.func(start.arg);
+    return 0;
+}
+
+int thread_start(Thread* thread, ThreadFunc func, void* arg) {
+    ThreadStart* start = malloc(sizeof(ThreadStart));
+    start->func = func;
+    start->arg = arg;
+    uintptr_t handle = _beginthreadex(NULL, 0, thread_entry, start, 0, NULL);
+    if (handle == 0) {
+        free(start);
+        return 0;
+    }
+    *thread = (HANDLE)handle;
+    return 1;
+}
+
+void thread_join(Thread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+void sleep_us(long microseconds) {
+    Sleep((DWORD)((microseconds + 999) / 1000));
+}
+
+int cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+int file_sync(FILE* file) {
+    if (fflush(file) != 0) return 0;
+    return _commit(_fileno(file)) == 0;
+}
+
+double clock_seconds(void) {
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+
+int stdin_is_terminal(void) {
+    return _isatty(_fileno(stdin));
+}
+
+void file_set_binary(FILE* file, int binary) {
+    _setmode(_fileno(file), binary ? _O_BINARY : _O_TEXT);
+}
+
+#else
+
+void mutex_init(Mutex* mutex) { pthread_mutex_init(mutex, NULL); }
+void mutex_destroy(Mutex* mutex) { pthread_mutex_destroy(mutex); }
+void mutex_lock(Mutex* mutex) { pthread_mutex_lock(mutex); }
+void mutex_unlock(Mutex* mutex) { pthread_mutex_unlock(mutex); }
+
+void cond_init(CondVar* cond) { pthread_cond_init(cond, NULL); }
+void cond_destroy(CondVar* cond) { pthread_cond_destroy(cond); }
+void cond_wait(CondVar* cond, Mutex* mutex) { pthread_cond_wait(cond, mutex); }
+void cond_signal(CondVar* cond) { pthread_cond_signal(cond); }
+void cond_broadcast(CondVar* cond) { pthread_cond_broadcast(cond); }
+
+static void* thread_entry(void* arg) {
+    ThreadStart start = *(ThreadStart*)arg;
+    free(arg);
+    start.func(start.arg);
+    return NULL;
+}
+
+int thread_start(Thread* thread, ThreadFunc func, void* arg) {
+    ThreadStart* start = malloc(sizeof(ThreadStart));
+    start->func = func;
+    start->arg = arg;
+    if (pthread_create(thread, NULL, thread_entry, start) != 0) {
+        free(start);
+        return 0;
+    }
+    return 1;
+}
+
+void thread_join(Thread thread) {
+    pthread_join(thread, NULL);
+}
+
+void sleep_us(long microseconds) {
+    struct timespec ts;
+    ts.tv_sec = microseconds / 1000000;
+    ts.tv_nsec = (microseconds % 1000000) * 1000;
+    nanosleep(&ts, NULL);
+}
+
+int cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+int file_sync(FILE* file) {
+    if (fflush(file) != 0) return 0;
+    return fsync(fileno(file)) == 0;
+}
+
+double clock_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int stdin_is_terminal(void) {
+    return isatty(fileno(stdin));
+}
+
+void file_set_binary(FILE* file, int binary) {
+    (void)file;     // No newline translation on POSIX
+    (void)binary;
+}
+
+#endif
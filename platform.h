@@ -0,0 +1,66 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdio.h>
+
+/* =======================
+   THREADS AND SYNC
+   ======================= */
+
+/*
+ * Thin wrappers over Win32 and pthreads so the engine code does not need
+ * its own #ifdefs: mutexes, condition variables, threads, sleeping and
+ * forcing a file's data to stable storage.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE CondVar;
+typedef HANDLE Thread;
+#else
+#include <pthread.h>
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t CondVar;
+typedef pthread_t Thread;
+#endif
+
+typedef void (*ThreadFunc)(void* arg);
+
+/* Per-thread globals: each server worker runs its own session's state */
+#define THREAD_LOCAL __thread
+
+void mutex_init(Mutex* mutex);
+void mutex_destroy(Mutex* mutex);
+void mutex_lock(Mutex* mutex);
+void mutex_unlock(Mutex* mutex);
+
+void cond_init(CondVar* cond);
+void cond_destroy(CondVar* cond);
+void cond_wait(CondVar* cond, Mutex* mutex);
+void cond_signal(CondVar* cond);
+void cond_broadcast(CondVar* cond);
+
+/* Start a thread running func(arg); returns 0 on failure */
+int thread_start(Thread* thread, ThreadFunc func, void* arg);
+void thread_join(Thread thread);
+
+void sleep_us(long microseconds);
+
+/* Number of online CPUs (at least 1) */
+int cpu_count(void);
+
+/* Flush stdio buffers and force the file to disk; returns 0 on failure */
+int file_sync(FILE* file);
+
+/* Monotonic wall clock in seconds, for measuring elapsed time */
+double clock_seconds(void);
+
+/* Nonzero if stdin is an interactive terminal rather than a pipe or file */
+int stdin_is_terminal(void);
+
+/* Switch a stream between binary and text mode (newline translation on
+   Windows); flush it first */
+void file_set_binary(FILE* file, int binary);
+
+#endif
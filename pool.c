@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include "pool.h"
+#include "platform.h"
+
+/* Tasks still owned by one worker: it takes from next, thieves from end */
+typedef struct {
+    Mutex lock;
+    int next;
+    int end;
+    char padding[64];       // Keep neighbouring queues off one cache line
+} WorkQueue;
+
+static struct {
+    int threads;                        // Configured workers, 0 until first use
+    int started;                        // Worker threads running (caller excluded)
+    Thread handles[POOL_MAX_THREADS];
+    long start_generation[POOL_MAX_THREADS];    // Last batch before the thread started
+    WorkQueue queues[POOL_MAX_THREADS];
+
+    Mutex lock;
+    CondVar work_ready;
+    CondVar work_done;
+    int busy;                           // A batch is running
+    long generation;                    // Bumped for every batch
+    int participants;                   // Workers taking part in the batch
+    int active;                         // Worker threads still running it
+    PoolTask task;
+    void* context;
+} pool;
+
+static int take_own(WorkQueue* queue) {
+    int task = -1;
+    mutex_lock(&queue->lock);
+    if (queue->next < queue->end) task = queue->next++;
+    mutex_unlock(&queue->lock);
+    return task;
+}
+
+static int steal(WorkQueue* queue) {
+    int task = -1;
+    mutex_lock(&queue->lock);
+    if (queue->next < queue->end) task = --queue->end;
+    mutex_unlock(&queue->lock);
+    return task;
+}
+
+static void work(int worker) {
+    int count = pool.participants;
+    for (;;) {
+        int task = take_own(&pool.queues[worker]);
+        for (int i = 1; task < 0 && i < count; i++) {
+            task = steal(&pool.queues[(worker + i) % count]);
+        }
+        if (task < 0) return;
+        pool.task(pool.context, task, worker);
+    }
+}
+
+static void worker_main(void* arg) {
+    int worker = (int)(long)arg;
+    long seen = pool.start_generation[worker];
+
+    for (;;) {
+        mutex_lock(&pool.lock);
+        while (pool.generation == seen) {
+            cond_wait(&pool.work_ready, &pool.lock);
+        }
+        seen = pool.generation;
+        int participating = worker < pool.participants;
+        mutex_unlock(&pool.lock);
+
+        if (!participating) continue;
+        work(worker);
+
+        mutex_lock(&pool.lock);
+        if (--pool.active == 0) {
+            cond_signal(&pool.work_done);
+        }
+        mutex_unlock(&pool.lock);
+    }
+}
+
+static void pool_init(void) {
+    mutex_init(&pool.lock);
+    cond_init(&pool.work_ready);
+    cond_init(&pool.work_done);
+    for (int i = 0; i < POOL_MAX_THREADS; i++) {
+        mutex_init(&pool.queues[i].lock);
+    }
+
+    const char* env = getenv("BRANCHDB_THREADS");
+    pool.threads = env ? atoi(env) : 0;
+    if (pool.threads <= 0) pool.threads = cpu_count();
+    if (pool.threads > POOL_MAX_THREADS) pool.threads = POOL_MAX_THREADS;
+}
+
+int pool_threads(void) {
+    if (pool.threads == 0) pool_init();
+    return pool.threads;
+}
+
+void pool_set_threads(int count) {
+    if (pool.threads == 0) pool_init();
+    if (count <= 0) count = cpu_count();
+    pool.threads = count < POOL_MAX_THREADS ? count : POOL_MAX_THREADS;
+}
+
+void pool_run(int task_count, PoolTask task, void* context) {
+    int participants = pool_threads() < task_count ? pool_threads() : task_count;
+
+    // Another session's scan has the workers: run this batch on the caller
+    if (participants > 1) {
+        mutex_lock(&pool.lock);
+        if (pool.busy) {
+            participants = 1;
+        } else {
+            pool.busy = 1;
+        }
+        mutex_unlock(&pool.lock);
+    }
+
+    if (participants <= 1) {
+        for (int i = 0; i < task_count; i++) {
+            task(context, i, 0);
+        }
+        return;
+    }
+
+    // Start any worker threads this batch needs that are not running yet
+    while (pool.started < participants - 1) {
+        int worker = pool.started + 1;
+        pool.start_generation[worker] = pool.generation;
+        if (!thread_start(&pool.handles[worker], worker_main, (void*)(long)worker)) {
+            break;
+        }
+        pool.started++;
+    }
+    participants = pool.started + 1 < participants ? pool.started + 1 : participants;
+
+    // Contiguous ranges, so each worker mostly scans neighbouring tasks
+    for (int w = 0; w < participants; w++) {
+        pool.queues[w].next = (int)((long)task_count * w / participants);
+        pool.queues[w].end = (int)((long)task_count * (w + 1) / participants);
+    }
+
+    mutex_lock(&pool.lock);
+    pool.task = task;
+    pool.context = context;
+    pool.participants = participants;
+    pool.active = participants - 1;
+    pool.generation++;
+    cond_broadcast(&pool.work_ready);
+    mutex_unlock(&pool.lock);
+
+    work(0);
+
+    mutex_lock(&pool.lock);
+    while (pool.active > 0) {
+        cond_wait(&pool.work_done, &pool.lock);
+    }
+    pool.busy = 0;
+    mutex_unlock(&pool.lock);
+}
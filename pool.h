@@ -0,0 +1,34 @@
+#ifndef POOL_H
+#define POOL_H
+
+/* =======================
+   WORK-STEALING THREAD POOL
+   ======================= */
+
+/*
+ * Runs a batch of independent tasks (numbered 0..task_count-1) on a set of
+ * worker threads. Each participant starts with a contiguous range of the
+ * tasks and takes them in order from the front; when its range is empty
+ * it steals from the back of the others', so uneven tasks still balance.
+ * The calling thread takes part as worker 0. Threads are started on first
+ * use and then wait for the next batch.
+ *
+ * The worker count defaults to BRANCHDB_THREADS, or one per CPU. One batch
+ * runs at a time; a batch started while another is running (a second
+ * session's scan in the server) runs on its calling thread alone.
+ */
+
+#define POOL_MAX_THREADS 64
+
+typedef void (*PoolTask)(void* context, int task, int worker);
+
+/* Number of workers (including the caller) a batch may use */
+int pool_threads(void);
+
+/* Set the worker count; 0 means one per CPU */
+void pool_set_threads(int count);
+
+/* Run task(context, i, worker) for every i and wait for all of them */
+void pool_run(int task_count, PoolTask task, void* context);
+
+#endif
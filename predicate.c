@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include "predicate.h"
+#include "output.h"
+
+/* ============================================
+   COMPILATION
+   ============================================ */
+
+static int parse_operator(const char* op, CompareOp* out) {
+    if (strcmp(op, "=") == 0) *out = CMP_EQ;
+    else if (strcmp(op, ">") == 0) *out = CMP_GT;
+    else if (strcmp(op, "<") == 0) *out = CMP_LT;
+    else if (strcmp(op, ">=") == 0) *out = CMP_GE;
+    else if (strcmp(op, "<=") == 0) *out = CMP_LE;
+    else return 0;
+    return 1;
+}
+
+/* Fold a possibly fractional constant into an equivalent integer comparison */
+static void bind_int_constant(Predicate* p, double value) {
+    double bound;
+    switch (p->op) {
+        case CMP_EQ:
+            if (value != floor(value)) {
+                p->kind = PRED_FALSE;
+                return;
+            }
+            bound = value;
+            break;
+        case CMP_GT:
+        case CMP_LE:
+            bound = floor(value);   // x > 2.5  <=>  x > 2
+            break;
+        default:
+            bound = ceil(value);    // x >= 2.5  <=>  x >= 3
+            break;
+    }
+
+    // Constants outside the int range make the comparison constant
+    if (bound > INT_MAX || bound < INT_MIN) {
+        int always = bound > INT_MAX ? (p->op == CMP_LT || p->op == CMP_LE)
+                                     : (p->op == CMP_GT || p->op == CMP_GE);
+        if (!always) {
+            p->kind = PRED_FALSE;
+            return;
+        }
+        p->op = CMP_GE;
+        bound = INT_MIN;
+    }
+    p->int_value = (int)bound;
+}
+
+/* Parse a comparison's constant into the column's type */
+static void bind_constant(Predicate* p, const char* constant) {
+    p->kind = PRED_COMPARE;
+    p->op = p->written_op;
+
+    switch (p->type) {
+        case TYPE_INT:
+        case TYPE_DATE:
+            bind_int_constant(p, atof(constant));
+            break;
+        case TYPE_DOUBLE:
+            p->double_value = atof(constant);
+            break;
+        default:
+            p->text = constant;
+            p->text_length = (int)strlen(constant);
+            memset(p->string_value, 0, sizeof(p->string_value));
+            if (!p->descriptor && p->text_length <= p->width) {
+                memcpy(p->string_value, constant, p->text_length);
+            }
+            break;
+    }
+}
+
+Predicate* compile_predicate(ASTNode* condition, TableSchema* schema, Arena* arena) {
+    if (!condition) return NULL;
+
+    if (condition->type == AST_WHERE) {
+        return compile_predicate(condition->left, schema, arena);
+    }
+
+    Predicate* p = arena_calloc(arena, sizeof(Predicate));
+
+    if (strcasecmp(condition->value, "AND") == 0 || strcasecmp(condition->value, "OR") == 0) {
+        p->kind = strcasecmp(condition->value, "AND") == 0 ? PRED_AND : PRED_OR;
+        p->left = compile_predicate(condition->left, schema, arena);
+        p->right = compile_predicate(condition->right, schema, arena);
+        if (!p->left || !p->right) {
+            return NULL;
+        }
+        return p;
+    }
+
+    if (!condition->left || condition->left->type != AST_IDENTIFIER || !condition->right) {
+        out_printf("Invalid WHERE condition\n");
+        return NULL;
+    }
+
+    const char* column_name = condition->left->value;
+    int col_index = -1;
+    for (int i = 0; i < schema->column_count; i++) {
+        if (strcmp(schema->columns[i].column_name, column_name) == 0) {
+            col_index = i;
+            break;
+        }
+    }
+
+    if (col_index == -1) {
+        out_printf("Column '%s' not found\n", column_name);
+        return NULL;
+    }
+
+    if (!parse_operator(condition->value, &p->written_op)) {
+        out_printf("Unsupported operator '%s'\n", condition->value);
+        return NULL;
+    }
+
+    p->kind = PRED_COMPARE;
+    p->column = col_index;
+    p->offset = schema->columns[col_index].offset;
+    p->type = schema->columns[col_index].type;
+    p->width = schema->columns[col_index].width;
+    p->descriptor = schema->columns[col_index].overflow;
+
+    if (p->type == TYPE_UNKNOWN) {
+        out_printf("Column '%s' has unknown type\n", column_name);
+        return NULL;
+    }
+
+    if (condition->right->type == AST_PARAM) {
+        p->param = condition->right->param;     // Bound per execution
+        p->op = p->written_op;
+    } else {
+        bind_constant(p, condition->right->value);
+    }
+
+    return p;
+}
+
+void predicate_bind(Predicate* predicate, const char** params) {
+    if (!predicate) return;
+    if (predicate->kind == PRED_AND || predicate->kind == PRED_OR) {
+        predicate_bind(predicate->left, params);
+        predicate_bind(predicate->right, params);
+    } else if (predicate->param > 0) {
+        bind_constant(predicate, params[predicate->param - 1]);
+    }
+}
+
+Predicate* predicate_copy(const Predicate* predicate, Arena* arena) {
+    if (!predicate) return NULL;
+    Predicate* copy = arena_alloc(arena, sizeof(Predicate));
+    *copy = *predicate;
+    if (predicate->text) {
+        copy->text = arena_strndup(arena, predicate->text, predicate->text_length);
+    }
+    copy->left = predicate_copy(predicate->left, arena);
+    copy->right = predicate_copy(predicate->right, arena);
+    return copy;
+}
+
+void predicate_columns(const Predicate* predicate, char* used) {
+    if (!predicate) return;
+    if (predicate->kind == PRED_COMPARE) {
+        used[predicate->column] = 1;
+    }
+    predicate_columns(predicate->left, used);
+    predicate_columns(predicate->right, used);
+}
+
+void predicate_set_overflow(Predicate* predicate, const char* overflow) {
+    if (!predicate) return;
+    predicate->overflow = overflow;
+    predicate_set_overflow(predicate->left, overflow);
+    predicate_set_overflow(predicate->right, overflow);
+}
+
+/* ============================================
+   EVALUATION
+   ============================================ */
+
+#define APPLY_OP(op, cmp) \
+    ((op) == CMP_EQ ? (cmp) == 0 : \
+     (op) == CMP_GT ? (cmp) > 0 : \
+     (op) == CMP_LT ? (cmp) < 0 : \
+     (op) == CMP_GE ? (cmp) >= 0 : (cmp) <= 0)
+
+int predicate_compare(const Predicate* p, const char* field) {
+    switch (p->type) {
+        case TYPE_INT:
+        case TYPE_DATE: {
+            int value;
+            memcpy(&value, field, sizeof(int));
+            return (value > p->int_value) - (value < p->int_value);
+        }
+        case TYPE_DOUBLE: {
+            double value;
+            memcpy(&value, field, sizeof(double));
+            return (value > p->double_value) - (value < p->double_value);
+        }
+        case TYPE_VARCHAR: {
+            const char* text;
+            int length = varchar_text(field, p->width, p->descriptor, p->overflow, &text);
+            int cmp = memcmp(text, p->text, length < p->text_length ? length : p->text_length);
+            if (cmp == 0) cmp = (length > p->text_length) - (length < p->text_length);
+            return cmp;
+        }
+        default:
+            return 0;
+    }
+}
+
+int predicate_test(const Predicate* p, const char* field) {
+    if (p->type == TYPE_UNKNOWN) return 0;
+    int cmp = predicate_compare(p, field);
+    return APPLY_OP(p->op, cmp);
+}
+
+int predicate_matches(const Predicate* p, const char* row) {
+    switch (p->kind) {
+        case PRED_AND:
+            return predicate_matches(p->left, row) && predicate_matches(p->right, row);
+        case PRED_OR:
+            return predicate_matches(p->left, row) || predicate_matches(p->right, row);
+        case PRED_FALSE:
+            return 0;
+        case PRED_COMPARE:
+            break;
+    }
+    return predicate_test(p, row + p->offset);
+}
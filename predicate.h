@@ -0,0 +1,83 @@
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include "ast.h"
+#include "executor.h"
+
+/* =======================
+   COMPILED WHERE PREDICATES
+   ======================= */
+
+/*
+ * A WHERE tree is compiled once per statement against the table schema.
+ * Each comparison holds its column's byte offset and type and a constant
+ * already parsed into that type, so evaluating a row compares raw int,
+ * double and varchar bytes with no lookups or string formatting. A
+ * comparison against a ? parameter is compiled without its constant and
+ * bound with predicate_bind() before each execution of a cached plan.
+ */
+
+typedef enum {
+    PRED_AND,
+    PRED_OR,
+    PRED_COMPARE,
+    PRED_FALSE          // Comparison that can never match (e.g. int = 2.5)
+} PredicateKind;
+
+typedef enum {
+    CMP_EQ,
+    CMP_GT,
+    CMP_LT,
+    CMP_GE,
+    CMP_LE
+} CompareOp;
+
+typedef struct Predicate {
+    PredicateKind kind;
+    CompareOp op;
+    CompareOp written_op;   // Operator as written, before constant folding
+    int param;              // 1-based parameter supplying the constant, 0 if literal
+    ColumnType type;
+    int column;             // Schema index of the compared column
+    int offset;             // Byte offset of the column inside a row
+    int width;              // Stored width of the column
+    int descriptor;         // Long varchar: compare through the overflow file
+    const char* overflow;   // Mapped overflow file while a scan runs
+    int int_value;
+    double double_value;
+    const char* text;       // Varchar constant and its length
+    int text_length;
+    char string_value[64];  // The constant null-padded to the inline width, if it fits
+    struct Predicate* left;
+    struct Predicate* right;
+} Predicate;
+
+/* Compile a WHERE clause (AST_WHERE or condition node) into the arena.
+   Returns NULL and prints an error if it references an unknown column or
+   operator. */
+Predicate* compile_predicate(ASTNode* condition, TableSchema* schema, Arena* arena);
+
+/* Bind parameter values (text, in parameter order) into every
+   parameterized comparison */
+void predicate_bind(Predicate* predicate, const char** params);
+
+/* Private copy, for a scan that runs while the cached plan it came from
+   may be rebound or evicted */
+Predicate* predicate_copy(const Predicate* predicate, Arena* arena);
+
+/* Set used[column] for every column the predicate compares */
+void predicate_columns(const Predicate* predicate, char* used);
+
+/* Point long varchar comparisons at the scanned table's overflow data */
+void predicate_set_overflow(Predicate* predicate, const char* overflow);
+
+/* Evaluate a compiled predicate against one row */
+int predicate_matches(const Predicate* predicate, const char* row);
+
+/* A comparison applied to one stored value of its column (not a row):
+   predicate_compare gives the sign of value - constant, predicate_test
+   whether the comparison holds */
+int predicate_compare(const Predicate* comparison, const char* field);
+int predicate_test(const Predicate* comparison, const char* field);
+
+#endif
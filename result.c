@@ -0,0 +1,422 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "result.h"
+#include "aggregate.h"
+#include "sort.h"
+#include "platform.h"
+#include "output.h"
+
+#define RESULT_SCRATCH_SIZE 320     // Longest "%.2f" of a double, with room to spare
+
+static THREAD_LOCAL ResultFormat current_format = FORMAT_TABLE;
+
+ResultFormat result_format(void) {
+    return current_format;
+}
+
+void result_set_format(ResultFormat format) {
+    current_format = format;
+}
+
+int result_format_by_name(const char* name, ResultFormat* format) {
+    static const struct { const char* name; ResultFormat format; } formats[] = {
+        { "table", FORMAT_TABLE },
+        { "csv", FORMAT_CSV },
+        { "tsv", FORMAT_TSV },
+        { "binary", FORMAT_BINARY },
+    };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        if (strcmp(formats[i].name, name) == 0) {
+            *format = formats[i].format;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ============================================
+   OUTPUT BUFFER
+   ============================================ */
+
+static void sink_flush(ResultSink* sink) {
+    if (sink->length > 0) {
+        output_write(sink->target, sink->buffer, sink->length);
+        sink->length = 0;
+    }
+}
+
+/* Make room for size more bytes; values are far smaller than the buffer */
+static char* sink_reserve(ResultSink* sink, size_t size) {
+    if (sink->length + size > sink->capacity) {
+        if (sink->out) {
+            sink_flush(sink);
+        } else {
+            while (sink->length + size > sink->capacity) sink->capacity *= 2;
+            sink->buffer = realloc(sink->buffer, sink->capacity);
+        }
+    }
+    return sink->buffer + sink->length;
+}
+
+static void put_bytes(ResultSink* sink, const void* data, size_t size) {
+    memcpy(sink_reserve(sink, size), data, size);
+    sink->length += size;
+}
+
+static void put_char(ResultSink* sink, char c) {
+    *sink_reserve(sink, 1) = c;
+    sink->length++;
+}
+
+static void put_repeat(ResultSink* sink, char c, int count) {
+    memset(sink_reserve(sink, count), c, count);
+    sink->length += count;
+}
+
+/* Decimal text of an integer without going through printf */
+static int format_int(long long value, char* out) {
+    char digits[20];
+    unsigned long long magnitude = value < 0 ? 0ull - (unsigned long long)value
+                                             : (unsigned long long)value;
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    int length = 0;
+    if (value < 0) out[length++] = '-';
+    while (count) out[length++] = digits[--count];
+    return length;
+}
+
+/* Text of one stored value; returns its length. varchar points into the row
+   or the overflow data, numbers are formatted into scratch
+   (RESULT_SCRATCH_SIZE bytes). */
+static int value_text(const ResultSink* sink, const char* src, const ColumnSchema* column,
+                      char* scratch, const char** text) {
+    switch (column->type) {
+        case TYPE_INT:
+        case TYPE_DATE: {
+            int value;
+            memcpy(&value, src, sizeof(int));
+            *text = scratch;
+            return format_int(value, scratch);
+        }
+        case TYPE_BIGINT: {
+            long long value;
+            memcpy(&value, src, sizeof(long long));
+            *text = scratch;
+            return format_int(value, scratch);
+        }
+        case TYPE_DOUBLE: {
+            double value;
+            memcpy(&value, src, sizeof(double));
+            *text = scratch;
+            int length = snprintf(scratch, RESULT_SCRATCH_SIZE, "%.2f", value);
+            return length < RESULT_SCRATCH_SIZE ? length : RESULT_SCRATCH_SIZE - 1;
+        }
+        case TYPE_VARCHAR:
+            return varchar_text(src, column->width, column->overflow, sink->overflow, text);
+        default:
+            *text = scratch;
+            return 0;
+    }
+}
+
+/* ============================================
+   FORMATS
+   ============================================ */
+
+static void put_border(ResultSink* sink) {
+    put_char(sink, '+');
+    for (int i = 0; i < sink->column_count; i++) {
+        put_bytes(sink, "----------------+", 17);
+    }
+    put_char(sink, '\n');
+}
+
+static void put_table_cell(ResultSink* sink, const char* text, int length) {
+    put_char(sink, ' ');
+    put_bytes(sink, text, length);
+    if (length < 14) {
+        put_repeat(sink, ' ', 14 - length);
+    }
+    put_bytes(sink, " |", 2);
+}
+
+static void put_csv_field(ResultSink* sink, const char* text, int length) {
+    int needs_quotes = 0;
+    for (int i = 0; i < length && !needs_quotes; i++) {
+        needs_quotes = text[i] == ',' || text[i] == '"' || text[i] == '\r' || text[i] == '\n';
+    }
+    if (!needs_quotes) {
+        put_bytes(sink, text, length);
+        return;
+    }
+    put_char(sink, '"');
+    for (int i = 0; i < length; i++) {
+        if (text[i] == '"') put_char(sink, '"');
+        put_char(sink, text[i]);
+    }
+    put_char(sink, '"');
+}
+
+static void put_tsv_field(ResultSink* sink, const char* text, int length) {
+    for (int i = 0; i < length; i++) {
+        switch (text[i]) {
+            case '\t': put_bytes(sink, "\\t", 2); break;
+            case '\n': put_bytes(sink, "\\n", 2); break;
+            case '\r': put_bytes(sink, "\\r", 2); break;
+            case '\\': put_bytes(sink, "\\\\", 2); break;
+            default: put_char(sink, text[i]);
+        }
+    }
+}
+
+static void put_field(ResultSink* sink, int index, const char* text, int length) {
+    switch (sink->format) {
+        case FORMAT_TABLE:
+            put_table_cell(sink, text, length);
+            break;
+        case FORMAT_CSV:
+            if (index > 0) put_char(sink, ',');
+            put_csv_field(sink, text, length);
+            break;
+        case FORMAT_TSV:
+            if (index > 0) put_char(sink, '\t');
+            put_tsv_field(sink, text, length);
+            break;
+        case FORMAT_BINARY:
+            break;
+    }
+}
+
+static void put_u32(ResultSink* sink, uint32_t value) {
+    put_bytes(sink, &value, sizeof(value));
+}
+
+static void binary_row(ResultSink* sink, const char* row) {
+    // The length prefix comes first, so size the projected values up front
+    uint32_t row_length = 0;
+    for (int i = 0; i < sink->column_count; i++) {
+        const ColumnSchema* column = &sink->schema->columns[sink->columns[i]];
+        const char* text;
+        row_length += column->type == TYPE_VARCHAR
+            ? sizeof(uint16_t) + varchar_text(row + sink->offsets[i], column->width, column->overflow,
+                                              sink->overflow, &text)
+            : (uint32_t)column_width(column->type);
+    }
+    put_u32(sink, row_length);
+
+    for (int i = 0; i < sink->column_count; i++) {
+        const ColumnSchema* column = &sink->schema->columns[sink->columns[i]];
+        const char* src = row + sink->offsets[i];
+        switch (column->type) {
+            case TYPE_VARCHAR: {
+                const char* text;
+                uint16_t length = (uint16_t)varchar_text(src, column->width, column->overflow,
+                                                         sink->overflow, &text);
+                put_bytes(sink, &length, sizeof(length));
+                put_bytes(sink, text, length);
+                break;
+            }
+            case TYPE_DOUBLE:
+            case TYPE_BIGINT:
+                put_bytes(sink, src, 8);
+                break;
+            default:
+                put_bytes(sink, src, sizeof(int));
+        }
+    }
+}
+
+/* ============================================
+   SINK
+   ============================================ */
+
+void result_begin(ResultSink* sink, TableSchema* schema, const int* columns,
+                  const long* offsets, int column_count, Arena* arena) {
+    sink->format = current_format;
+    sink->out = stdout;
+    sink->target = output_target();
+    sink->overflow = NULL;
+    sink->buffer = arena_alloc(arena, RESULT_BUFFER_SIZE);
+    sink->length = 0;
+    sink->capacity = RESULT_BUFFER_SIZE;
+    sink->schema = schema;
+    sink->columns = columns;
+    sink->offsets = offsets;
+    sink->column_count = column_count;
+    sink->rows = 0;
+    sink->skip = 0;
+    sink->limit = -1;
+    sink->aggregation = NULL;
+    sink->sorter = NULL;
+
+    if (sink->format == FORMAT_BINARY) {
+        if (!output_is_captured()) {
+            fflush(sink->out);
+            file_set_binary(sink->out, 1);
+        }
+        put_bytes(sink, "BDBR", 4);
+        put_u32(sink, (uint32_t)column_count);
+        for (int i = 0; i < column_count; i++) {
+            ColumnSchema* column = &schema->columns[columns[i]];
+            uint8_t type = (uint8_t)column->type;
+            uint8_t length = (uint8_t)strnlen(column->column_name, sizeof(column->column_name));
+            put_bytes(sink, &type, 1);
+            put_bytes(sink, &length, 1);
+            put_bytes(sink, column->column_name, length);
+        }
+        return;
+    }
+
+    if (sink->format == FORMAT_TABLE) {
+        put_border(sink);
+        put_char(sink, '|');
+    }
+    for (int i = 0; i < column_count; i++) {
+        const char* name = schema->columns[columns[i]].column_name;
+        put_field(sink, i, name, (int)strlen(name));
+    }
+    put_char(sink, '\n');
+    if (sink->format == FORMAT_TABLE) {
+        put_border(sink);
+    }
+}
+
+void result_row(ResultSink* sink, const char* row) {
+    if (sink->aggregation) {
+        aggregation_add(sink->aggregation, row, 0, NULL, 1, sink->overflow);
+        sink->rows++;
+        return;
+    }
+    if (sink->sorter) {
+        sorter_add(sink->sorter, row, 0, NULL, 1, sink->overflow);
+        sink->rows++;
+        return;
+    }
+    if (sink->skip > 0) {
+        sink->skip--;
+        return;
+    }
+    if (sink->limit >= 0 && sink->rows >= sink->limit) {
+        return;
+    }
+    sink->rows++;
+
+    if (sink->format == FORMAT_BINARY) {
+        binary_row(sink, row);
+        return;
+    }
+
+    char scratch[RESULT_SCRATCH_SIZE];
+    if (sink->format == FORMAT_TABLE) {
+        put_char(sink, '|');
+    }
+    for (int i = 0; i < sink->column_count; i++) {
+        const char* text;
+        int length = value_text(sink, row + sink->offsets[i], &sink->schema->columns[sink->columns[i]],
+                                scratch, &text);
+        put_field(sink, i, text, length);
+    }
+    put_char(sink, '\n');
+}
+
+void result_rows(ResultSink* sink, const char* rows, int row_size, const uint16_t* selection,
+                 int count) {
+    if (sink->aggregation) {
+        aggregation_add(sink->aggregation, rows, row_size, selection, count, sink->overflow);
+        sink->rows += count;
+        return;
+    }
+    if (sink->sorter) {
+        sorter_add(sink->sorter, rows, row_size, selection, count, sink->overflow);
+        sink->rows += count;
+        return;
+    }
+    for (int i = 0; i < count && !result_done(sink); i++) {
+        result_row(sink, rows + (long)(selection ? selection[i] : i) * row_size);
+    }
+}
+
+int result_done(const ResultSink* sink) {
+    return sink->limit >= 0 && sink->rows >= sink->limit && !sink->aggregation && !sink->sorter;
+}
+
+static void emit_row(void* sink, const char* row) {
+    result_row(sink, row);
+}
+
+void result_end(ResultSink* sink) {
+    if (sink->aggregation) {
+        // The rows folded in become the result rows
+        Aggregation* aggregation = sink->aggregation;
+        sink->aggregation = NULL;
+        sink->rows = 0;
+        aggregation_finish(aggregation, sink->overflow, emit_row, sink);
+        aggregation_free(aggregation);
+    }
+    if (sink->sorter) {
+        // Then the sorted rows, up to the LIMIT
+        Sorter* sorter = sink->sorter;
+        sink->sorter = NULL;
+        sink->rows = 0;
+        sorter_finish(sorter, sink->overflow, emit_row, sink);
+        sorter_free(sorter);
+    }
+
+    if (sink->format == FORMAT_TABLE) {
+        put_border(sink);
+    } else if (sink->format == FORMAT_BINARY) {
+        put_u32(sink, RESULT_BINARY_END);
+    }
+
+    sink_flush(sink);
+
+    if (sink->format == FORMAT_BINARY && !output_is_captured()) {
+        fflush(sink->out);
+        file_set_binary(sink->out, 0);
+    } else if (sink->format == FORMAT_TABLE) {
+        out_printf("%ld row(s) selected\n", sink->rows);
+    }
+}
+
+void result_fork(const ResultSink* parent, ResultSink* part) {
+    *part = *parent;
+    part->out = NULL;
+    part->capacity = 4096;
+    part->buffer = malloc(part->capacity);
+    part->length = 0;
+    part->rows = 0;
+    part->skip = 0;
+    part->limit = -1;
+    part->aggregation = parent->aggregation ? aggregation_fork(parent->aggregation) : NULL;
+    part->sorter = parent->sorter && !parent->aggregation ? sorter_fork(parent->sorter) : NULL;
+}
+
+void result_merge(ResultSink* sink, ResultSink* part) {
+    if (part->length > sink->capacity - sink->length) {
+        // Too big to copy through the buffer: write it out directly
+        sink_flush(sink);
+        output_write(sink->target, part->buffer, part->length);
+    } else {
+        put_bytes(sink, part->buffer, part->length);
+    }
+    sink->rows += part->rows;
+    if (part->aggregation) {
+        aggregation_merge(sink->aggregation, part->aggregation, sink->overflow);
+        part->aggregation = NULL;
+    }
+    if (part->sorter) {
+        sorter_merge(sink->sorter, part->sorter, sink->overflow);
+        part->sorter = NULL;
+    }
+
+    free(part->buffer);
+    part->buffer = NULL;
+    part->length = 0;
+}
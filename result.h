@@ -0,0 +1,100 @@
+#ifndef RESULT_H
+#define RESULT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "executor.h"
+
+/* =======================
+   RESULT SINK
+   ======================= */
+
+/*
+ * SELECT rows go from the stored row bytes straight into a large output
+ * buffer in the session's format, and reach stdout in RESULT_BUFFER_SIZE
+ * writes instead of one printf per cell:
+ *
+ *   table   the boxed, 14-character column layout
+ *   csv     header line, RFC 4180 quoting
+ *   tsv     header line, tab/newline/backslash escaped as \t \n \\
+ *   binary  "BDBR", u32 column count, per column u8 type, u8 name length
+ *           and name; then per row a u32 byte length followed by the
+ *           values (int/date 4 bytes, bigint and double 8, varchar u16
+ *           length and bytes; VARCHAR(n) is at most 65535); a u32
+ *           0xFFFFFFFF ends the result. Little-endian.
+ *
+ * Only the table format adds the "N row(s) selected" footer, so the other
+ * formats can be redirected to a file as-is.
+ *
+ * A sink given an Aggregation (aggregate.h) writes no rows as they come:
+ * it folds them into the aggregates and writes the one result row when
+ * the result ends. One given a Sorter (sort.h) holds the rows, or the
+ * aggregates' result rows, and writes them in order when the result ends.
+ * OFFSET and LIMIT apply to the rows as they are written; once the LIMIT
+ * is reached, result_done() tells the scan feeding the sink to stop.
+ */
+
+#define RESULT_BUFFER_SIZE (256 * 1024)
+#define RESULT_BINARY_END 0xFFFFFFFFu
+
+typedef enum {
+    FORMAT_TABLE,
+    FORMAT_CSV,
+    FORMAT_TSV,
+    FORMAT_BINARY
+} ResultFormat;
+
+typedef struct {
+    ResultFormat format;
+    FILE* out;                  // NULL for a partial result kept in memory
+    struct OutputBuffer* target;    // Captured output of the statement's thread, or NULL
+    const char* overflow;       // Mapped overflow file of the table, for long varchars
+    char* buffer;
+    size_t length;
+    size_t capacity;
+    TableSchema* schema;
+    const int* columns;         // Projected columns and their row offsets
+    const long* offsets;
+    int column_count;
+    long rows;                  // Rows written (or collected for a fold or sort)
+    long skip;                  // OFFSET rows still to drop before writing
+    long limit;                 // LIMIT: rows to write at most, -1 for all
+    struct Aggregation* aggregation;    // Fold rows into aggregates, or NULL
+    struct Sorter* sorter;              // Sort the rows (after aggregating), or NULL
+} ResultSink;
+
+/* Output format for subsequent SELECTs on this thread */
+ResultFormat result_format(void);
+void result_set_format(ResultFormat format);
+
+/* Look a format up by name (table, csv, tsv, binary); returns 0 if unknown */
+int result_format_by_name(const char* name, ResultFormat* format);
+
+/* Start a result: writes the header for the projected columns. The
+   output buffer comes from the statement arena. */
+void result_begin(ResultSink* sink, TableSchema* schema, const int* columns,
+                  const long* offsets, int column_count, Arena* arena);
+
+/* Append one stored row, projecting the sink's columns */
+void result_row(ResultSink* sink, const char* row);
+
+/* Append a block of stored row_size-byte rows: those at the selected
+   positions, or rows [0, count) if selection is NULL */
+void result_rows(ResultSink* sink, const char* rows, int row_size, const uint16_t* selection,
+                 int count);
+
+/* Whether the LIMIT has been written, so no further row can appear */
+int result_done(const ResultSink* sink);
+
+/* Write the footer and flush everything to the output */
+void result_end(ResultSink* sink);
+
+/* Partial result for one morsel of a parallel scan: the parent's format
+   and columns, with rows collected in a growing heap buffer (or folded
+   into private aggregate states, or a private sorter) */
+void result_fork(const ResultSink* parent, ResultSink* part);
+
+/* Append a partial result's rows to the sink and free it */
+void result_merge(ResultSink* sink, ResultSink* part);
+
+#endif
@@ -0,0 +1,370 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "script.h"
+#include "arena.h"
+#include "lexer.h"
+#include "parser.h"
+#include "executor.h"
+#include "plan.h"
+#include "result.h"
+#include "pool.h"
+#include "spill.h"
+#include "platform.h"
+#include "output.h"
+
+typedef enum {
+    ITEM_STATEMENT,
+    ITEM_META,          // .command line
+    ITEM_END            // End of input, or after .exit
+} ItemKind;
+
+/* One queued statement, prepared by the reader and executed by the main thread */
+typedef struct {
+    ItemKind kind;
+    Arena arena;                    // Parse results, then execution scratch
+    char* text;
+    int line;                       // Line the statement starts on
+    int normalized;                 // statement holds the plan cache form
+    NormalizedStatement statement;
+    ASTNode* root;                  // Parsed statement when not normalized
+    const char* error;              // Syntax error, if parsing failed
+} ScriptItem;
+
+typedef struct {
+    FILE* input;
+    char* chunk;                    // Read buffer
+    size_t chunk_length;
+    size_t chunk_pos;
+    char* text;                     // Statement being assembled
+    size_t text_length;
+    size_t text_capacity;
+    int line;
+
+    ScriptItem items[SCRIPT_QUEUE_DEPTH];
+    long produced;                  // Filled by the reader (reader only)
+    long published;                 // Visible to the main thread
+    long consumed;
+    int reader_waiting;             // Signal only a side that is asleep
+    int executor_waiting;
+    Mutex lock;
+    CondVar not_empty;
+    CondVar not_full;
+} Script;
+
+/* ============================================
+   STATEMENT SPLITTING (reader thread)
+   ============================================ */
+
+/* Hand filled slots to the main thread. Done in batches rather than per
+   statement, so the threads are not woken for every item. */
+static void publish(Script* script) {
+    mutex_lock(&script->lock);
+    script->published = script->produced;
+    if (script->executor_waiting) {
+        cond_signal(&script->not_empty);
+    }
+    mutex_unlock(&script->lock);
+}
+
+static int next_char(Script* script) {
+    if (script->chunk_pos == script->chunk_length) {
+        // The read may block on a pipe; let everything read so far run first
+        if (script->published != script->produced) {
+            publish(script);
+        }
+        // A line at a time: fread would wait for a full chunk from a pipe
+        if (!fgets(script->chunk, SCRIPT_READ_CHUNK, script->input)) return EOF;
+        script->chunk_length = strlen(script->chunk);
+        script->chunk_pos = 0;
+    }
+    int c = (unsigned char)script->chunk[script->chunk_pos++];
+    if (c == '\n') script->line++;
+    return c;
+}
+
+static void append_char(Script* script, char c) {
+    if (script->text_length + 1 >= script->text_capacity) {
+        script->text_capacity = script->text_capacity ? script->text_capacity * 2 : 4096;
+        script->text = realloc(script->text, script->text_capacity);
+    }
+    script->text[script->text_length++] = c;
+}
+
+/* Read the next statement or meta-command into script->text */
+static ItemKind read_item(Script* script, int* start_line) {
+    script->text_length = 0;
+
+    int c = next_char(script);
+    while (c != EOF && isspace(c)) c = next_char(script);
+    if (c == EOF) return ITEM_END;
+    *start_line = script->line;
+
+    if (c == '.') {
+        // Meta-commands run to the end of the line
+        while (c != EOF && c != '\n') {
+            append_char(script, (char)c);
+            c = next_char(script);
+        }
+        while (script->text_length > 0 && isspace((unsigned char)script->text[script->text_length - 1])) {
+            script->text_length--;
+        }
+        script->text[script->text_length] = '\0';
+        return ITEM_META;
+    }
+
+    // Statements end at a ';' outside quotes, or at end of input
+    char quote = 0;
+    while (c != EOF) {
+        append_char(script, (char)c);
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '\'' || c == '"') {
+            quote = (char)c;
+        } else if (c == ';') {
+            break;
+        }
+        c = next_char(script);
+    }
+    script->text[script->text_length] = '\0';
+    return ITEM_STATEMENT;
+}
+
+/* Parse ahead so the main thread only executes. Cacheable statements are
+   only normalized; the plan cache parses them once per shape. */
+static void prepare_item(ScriptItem* item) {
+    item->normalized = normalize_statement(item->text, &item->statement, &item->arena);
+    item->root = NULL;
+    item->error = NULL;
+    if (item->normalized) return;
+
+    Lexer lexer = { item->text, 0 };
+    Parser parser;
+    parser_init(&parser, &lexer, &item->arena);
+    item->root = parse_statement(&parser);
+    if (!item->root) {
+        item->error = arena_strdup(&item->arena, parser.error);
+    }
+}
+
+static void reader_main(void* arg) {
+    Script* script = arg;
+
+    for (;;) {
+        // Wait for the main thread to finish with the slot we are about to reuse
+        mutex_lock(&script->lock);
+        while (script->produced - script->consumed == SCRIPT_QUEUE_DEPTH) {
+            script->published = script->produced;
+            if (script->executor_waiting) {
+                cond_signal(&script->not_empty);
+            }
+            script->reader_waiting = 1;
+            cond_wait(&script->not_full, &script->lock);
+            script->reader_waiting = 0;
+        }
+        mutex_unlock(&script->lock);
+
+        ScriptItem* item = &script->items[script->produced % SCRIPT_QUEUE_DEPTH];
+        arena_reset(&item->arena);
+        item->kind = read_item(script, &item->line);
+        if (item->kind != ITEM_END) {
+            item->text = arena_strndup(&item->arena, script->text, script->text_length);
+        }
+        if (item->kind == ITEM_STATEMENT) {
+            prepare_item(item);
+        }
+
+        // Nothing is read past .exit, so a still-open pipe cannot block shutdown
+        int last = item->kind == ITEM_END || (item->kind == ITEM_META && strcmp(item->text, ".exit") == 0);
+
+        script->produced++;
+        if (last || script->produced - script->published >= SCRIPT_PUBLISH_BATCH) {
+            publish(script);
+        }
+
+        if (last) return;
+    }
+}
+
+/* ============================================
+   EXECUTION (main thread)
+   ============================================ */
+
+int run_meta_command(const char* line) {
+    if (strcmp(line, ".exit") == 0) {
+        return META_EXIT;
+    }
+
+    if (strncmp(line, ".mode", 5) == 0 && (line[5] == '\0' || isspace((unsigned char)line[5]))) {
+        const char* name = line + 5;
+        while (isspace((unsigned char)*name)) name++;
+
+        static const char* names[] = { "table", "csv", "tsv", "binary" };
+        ResultFormat format;
+        if (*name == '\0') {
+            out_printf("Output mode: %s\n", names[result_format()]);
+        } else if (result_format_by_name(name, &format)) {
+            result_set_format(format);
+        } else {
+            out_printf("Unknown mode '%s' (table, csv, tsv, binary)\n", name);
+        }
+        return META_HANDLED;
+    }
+
+    if (strncmp(line, ".threads", 8) == 0 && (line[8] == '\0' || isspace((unsigned char)line[8]))) {
+        const char* count = line + 8;
+        while (isspace((unsigned char)*count)) count++;
+        if (*count != '\0') {
+            pool_set_threads(atoi(count));
+        }
+        out_printf("Scan threads: %d\n", pool_threads());
+        return META_HANDLED;
+    }
+
+    if (strncmp(line, ".memory", 7) == 0 && (line[7] == '\0' || isspace((unsigned char)line[7]))) {
+        const char* megabytes = line + 7;
+        while (isspace((unsigned char)*megabytes)) megabytes++;
+        if (*megabytes != '\0') {
+            if (atol(megabytes) <= 0) {
+                out_printf("Usage: .memory <megabytes>\n");
+                return META_HANDLED;
+            }
+            work_memory_set((size_t)atol(megabytes) * 1024 * 1024);
+        }
+        out_printf("Work memory: %lu MB\n", (unsigned long)(work_memory() / (1024 * 1024)));
+        return META_HANDLED;
+    }
+
+    if (strncmp(line, ".ordered", 8) == 0 && (line[8] == '\0' || isspace((unsigned char)line[8]))) {
+        const char* setting = line + 8;
+        while (isspace((unsigned char)*setting)) setting++;
+        if (strcmp(setting, "on") == 0) {
+            parallel_scan_ordered = 1;
+        } else if (strcmp(setting, "off") == 0) {
+            parallel_scan_ordered = 0;
+        } else if (*setting != '\0') {
+            out_printf("Usage: .ordered on|off\n");
+            return META_HANDLED;
+        }
+        out_printf("Parallel scans keep table order: %s\n", parallel_scan_ordered ? "on" : "off");
+        return META_HANDLED;
+    }
+
+    return META_UNKNOWN;
+}
+
+/* Execute one statement; returns 0 if it turned out to have a syntax error */
+static int execute_item(ScriptItem* item) {
+    if (item->normalized) {
+        const char* syntax_error;
+        if (plan_cache_run(item->text, &item->statement, &item->arena, &syntax_error)) {
+            item->error = syntax_error;
+        } else {
+            // Not cached (no database selected): parse it here after all
+            Lexer lexer = { item->text, 0 };
+            Parser parser;
+            parser_init(&parser, &lexer, &item->arena);
+            item->root = parse_statement(&parser);
+            if (!item->root) {
+                item->error = arena_strdup(&item->arena, parser.error);
+            }
+        }
+    }
+
+    if (item->error) {
+        printf("Line %d: %s", item->line, item->error);
+        return 0;
+    }
+    if (item->root) {
+        execute_statement(item->root, &item->arena);
+    }
+    return 1;
+}
+
+int run_script(FILE* input) {
+    Script* script = calloc(1, sizeof(Script));
+    script->input = input;
+    script->chunk = malloc(SCRIPT_READ_CHUNK);
+    script->line = 1;
+    for (int i = 0; i < SCRIPT_QUEUE_DEPTH; i++) {
+        arena_init(&script->items[i].arena, ARENA_DEFAULT_BLOCK_SIZE);
+    }
+    mutex_init(&script->lock);
+    cond_init(&script->not_empty);
+    cond_init(&script->not_full);
+
+    Thread reader;
+    if (!thread_start(&reader, reader_main, script)) {
+        printf("Failed to start script reader\n");
+        return 1;
+    }
+
+    long statements = 0;
+    long errors = 0;
+    long long rows_before = rows_processed;
+    double start = clock_seconds();
+
+    for (;;) {
+        mutex_lock(&script->lock);
+        while (script->consumed == script->published) {
+            script->executor_waiting = 1;
+            cond_wait(&script->not_empty, &script->lock);
+            script->executor_waiting = 0;
+        }
+        mutex_unlock(&script->lock);
+
+        ScriptItem* item = &script->items[script->consumed % SCRIPT_QUEUE_DEPTH];
+        int done = 0;
+
+        if (item->kind == ITEM_END) {
+            done = 1;
+        } else if (item->kind == ITEM_META) {
+            int status = run_meta_command(item->text);
+            if (status == META_EXIT) {
+                done = 1;
+            } else if (status == META_UNKNOWN) {
+                printf("Line %d: unrecognized command '%s'\n", item->line, item->text);
+                errors++;
+            }
+        } else if (execute_item(item)) {
+            statements++;
+        } else {
+            errors++;
+        }
+
+        mutex_lock(&script->lock);
+        script->consumed++;
+        // Let a full queue drain by half before waking the reader again
+        if (script->reader_waiting && script->published - script->consumed <= SCRIPT_QUEUE_DEPTH / 2) {
+            cond_signal(&script->not_full);
+        }
+        mutex_unlock(&script->lock);
+
+        if (done) break;
+    }
+
+    double elapsed = clock_seconds() - start;
+    long long rows = rows_processed - rows_before;
+    thread_join(reader);
+    fflush(stdout);
+
+    if (elapsed <= 0) elapsed = 1e-9;
+    fprintf(stderr, "%ld statement(s), %lld row(s) in %.3f s: %.0f statements/s, %.0f rows/s",
+            statements, rows, elapsed, statements / elapsed, rows / elapsed);
+    if (errors > 0) {
+        fprintf(stderr, ", %ld error(s)", errors);
+    }
+    fprintf(stderr, "\n");
+
+    for (int i = 0; i < SCRIPT_QUEUE_DEPTH; i++) {
+        arena_free(&script->items[i].arena);
+    }
+    mutex_destroy(&script->lock);
+    cond_destroy(&script->not_empty);
+    cond_destroy(&script->not_full);
+    free(script->text);
+    free(script->chunk);
+    free(script);
+    return errors > 0;
+}
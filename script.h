@@ -0,0 +1,35 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stdio.h>
+
+/* =======================
+   SCRIPT MODE
+   ======================= */
+
+/*
+ * Non-interactive execution of a stream of statements (branchdb -f file,
+ * or stdin when it is not a terminal). Statements are split on ';' outside
+ * quotes and may span lines; a line starting with '.' is a meta-command.
+ * A reader thread splits, normalizes and parses ahead while the main
+ * thread executes, through a bounded queue of SCRIPT_QUEUE_DEPTH slots,
+ * each with its own arena. Syntax errors are reported with their line and
+ * do not stop the script. A throughput summary goes to stderr at the end.
+ */
+
+#define SCRIPT_QUEUE_DEPTH 64
+#define SCRIPT_PUBLISH_BATCH 16
+#define SCRIPT_READ_CHUNK (64 * 1024)
+
+/* Run every statement in the stream; returns 0 if all of them parsed */
+int run_script(FILE* input);
+
+/* Meta-commands shared with the REPL and server: .exit, .mode [table|csv|tsv|binary],
+   .threads [count] and .ordered [on|off] for parallel scans */
+#define META_HANDLED 0
+#define META_EXIT 1
+#define META_UNKNOWN 2
+
+int run_meta_command(const char* line);
+
+#endif
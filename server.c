@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "net.h"
+#include "arena.h"
+#include "lexer.h"
+#include "parser.h"
+#include "executor.h"
+#include "wal.h"
+#include "plan.h"
+#include "script.h"
+#include "result.h"
+#include "output.h"
+#include "pool.h"
+#include "spill.h"
+#include "platform.h"
+
+/* =======================
+   BRANCHDB SERVER
+   ======================= */
+
+/*
+ * branchdb-server [-p port] [-w workers] [-t scan threads]
+ *
+ * Accepts clients on a loopback TCP port. Each connection is a session
+ * with its own selected database, prepared statements and output mode.
+ * One thread waits on every idle session with select(); when a complete
+ * request has arrived the session is queued for the worker threads, which
+ * run its requests in order and answer each with the captured output.
+ * A session being worked on is left out of select() until the worker hands
+ * it back, so only one thread ever reads from it.
+ *
+ * A worker runs each statement with the session's state (database,
+ * prepared statements, output mode, .memory setting and output buffer) in
+ * its thread-local slots, under the engine lock that serializes access to
+ * the shared caches and files. Full table scans release the lock while
+ * they read their snapshot, so a long scan does not hold up other
+ * sessions' inserts. Waiting for an insert's log commit, receiving,
+ * framing and sending responses happen outside it.
+ */
+
+#define SERVER_MAX_SESSIONS 256
+#define SERVER_DEFAULT_WORKERS 4
+#define SERVER_INPUT_SIZE 4096
+#define SERVER_OUTPUT_KEEP (1024 * 1024)     // Larger output buffers are freed after a response
+
+typedef struct Session {
+    Socket socket;
+
+    // Engine state while the session is not running
+    char database[128];
+    PreparedStatement* prepared;
+    ResultFormat format;
+    size_t work_memory;             // .memory setting, 0 if unset
+
+    unsigned char* input;           // Received bytes not yet run
+    size_t input_length;
+    size_t input_capacity;
+    OutputBuffer output;            // Response being built
+
+    int busy;                       // Queued or with a worker; guarded by server.lock
+    int closing;
+    struct Session* next_ready;
+} Session;
+
+static struct {
+    Mutex lock;
+    CondVar ready;
+    Session* ready_head;
+    Session* ready_tail;
+
+    Socket wake[2];                 // Workers write to [0] to hand sessions back
+    Session* sessions[SERVER_MAX_SESSIONS];
+    int session_count;
+} server;
+
+/* ============================================
+   SESSIONS
+   ============================================ */
+
+static void session_enter(Session* session) {
+    engine_lock();
+    strcpy(current_database, session->database);
+    prepared_statements_swap(session->prepared);
+    work_memory_swap(session->work_memory);
+    result_set_format(session->format);
+    output_capture(&session->output);
+}
+
+static void session_leave(Session* session) {
+    output_capture(NULL);
+    session->format = result_format();
+    session->prepared = prepared_statements_swap(NULL);
+    session->work_memory = work_memory_swap(0);
+    strcpy(session->database, current_database);
+    current_database[0] = '\0';
+    engine_unlock();
+
+    // Wait for the request's commit outside the lock, where commits from
+    // other sessions can join the same log flush
+    Wal* wal;
+    uint64_t lsn;
+    if (engine_take_commit(&wal, &lsn)) {
+        wal_commit_held(wal, lsn);
+    }
+}
+
+static Session* session_open(Socket socket) {
+    Session* session = calloc(1, sizeof(Session));
+    session->socket = socket;
+    session->format = FORMAT_TABLE;
+    session->input_capacity = SERVER_INPUT_SIZE;
+    session->input = malloc(session->input_capacity);
+    return session;
+}
+
+static void session_close(Session* session) {
+    net_close(session->socket);
+    prepared_statements_free(session->prepared);
+    output_buffer_free(&session->output);
+    free(session->input);
+    free(session);
+}
+
+/* Length of the first complete request in the input, 0 if there is none
+   yet, or -1 if the client sent something that is not a request */
+static long complete_request(Session* session) {
+    if (session->input_length < 4) return 0;
+    uint32_t length = net_get_u32(session->input);
+    if (length > NET_MAX_MESSAGE) return -1;
+    return session->input_length - 4 >= length ? (long)length : 0;
+}
+
+/* ============================================
+   REQUESTS
+   ============================================ */
+
+/* Run one statement or meta-command with the session's state swapped in */
+static int run_request(Session* session, const char* text, Arena* arena) {
+    if (text[0] == '.') {
+        int status = run_meta_command(text);
+        if (status == META_EXIT) {
+            session->closing = 1;
+        } else if (status == META_UNKNOWN) {
+            out_printf("Unrecognized command '%s'\n", text);
+            return STATUS_ERROR;
+        }
+        return STATUS_OK;
+    }
+
+    // Repeated SELECT/INSERT shapes run from the plan cache
+    NormalizedStatement statement;
+    if (normalize_statement(text, &statement, arena)) {
+        const char* syntax_error;
+        if (plan_cache_run(text, &statement, arena, &syntax_error)) {
+            if (syntax_error) {
+                out_printf("%s", syntax_error);
+                return STATUS_ERROR;
+            }
+            return STATUS_OK;
+        }
+    }
+
+    if (text[0] == '\0') {
+        return STATUS_OK;
+    }
+
+    Lexer lexer = { text, 0 };
+    Parser parser;
+    parser_init(&parser, &lexer, arena);
+    ASTNode* root = parse_statement(&parser);
+    if (!root) {
+        out_printf("%s", parser.error);
+        return STATUS_ERROR;
+    }
+    execute_statement(root, arena);
+    return STATUS_OK;
+}
+
+/* Run the session's complete requests in order; returns 0 if the
+   connection failed or the client went away */
+static int serve_session(Session* session, Arena* arena) {
+    long length = 0;
+    while (!session->closing && (length = complete_request(session)) > 0) {
+        char* text = arena_alloc(arena, length + 1);
+        memcpy(text, session->input + 4, length);
+        text[length] = '\0';
+        session->input_length -= 4 + length;
+        memmove(session->input, session->input + 4 + length, session->input_length);
+
+        // The header is filled in once the output's length is known
+        session->output.length = 0;
+        output_append(&session->output, "\0\0\0\0\0", RESPONSE_HEADER_SIZE);
+
+        session_enter(session);
+        int status = run_request(session, text, arena);
+        session_leave(session);
+        arena_reset(arena);
+
+        unsigned char* response = (unsigned char*)session->output.data;
+        net_put_u32(response, (uint32_t)(session->output.length - 4));
+        response[4] = (unsigned char)status;
+        int sent = net_send_all(session->socket, response, session->output.length);
+
+        if (session->output.capacity > SERVER_OUTPUT_KEEP) {
+            output_buffer_free(&session->output);
+        }
+        if (!sent) return 0;
+    }
+    return length >= 0;
+}
+
+static void worker_main(void* arg) {
+    (void)arg;
+    Arena arena;
+    arena_init(&arena, ARENA_DEFAULT_BLOCK_SIZE);
+
+    for (;;) {
+        mutex_lock(&server.lock);
+        while (!server.ready_head) {
+            cond_wait(&server.ready, &server.lock);
+        }
+        Session* session = server.ready_head;
+        server.ready_head = session->next_ready;
+        if (!server.ready_head) server.ready_tail = NULL;
+        mutex_unlock(&server.lock);
+
+        if (!serve_session(session, &arena)) {
+            session->closing = 1;
+        }
+
+        // Hand the session back to the select() loop
+        mutex_lock(&server.lock);
+        session->busy = 0;
+        mutex_unlock(&server.lock);
+        net_send_all(server.wake[0], "w", 1);
+    }
+}
+
+/* ============================================
+   CONNECTIONS
+   ============================================ */
+
+static void queue_session(Session* session) {
+    mutex_lock(&server.lock);
+    session->busy = 1;
+    session->next_ready = NULL;
+    if (server.ready_tail) {
+        server.ready_tail->next_ready = session;
+    } else {
+        server.ready_head = session;
+    }
+    server.ready_tail = session;
+    cond_signal(&server.ready);
+    mutex_unlock(&server.lock);
+}
+
+/* Read what the client sent; returns 0 if the session should close */
+static int receive(Session* session) {
+    if (session->input_capacity - session->input_length < SERVER_INPUT_SIZE) {
+        session->input_capacity *= 2;
+        session->input = realloc(session->input, session->input_capacity);
+    }
+    long received = net_recv(session->socket, session->input + session->input_length,
+                             session->input_capacity - session->input_length);
+    if (received <= 0) return 0;
+    session->input_length += received;
+
+    long length = complete_request(session);
+    if (length < 0) return 0;
+    if (length > 0) queue_session(session);
+    return 1;
+}
+
+static void serve(Socket listener) {
+    for (;;) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listener, &readable);
+        FD_SET(server.wake[1], &readable);
+        Socket highest = listener > server.wake[1] ? listener : server.wake[1];
+
+        // Close finished sessions and wait on the idle ones
+        mutex_lock(&server.lock);
+        for (int i = 0; i < server.session_count; i++) {
+            Session* session = server.sessions[i];
+            if (session->busy) continue;
+            if (session->closing) {
+                session_close(session);
+                server.sessions[i--] = server.sessions[--server.session_count];
+                continue;
+            }
+            FD_SET(session->socket, &readable);
+            if (session->socket > highest) highest = session->socket;
+        }
+        mutex_unlock(&server.lock);
+
+        if (select((int)highest + 1, &readable, NULL, NULL, NULL) < 0) {
+            perror("select");
+            return;
+        }
+
+        if (FD_ISSET(server.wake[1], &readable)) {
+            char drain[64];
+            net_recv(server.wake[1], drain, sizeof(drain));
+        }
+
+        for (int i = 0; i < server.session_count; i++) {
+            Session* session = server.sessions[i];
+            if (FD_ISSET(session->socket, &readable) && !receive(session)) {
+                session->closing = 1;
+            }
+        }
+
+        if (FD_ISSET(listener, &readable)) {
+            Socket client = net_accept(listener);
+            if (client == NET_INVALID) continue;
+            if (server.session_count == SERVER_MAX_SESSIONS) {
+                net_close(client);
+                continue;
+            }
+            server.sessions[server.session_count++] = session_open(client);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int port = NET_DEFAULT_PORT;
+    int workers = SERVER_DEFAULT_WORKERS;
+    work_memory_init();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            pool_set_threads(atoi(argv[++i]));
+        } else {
+            printf("Usage: %s [-p port] [-w workers] [-t scan threads]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (workers < 1) workers = 1;
+
+    if (!net_init()) return 1;
+    Socket listener = net_listen(NULL, port);
+    if (listener == NET_INVALID || !net_socket_pair(server.wake)) {
+        return 1;
+    }
+
+    mutex_init(&server.lock);
+    cond_init(&server.ready);
+    engine_share();
+    for (int i = 0; i < workers; i++) {
+        Thread thread;
+        if (!thread_start(&thread, worker_main, NULL)) {
+            printf("Failed to start worker thread\n");
+            return 1;
+        }
+    }
+
+    printf("Listening on 127.0.0.1:%d with %d worker(s)\n", port, workers);
+    fflush(stdout);
+    serve(listener);
+    return 0;
+}
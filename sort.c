@@ -0,0 +1,556 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sort.h"
+#include "spill.h"
+#include "pool.h"
+#include "output.h"
+
+/* A sorted run written to a spill file */
+typedef struct {
+    SpillFile file;
+    long count;
+} SortRun;
+
+/* Record layout: normalized key, sequence number, then the row */
+struct Sorter {
+    const SortPlan* plan;
+    int row_size;
+    size_t row_offset;          // Key and sequence number, 8-byte aligned
+    size_t record_size;
+    long limit;                 // Rows wanted, negative for all
+    int bounded;                // Keep the best `limit` rows in a heap
+    char* records;
+    long count;
+    long capacity;
+    uint32_t* heap;             // Bounded: record indices, worst row at the root
+    uint64_t next_sequence;
+    SortRun* runs;
+    int run_count;
+    int run_capacity;
+    int spill_failed;           // Could not create a run: stay in memory
+    char db_name[128];
+    size_t budget;
+    char* scratch;              // One record being built
+};
+
+/* In-memory sort entry: the key's first 8 bytes as a number, and its record */
+typedef struct {
+    uint64_t prefix;
+    uint32_t index;
+} SortEntry;
+
+#define RECORD(sorter, index) ((sorter)->records + (size_t)(index) * (sorter)->record_size)
+
+static size_t align8(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+/* ============================================
+   PLANNING
+   ============================================ */
+
+SortPlan* sort_plan(ASTNode* order_by, TableSchema* schema, Arena* arena) {
+    int count = 0;
+    for (ASTNode* item = order_by; item; item = item->right) {
+        count++;
+    }
+
+    SortPlan* plan = arena_calloc(arena, sizeof(SortPlan));
+    plan->keys = arena_calloc(arena, sizeof(SortKey) * count);
+
+    for (ASTNode* item = order_by; item; item = item->right) {
+        // Aggregates are found by their result column's name
+        ASTNode* column = item->left;
+        char name[160];
+        if (column->type == AST_AGGREGATE) {
+            snprintf(name, sizeof(name), "%s(%s)", column->value,
+                     column->left->type == AST_STAR ? "*" : column->left->value);
+        } else {
+            snprintf(name, sizeof(name), "%s", column->value);
+        }
+
+        int index = -1;
+        for (int i = 0; i < schema->column_count && index < 0; i++) {
+            if (strcmp(schema->columns[i].column_name, name) == 0) index = i;
+        }
+        if (index < 0) {
+            out_printf("ORDER BY column '%s' not found\n", name);
+            return NULL;
+        }
+
+        SortKey* key = &plan->keys[plan->key_count++];
+        key->column = index;
+        key->source = schema->columns[index];
+        key->descending = strcmp(item->value, "desc") == 0;
+        key->offset = plan->key_size;
+        switch (key->source.type) {
+            case TYPE_INT:
+            case TYPE_DATE:
+                key->size = sizeof(int);
+                break;
+            case TYPE_VARCHAR:
+                key->size = key->source.overflow ? SORT_TEXT_PREFIX : key->source.width;
+                break;
+            default:
+                key->size = 8;
+        }
+        if (key->source.overflow) plan->key_descriptors = 1;
+        plan->key_size += key->size;
+    }
+    return plan;
+}
+
+SortPlan* sort_plan_copy(const SortPlan* plan, Arena* arena) {
+    SortPlan* copy = arena_alloc(arena, sizeof(SortPlan));
+    *copy = *plan;
+    copy->keys = arena_alloc(arena, sizeof(SortKey) * plan->key_count);
+    memcpy(copy->keys, plan->keys, sizeof(SortKey) * plan->key_count);
+    return copy;
+}
+
+/* ============================================
+   KEYS
+   ============================================ */
+
+static void put_big_endian(char* dest, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+        dest[i] = (char)(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+/* Write a row's normalized key */
+static void build_key(const SortPlan* plan, const char* row, char* key, const char* overflow) {
+    for (int k = 0; k < plan->key_count; k++) {
+        const SortKey* column = &plan->keys[k];
+        const char* src = row + column->source.offset;
+        char* dest = key + column->offset;
+        switch (column->source.type) {
+            case TYPE_INT:
+            case TYPE_DATE: {
+                int value;
+                memcpy(&value, src, sizeof(int));
+                put_big_endian(dest, (uint32_t)value ^ 0x80000000u, sizeof(int));
+                break;
+            }
+            case TYPE_BIGINT: {
+                long long value;
+                memcpy(&value, src, sizeof(long long));
+                put_big_endian(dest, (uint64_t)value ^ 0x8000000000000000ull, 8);
+                break;
+            }
+            case TYPE_DOUBLE: {
+                double value;
+                memcpy(&value, src, sizeof(double));
+                if (value == 0.0) value = 0.0;     // -0.0 sorts with 0.0
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                bits = bits >> 63 ? ~bits : bits ^ 0x8000000000000000ull;
+                put_big_endian(dest, bits, 8);
+                break;
+            }
+            case TYPE_VARCHAR: {
+                const char* text;
+                int length = varchar_text(src, column->source.width, column->source.overflow, overflow,
+                                          &text);
+                if (length > column->size) length = column->size;
+                memcpy(dest, text, length);
+                memset(dest + length, 0, column->size - length);
+                break;
+            }
+            default:
+                memset(dest, 0, column->size);
+        }
+        if (column->descending) {
+            for (int i = 0; i < column->size; i++) dest[i] = (char)~dest[i];
+        }
+    }
+}
+
+/* Order of two records: key, whole long varchars, then arrival */
+static int compare_records(const Sorter* sorter, const char* a, const char* b, const char* overflow) {
+    const SortPlan* plan = sorter->plan;
+    if (!plan->key_descriptors) {
+        int order = memcmp(a, b, plan->key_size);
+        if (order) return order;
+    } else {
+        for (int k = 0; k < plan->key_count; k++) {
+            const SortKey* column = &plan->keys[k];
+            int order = memcmp(a + column->offset, b + column->offset, column->size);
+            if (order) return order;
+            if (!column->source.overflow) continue;
+
+            const char* x_text;
+            const char* y_text;
+            int x_length = varchar_text(a + sorter->row_offset + column->source.offset,
+                                        column->source.width, 1, overflow, &x_text);
+            int y_length = varchar_text(b + sorter->row_offset + column->source.offset,
+                                        column->source.width, 1, overflow, &y_text);
+            order = memcmp(x_text, y_text, x_length < y_length ? x_length : y_length);
+            if (!order) order = x_length - y_length;
+            if (order) return column->descending ? -order : order;
+        }
+    }
+
+    uint64_t x;
+    uint64_t y;
+    memcpy(&x, a + sorter->row_offset - sizeof(uint64_t), sizeof(uint64_t));
+    memcpy(&y, b + sorter->row_offset - sizeof(uint64_t), sizeof(uint64_t));
+    return (x > y) - (x < y);
+}
+
+/* ============================================
+   IN-MEMORY SORT
+   ============================================ */
+
+static THREAD_LOCAL const Sorter* sorting;
+static THREAD_LOCAL const char* sorting_overflow;
+
+static int compare_entries(const void* a, const void* b) {
+    const SortEntry* x = a;
+    const SortEntry* y = b;
+    if (x->prefix != y->prefix) return x->prefix < y->prefix ? -1 : 1;
+    return compare_records(sorting, RECORD(sorting, x->index), RECORD(sorting, y->index),
+                           sorting_overflow);
+}
+
+/* The records in memory, in order (heap) */
+static SortEntry* sort_records(const Sorter* sorter, const char* overflow) {
+    SortEntry* entries = malloc(sizeof(SortEntry) * (sorter->count ? sorter->count : 1));
+    int prefix_size = sorter->plan->key_size < 8 ? sorter->plan->key_size : 8;
+    for (long i = 0; i < sorter->count; i++) {
+        const unsigned char* key = (const unsigned char*)RECORD(sorter, i);
+        uint64_t prefix = 0;
+        for (int b = 0; b < 8; b++) {
+            prefix = prefix << 8 | (b < prefix_size ? key[b] : 0);
+        }
+        entries[i].prefix = prefix;
+        entries[i].index = (uint32_t)i;
+    }
+    sorting = sorter;
+    sorting_overflow = overflow;
+    qsort(entries, sorter->count, sizeof(SortEntry), compare_entries);
+    return entries;
+}
+
+/* ============================================
+   SORTER
+   ============================================ */
+
+Sorter* sorter_new(const SortPlan* plan, int row_size, long limit, const char* db_name,
+                   size_t budget) {
+    Sorter* sorter = calloc(1, sizeof(Sorter));
+    sorter->plan = plan;
+    sorter->row_size = row_size;
+    sorter->row_offset = align8(plan->key_size) + sizeof(uint64_t);
+    sorter->record_size = align8(sorter->row_offset + row_size);
+    sorter->limit = limit;
+    snprintf(sorter->db_name, sizeof(sorter->db_name), "%s", db_name);
+    sorter->budget = budget;
+    sorter->scratch = malloc(sorter->record_size);
+
+    // A heap of `limit` rows, unless even that is past the budget
+    sorter->bounded = limit >= 0 &&
+        (size_t)limit <= budget / (sorter->record_size + sizeof(SortEntry) + sizeof(uint32_t));
+    if (sorter->bounded) {
+        sorter->heap = malloc(sizeof(uint32_t) * (limit ? limit : 1));
+    }
+    return sorter;
+}
+
+Sorter* sorter_fork(const Sorter* parent) {
+    return sorter_new(parent->plan, parent->row_size, parent->limit, parent->db_name,
+                      parent->budget / pool_threads());
+}
+
+void sorter_free(Sorter* sorter) {
+    if (!sorter) return;
+    for (int r = 0; r < sorter->run_count; r++) {
+        spill_remove(&sorter->runs[r].file);
+    }
+    free(sorter->runs);
+    free(sorter->records);
+    free(sorter->heap);
+    free(sorter->scratch);
+    free(sorter);
+}
+
+/* Sort the records in memory and write them out as a run */
+static void spill_run(Sorter* sorter, const char* overflow) {
+    SortRun run = { { NULL, "" }, sorter->count };
+    if (!spill_open(&run.file, sorter->db_name)) {
+        sorter->spill_failed = 1;
+        return;
+    }
+    SortEntry* entries = sort_records(sorter, overflow);
+    for (long i = 0; i < sorter->count; i++) {
+        fwrite(RECORD(sorter, entries[i].index), sorter->record_size, 1, run.file.file);
+    }
+    free(entries);
+
+    if (sorter->run_count == sorter->run_capacity) {
+        sorter->run_capacity = sorter->run_capacity ? sorter->run_capacity * 2 : 16;
+        sorter->runs = realloc(sorter->runs, sizeof(SortRun) * sorter->run_capacity);
+    }
+    sorter->runs[sorter->run_count++] = run;
+    sorter->count = 0;
+}
+
+/* Room for one more record: grow within the budget, or spill a run */
+static char* next_slot(Sorter* sorter, const char* overflow) {
+    if (sorter->count == sorter->capacity) {
+        size_t per_row = sorter->record_size + sizeof(SortEntry);
+        long fits = (long)(sorter->budget / per_row);
+        if (!sorter->bounded && sorter->count >= fits && sorter->count > 0 && !sorter->spill_failed) {
+            spill_run(sorter, overflow);
+        }
+    }
+    if (sorter->count == sorter->capacity) {
+        long capacity = sorter->capacity ? sorter->capacity * 2 : SORT_INITIAL_ROWS;
+        if (sorter->bounded && capacity > sorter->limit) capacity = sorter->limit;
+        if (!sorter->bounded && !sorter->spill_failed) {
+            long fits = (long)(sorter->budget / (sorter->record_size + sizeof(SortEntry)));
+            if (capacity > fits) capacity = fits > sorter->count ? fits : sorter->count + 1;
+        }
+        sorter->capacity = capacity;
+        sorter->records = realloc(sorter->records, (size_t)capacity * sorter->record_size);
+    }
+    return RECORD(sorter, sorter->count);
+}
+
+static int heap_less(const Sorter* sorter, uint32_t a, uint32_t b, const char* overflow) {
+    return compare_records(sorter, RECORD(sorter, a), RECORD(sorter, b), overflow) < 0;
+}
+
+/* Restore the max-heap above and below position i */
+static void heap_sift_up(Sorter* sorter, long i, const char* overflow) {
+    uint32_t* heap = sorter->heap;
+    while (i > 0) {
+        long parent = (i - 1) / 2;
+        if (!heap_less(sorter, heap[parent], heap[i], overflow)) break;
+        uint32_t swap = heap[parent];
+        heap[parent] = heap[i];
+        heap[i] = swap;
+        i = parent;
+    }
+}
+
+static void heap_sift_down(Sorter* sorter, long i, const char* overflow) {
+    uint32_t* heap = sorter->heap;
+    for (;;) {
+        long largest = i;
+        long left = 2 * i + 1;
+        long right = left + 1;
+        if (left < sorter->count && heap_less(sorter, heap[largest], heap[left], overflow)) largest = left;
+        if (right < sorter->count && heap_less(sorter, heap[largest], heap[right], overflow)) largest = right;
+        if (largest == i) break;
+        uint32_t swap = heap[largest];
+        heap[largest] = heap[i];
+        heap[i] = swap;
+        i = largest;
+    }
+}
+
+/* Take a built record: keep it, or with a full heap, let it replace the
+   worst row if it sorts before it */
+static void offer(Sorter* sorter, const char* record, const char* overflow) {
+    if (sorter->bounded && sorter->count == sorter->limit) {
+        if (sorter->limit == 0) return;
+        char* worst = RECORD(sorter, sorter->heap[0]);
+        if (compare_records(sorter, record, worst, overflow) >= 0) return;
+        memcpy(worst, record, sorter->record_size);
+        heap_sift_down(sorter, 0, overflow);
+        return;
+    }
+
+    memcpy(next_slot(sorter, overflow), record, sorter->record_size);
+    if (sorter->bounded) {
+        sorter->heap[sorter->count] = (uint32_t)sorter->count;
+        sorter->count++;
+        heap_sift_up(sorter, sorter->count - 1, overflow);
+    } else {
+        sorter->count++;
+    }
+}
+
+void sorter_add(Sorter* sorter, const char* rows, int block_row_size, const uint16_t* selection,
+                int count, const char* overflow) {
+    char* record = sorter->scratch;
+    memset(record, 0, sorter->record_size);
+    for (int i = 0; i < count; i++) {
+        const char* row = rows + (long)(selection ? selection[i] : i) * block_row_size;
+        build_key(sorter->plan, row, record, overflow);
+        memcpy(record + sorter->row_offset - sizeof(uint64_t), &sorter->next_sequence, sizeof(uint64_t));
+        sorter->next_sequence++;
+        memcpy(record + sorter->row_offset, row, sorter->row_size);
+        offer(sorter, record, overflow);
+    }
+}
+
+void sorter_merge(Sorter* into, Sorter* from, const char* overflow) {
+    for (long i = 0; i < from->count; i++) {
+        offer(into, RECORD(from, i), overflow);
+    }
+    for (int r = 0; r < from->run_count; r++) {
+        if (into->run_count == into->run_capacity) {
+            into->run_capacity = into->run_capacity ? into->run_capacity * 2 : 16;
+            into->runs = realloc(into->runs, sizeof(SortRun) * into->run_capacity);
+        }
+        into->runs[into->run_count++] = from->runs[r];
+    }
+    from->run_count = 0;
+    sorter_free(from);
+}
+
+/* ============================================
+   MERGING RUNS
+   ============================================ */
+
+/* One sorted input of a merge: a run, or the sorted records in memory */
+typedef struct {
+    FILE* file;
+    const SortEntry* entries;
+    long remaining;
+    const char* current;
+    char* buffer;
+} MergeInput;
+
+static int merge_advance(const Sorter* sorter, MergeInput* input) {
+    if (input->remaining == 0) return 0;
+    input->remaining--;
+    if (input->file) {
+        if (fread(input->buffer, sorter->record_size, 1, input->file) != 1) return 0;
+        input->current = input->buffer;
+    } else {
+        input->current = RECORD(sorter, input->entries->index);
+        input->entries++;
+    }
+    return 1;
+}
+
+/* Whether input a's record goes before b's; earlier inputs win ties */
+static int merge_before(const Sorter* sorter, const MergeInput* inputs, int a, int b,
+                        const char* overflow) {
+    int order = compare_records(sorter, inputs[a].current, inputs[b].current, overflow);
+    return order < 0 || (order == 0 && a < b);
+}
+
+/* Merge the inputs, writing records to out or passing rows to emit; stops
+   after limit rows if limit is not negative */
+static void merge_inputs(const Sorter* sorter, MergeInput* inputs, int input_count, const char* overflow,
+                         FILE* out, long limit, SortEmit emit, void* context) {
+    // Min-heap of the inputs that still have a record
+    int* heap = malloc(sizeof(int) * input_count);
+    int size = 0;
+    for (int i = 0; i < input_count; i++) {
+        if (!merge_advance(sorter, &inputs[i])) continue;
+        int child = size++;
+        heap[child] = i;
+        while (child > 0 && merge_before(sorter, inputs, heap[child], heap[(child - 1) / 2], overflow)) {
+            int swap = heap[child];
+            heap[child] = heap[(child - 1) / 2];
+            heap[(child - 1) / 2] = swap;
+            child = (child - 1) / 2;
+        }
+    }
+
+    for (long written = 0; size > 0 && (limit < 0 || written < limit); written++) {
+        MergeInput* input = &inputs[heap[0]];
+        if (out) {
+            fwrite(input->current, sorter->record_size, 1, out);
+        } else {
+            emit(context, input->current + sorter->row_offset);
+        }
+        if (!merge_advance(sorter, input)) {
+            heap[0] = heap[--size];
+        }
+        for (int i = 0;;) {
+            int first = i;
+            int left = 2 * i + 1;
+            int right = left + 1;
+            if (left < size && merge_before(sorter, inputs, heap[left], heap[first], overflow)) first = left;
+            if (right < size && merge_before(sorter, inputs, heap[right], heap[first], overflow)) first = right;
+            if (first == i) break;
+            int swap = heap[first];
+            heap[first] = heap[i];
+            heap[i] = swap;
+            i = first;
+        }
+    }
+    free(heap);
+}
+
+static void open_run_input(const Sorter* sorter, SortRun* run, MergeInput* input) {
+    spill_rewind(&run->file);
+    input->file = run->file.file;
+    input->entries = NULL;
+    input->remaining = run->count;
+    input->buffer = malloc(sorter->record_size);
+}
+
+/* Merge runs SORT_MERGE_FANIN at a time until one more merge is enough */
+static void merge_pass(Sorter* sorter, const char* overflow) {
+    MergeInput inputs[SORT_MERGE_FANIN];
+    int merged = 0;
+    for (int first = 0; first < sorter->run_count; first += SORT_MERGE_FANIN) {
+        int count = sorter->run_count - first < SORT_MERGE_FANIN ? sorter->run_count - first
+                                                                 : SORT_MERGE_FANIN;
+        SortRun run = { { NULL, "" }, 0 };
+        if (!spill_open(&run.file, sorter->db_name)) {
+            // Keep the runs as they are and merge them all at the end
+            for (int r = first; r < sorter->run_count; r++) sorter->runs[merged++] = sorter->runs[r];
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            open_run_input(sorter, &sorter->runs[first + i], &inputs[i]);
+            run.count += sorter->runs[first + i].count;
+        }
+        merge_inputs(sorter, inputs, count, overflow, run.file.file, -1, NULL, NULL);
+        for (int i = 0; i < count; i++) {
+            free(inputs[i].buffer);
+            spill_remove(&sorter->runs[first + i].file);
+        }
+        sorter->runs[merged++] = run;
+    }
+    sorter->run_count = merged;
+}
+
+void sorter_finish(Sorter* sorter, const char* overflow, SortEmit emit, void* context) {
+    while (sorter->run_count > SORT_MERGE_FANIN) {
+        int before = sorter->run_count;
+        merge_pass(sorter, overflow);
+        if (sorter->run_count == before) break;
+    }
+
+    // The runs, then the rows still in memory, which came in last
+    SortEntry* entries = sort_records(sorter, overflow);
+    int input_count = sorter->run_count + 1;
+    MergeInput* inputs = malloc(sizeof(MergeInput) * input_count);
+    for (int r = 0; r < sorter->run_count; r++) {
+        open_run_input(sorter, &sorter->runs[r], &inputs[r]);
+    }
+    MergeInput* memory = &inputs[sorter->run_count];
+    memory->file = NULL;
+    memory->entries = entries;
+    memory->remaining = sorter->count;
+    memory->buffer = NULL;
+
+    if (sorter->run_count == 0) {
+        long rows = sorter->limit >= 0 && sorter->limit < sorter->count ? sorter->limit : sorter->count;
+        for (long i = 0; i < rows; i++) {
+            emit(context, RECORD(sorter, entries[i].index) + sorter->row_offset);
+        }
+    } else {
+        merge_inputs(sorter, inputs, input_count, overflow, NULL, sorter->limit, emit, context);
+    }
+
+    for (int r = 0; r < sorter->run_count; r++) {
+        free(inputs[r].buffer);
+        spill_remove(&sorter->runs[r].file);
+    }
+    sorter->run_count = 0;
+    sorter->count = 0;
+    free(inputs);
+    free(entries);
+}
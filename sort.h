@@ -0,0 +1,89 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ast.h"
+#include "executor.h"
+
+/* =======================
+   ORDER BY
+   ======================= */
+
+/*
+ * ORDER BY sorts the rows that reach the result sink: stored table rows,
+ * or the result rows of GROUP BY and aggregates. Each row is kept next to
+ * a normalized key, the sort columns rewritten so that memcmp orders
+ * them: ints and dates big-endian with the sign bit flipped, doubles by
+ * their IEEE bits (sign flipped, or every bit for negatives), varchars
+ * as their null-padded bytes, and every byte inverted for DESC. A long
+ * varchar contributes its first SORT_TEXT_PREFIX bytes and equal prefixes
+ * compare the whole text. Rows with equal keys keep the order they came
+ * in, so a serial scan breaks ties in table order.
+ *
+ * With a LIMIT k the sorter holds only the best k rows, in a max-heap
+ * whose root is the row the next better one replaces. Without one, rows
+ * collect in memory and are sorted by an array of (first 8 key bytes,
+ * row) entries; once they pass the work_memory budget (spill.h) they are
+ * sorted and written out as a run, and at the end the runs are merged
+ * SORT_MERGE_FANIN at a time until one merge produces the result.
+ * Parallel workers sort into private sorters that are merged into the
+ * statement's.
+ *
+ * An ORDER BY on the indexed column alone, without GROUP BY or
+ * aggregates, reads the rows in B-tree order instead and sorts nothing.
+ */
+
+#define SORT_TEXT_PREFIX 16             // Key bytes of a long varchar
+#define SORT_MERGE_FANIN 64             // Runs merged at once
+#define SORT_INITIAL_ROWS 1024
+
+typedef struct {
+    int column;             // Index in the sorted rows' schema
+    ColumnSchema source;    // Copy of the column, offset in the row
+    int descending;
+    int offset;             // Offset inside the normalized key
+    int size;
+} SortKey;
+
+typedef struct SortPlan {
+    SortKey* keys;
+    int key_count;
+    int key_size;           // Bytes of a normalized key
+    int key_descriptors;    // Keys include long varchars, ties compare text
+} SortPlan;
+
+typedef struct Sorter Sorter;
+
+/* Resolve an ORDER BY list (AST_SORT_KEY nodes) against the schema of the
+   rows being sorted. Returns NULL and prints an error for a column that
+   is not there. */
+SortPlan* sort_plan(ASTNode* order_by, TableSchema* schema, Arena* arena);
+
+/* Copy of a plan for a scan that runs outside the engine lock */
+SortPlan* sort_plan_copy(const SortPlan* plan, Arena* arena);
+
+/* Sorter for row_size-byte rows keeping the first limit of them (all if
+   limit is negative); runs spill into db_name's directory once the rows
+   take more than budget bytes */
+Sorter* sorter_new(const SortPlan* plan, int row_size, long limit, const char* db_name,
+                   size_t budget);
+
+/* Private sorter for one parallel worker, with its share of the budget */
+Sorter* sorter_fork(const Sorter* parent);
+void sorter_free(Sorter* sorter);
+
+/* Add count rows: the rows at the given positions of a block of
+   block_row_size-byte rows, or rows [0, count) if selection is NULL.
+   overflow is the mapped overflow file, for long varchar keys. */
+void sorter_add(Sorter* sorter, const char* rows, int block_row_size, const uint16_t* selection,
+                int count, const char* overflow);
+
+/* Move a worker's rows into the total, and free its sorter */
+void sorter_merge(Sorter* into, Sorter* from, const char* overflow);
+
+/* Pass the rows to emit in order, at most the limit */
+typedef void (*SortEmit)(void* context, const char* row);
+void sorter_finish(Sorter* sorter, const char* overflow, SortEmit emit, void* context);
+
+#endif
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+#include "spill.h"
+#include "output.h"
+#include "platform.h"
+
+static size_t memory_limit = (size_t)WORK_MEMORY_DEFAULT_MB * 1024 * 1024;
+static THREAD_LOCAL size_t session_limit;   // .memory of the running session, 0 if unset
+static unsigned int spill_sequence;         // Unique spill file names
+
+void work_memory_init(void) {
+    const char* env = getenv("BRANCHDB_WORK_MEMORY_MB");
+    long megabytes = env ? atol(env) : 0;
+    if (megabytes > 0) {
+        memory_limit = (size_t)megabytes * 1024 * 1024;
+    }
+}
+
+size_t work_memory(void) {
+    return session_limit ? session_limit : memory_limit;
+}
+
+void work_memory_set(size_t bytes) {
+    session_limit = bytes;
+}
+
+size_t work_memory_swap(size_t bytes) {
+    size_t previous = session_limit;
+    session_limit = bytes;
+    return previous;
+}
+
+int spill_open(SpillFile* spill, const char* db_name) {
+    // The process id keeps the REPL and a server on the same database apart
+    unsigned int sequence = __atomic_fetch_add(&spill_sequence, 1, __ATOMIC_RELAXED);
+    snprintf(spill->path, sizeof(spill->path), "databases\\%s\\spill_%lu_%u.tmp", db_name,
+             (unsigned long)GetCurrentProcessId(), sequence);
+    spill->file = fopen(spill->path, "w+b");
+    if (!spill->file) {
+        out_perror("Failed to create spill file");
+        return 0;
+    }
+    return 1;
+}
+
+void spill_rewind(SpillFile* spill) {
+    fflush(spill->file);
+    rewind(spill->file);
+}
+
+void spill_remove(SpillFile* spill) {
+    if (spill->file) {
+        fclose(spill->file);
+        spill->file = NULL;
+        DeleteFile(spill->path);
+    }
+}
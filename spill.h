@@ -0,0 +1,50 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* =======================
+   OPERATOR MEMORY AND SPILL FILES
+   ======================= */
+
+/*
+ * Operators that collect a statement's rows (GROUP BY, DISTINCT, ORDER
+ * BY) keep them in memory up to work_memory bytes. Past that they write
+ * partial results to spill files: temporary files in the current database's
+ * directory, named by process id and sequence number so that processes
+ * sharing a database never write to each other's, and deleted as soon as
+ * the statement has read them back. A
+ * spill file is plain stdio, outside the buffer pool and the WAL; it
+ * never outlives its statement, so there is nothing to recover.
+ */
+
+#define WORK_MEMORY_DEFAULT_MB 64
+
+/* Read BRANCHDB_WORK_MEMORY_MB; called once at startup */
+void work_memory_init(void);
+
+/* Bytes an operator may hold before spilling: the session's .memory
+   setting, or else BRANCHDB_WORK_MEMORY_MB */
+size_t work_memory(void);
+void work_memory_set(size_t bytes);
+
+/* The .memory setting belongs to a session (0 if unset): the server swaps
+   each session's in while it runs and back out afterwards */
+size_t work_memory_swap(size_t bytes);
+
+typedef struct {
+    FILE* file;
+    char path[256];
+} SpillFile;
+
+/* Create a fresh spill file in databases\<db_name>. Returns 0 on failure. */
+int spill_open(SpillFile* spill, const char* db_name);
+
+/* Rewind a spill file to read back what was written */
+void spill_rewind(SpillFile* spill);
+
+/* Close and delete a spill file; a file that was never opened is ignored */
+void spill_remove(SpillFile* spill);
+
+#endif
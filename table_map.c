@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "table_map.h"
+#include "platform.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static MappedTable* maps[TABLE_MAP_MAX_FILES];
+static int next_victim = 0;
+static MappedTable* retired;        // Out of the cache, still being read
+
+static Mutex lock;
+static CondVar released;            // A retired mapping's last reader finished
+static int initialized;
+
+/* ============================================
+   PLATFORM MAPPING
+   ============================================ */
+
+#ifdef _WIN32
+
+static int map_file(MappedTable* map) {
+    HANDLE file = CreateFileA(map->path, GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return 0;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return 0;
+    }
+
+    const char* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return 0;
+    }
+
+    map->file_handle = file;
+    map->mapping_handle = mapping;
+    map->data = data;
+    map->size = (long)size.QuadPart;
+    return 1;
+}
+
+static void unmap_file(MappedTable* map) {
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping_handle);
+    CloseHandle(map->file_handle);
+    map->data = NULL;
+    map->size = 0;
+}
+
+static long file_size_on_disk(MappedTable* map) {
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(map->file_handle, &size)) return -1;
+    return (long)size.QuadPart;
+}
+
+#else
+
+static int map_file(MappedTable* map) {
+    int fd = open(map->path, O_RDONLY);
+    if (fd == -1) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return 0;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    map->fd = fd;
+    map->data = data;
+    map->size = (long)st.st_size;
+    return 1;
+}
+
+static void unmap_file(MappedTable* map) {
+    munmap((void*)map->data, map->size);
+    close(map->fd);
+    map->data = NULL;
+    map->size = 0;
+}
+
+static long file_size_on_disk(MappedTable* map) {
+    struct stat st;
+    if (fstat(map->fd, &st) != 0) return -1;
+    return (long)st.st_size;
+}
+
+#endif
+
+/* ============================================
+   MAPPING CACHE
+   ============================================ */
+
+static void ensure_init(void) {
+    if (!initialized) {
+        mutex_init(&lock);
+        cond_init(&released);
+        initialized = 1;
+    }
+}
+
+/* Take a mapping out of the cache; it is freed once its last reader is done */
+static void retire(MappedTable* map) {
+    if (map->readers == 0) {
+        unmap_file(map);
+        free(map);
+        return;
+    }
+    map->retired = 1;
+    map->next_retired = retired;
+    retired = map;
+}
+
+static int path_in_use(const char* path) {
+    for (MappedTable* map = retired; map; map = map->next_retired) {
+        if (strcmp(map->path, path) == 0) return 1;
+    }
+    return 0;
+}
+
+MappedTable* table_map(const char* path, long min_size) {
+    ensure_init();
+    mutex_lock(&lock);
+
+    int slot = -1;
+    for (int i = 0; i < TABLE_MAP_MAX_FILES; i++) {
+        if (maps[i] && strcmp(maps[i]->path, path) == 0) {
+            slot = i;
+            break;
+        }
+    }
+
+    // Existing mapping: remap only if the file grew past what is visible
+    if (slot >= 0) {
+        MappedTable* current = maps[slot];
+        if (current->size >= min_size || file_size_on_disk(current) == current->size) {
+            MappedTable* result = current->size >= min_size ? current : NULL;
+            if (result) result->readers++;
+            mutex_unlock(&lock);
+            return result;
+        }
+    } else {
+        for (int i = 0; i < TABLE_MAP_MAX_FILES && slot < 0; i++) {
+            if (!maps[i]) slot = i;
+        }
+        if (slot < 0) {
+            slot = next_victim;
+            next_victim = (next_victim + 1) % TABLE_MAP_MAX_FILES;
+        }
+    }
+
+    // A scan still reading the old mapping keeps it until it is released
+    if (maps[slot]) {
+        retire(maps[slot]);
+        maps[slot] = NULL;
+    }
+
+    MappedTable* map = calloc(1, sizeof(MappedTable));
+    strncpy(map->path, path, sizeof(map->path) - 1);
+    if (!map_file(map)) {
+        free(map);
+        mutex_unlock(&lock);
+        return NULL;
+    }
+    maps[slot] = map;
+
+    MappedTable* result = map->size >= min_size ? map : NULL;
+    if (result) result->readers++;
+    mutex_unlock(&lock);
+    return result;
+}
+
+void table_release(MappedTable* map) {
+    if (!map) return;
+    mutex_lock(&lock);
+    map->readers--;
+    if (map->retired && map->readers == 0) {
+        MappedTable** link = &retired;
+        while (*link != map) {
+            link = &(*link)->next_retired;
+        }
+        *link = map->next_retired;
+        unmap_file(map);
+        free(map);
+        cond_broadcast(&released);
+    }
+    mutex_unlock(&lock);
+}
+
+void table_unmap(const char* path) {
+    ensure_init();
+    mutex_lock(&lock);
+    for (int i = 0; i < TABLE_MAP_MAX_FILES; i++) {
+        if (maps[i] && strcmp(maps[i]->path, path) == 0) {
+            retire(maps[i]);
+            maps[i] = NULL;
+        }
+    }
+
+    // The file is about to be deleted or replaced: wait out the scans on it
+    while (path_in_use(path)) {
+        cond_wait(&released, &lock);
+    }
+    mutex_unlock(&lock);
+}
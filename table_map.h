@@ -0,0 +1,52 @@
+#ifndef TABLE_MAP_H
+#define TABLE_MAP_H
+
+/* =======================
+   MEMORY-MAPPED TABLE FILES
+   ======================= */
+
+/*
+ * Read-only mappings of .table files for scans. Rows are fixed width, so
+ * a scan reads columns in place from the mapping with no copies and no
+ * per-row system calls. Mappings are cached per path and remapped when
+ * the file has grown past the mapped length.
+ *
+ * Tables only grow by appending rows, so a scan that reads the row count
+ * once and then holds the mapping sees a stable snapshot while inserts
+ * continue. Each table_map() is a read reference: a remap or eviction
+ * retires the old mapping instead of unmapping it under a running scan,
+ * and it is released when the last reader is done. table_unmap() is the
+ * writer side, for dropping a table: it waits until no scan is reading
+ * the file.
+ */
+
+#define TABLE_MAP_MAX_FILES 32
+
+typedef struct MappedTable {
+    char path[256];
+    const char* data;   // Start of the mapped file
+    long size;          // Mapped length in bytes
+#ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+#else
+    int fd;
+#endif
+    int readers;        // Scans holding the mapping
+    int retired;        // No longer cached; freed by the last reader
+    struct MappedTable* next_retired;
+} MappedTable;
+
+/* Map a table file so that at least min_size bytes are visible.
+   Returns NULL if the file cannot be mapped; callers then read through
+   the buffer pool. The mapping stays valid until table_release(). */
+MappedTable* table_map(const char* path, long min_size);
+
+/* Done reading a mapping from table_map(); NULL is ignored */
+void table_release(MappedTable* map);
+
+/* Drop the mapping for a path before the file is deleted, waiting for
+   scans still reading it */
+void table_unmap(const char* path);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Generates keywords.h: a collision-free (perfect) hash table for the SQL
+ * keywords, so the lexer recognises them with one hash and one compare
+ * and needs no table setup at startup. Rerun after changing the list:
+ *
+ *     gcc tools/gen_keywords.c -o gen_keywords && ./gen_keywords > keywords.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const char* text;
+    const char* token;
+} KeywordSpec;
+
+static const KeywordSpec keywords[] = {
+    { "select", "TOKEN_SELECT" },
+    { "create", "TOKEN_CREATE" },
+    { "table", "TOKEN_TABLE" },
+    { "database", "TOKEN_DATABASE" },
+    { "show", "TOKEN_SHOW" },
+    { "databases", "TOKEN_DATABASES" },
+    { "tables", "TOKEN_TABLES" },
+    { "insert", "TOKEN_INSERT" },
+    { "into", "TOKEN_INTO" },
+    { "values", "TOKEN_VALUES" },
+    { "load", "TOKEN_LOAD" },
+    { "data", "TOKEN_DATA" },
+    { "prepare", "TOKEN_PREPARE" },
+    { "execute", "TOKEN_EXECUTE" },
+    { "as", "TOKEN_AS" },
+    { "from", "TOKEN_FROM" },
+    { "use", "TOKEN_USE" },
+    { "where", "TOKEN_WHERE" },
+    { "and", "TOKEN_AND" },
+    { "or", "TOKEN_OR" },
+    { "varchar", "TOKEN_VARCHAR" },
+    { "int", "TOKEN_INT" },
+    { "double", "TOKEN_DOUBLE" },
+    { "date", "TOKEN_DATE" },
+    { "storage", "TOKEN_STORAGE" },
+    { "distinct", "TOKEN_DISTINCT" },
+    { "group", "TOKEN_GROUP" },
+    { "by", "TOKEN_BY" },
+    { "order", "TOKEN_ORDER" },
+    { "asc", "TOKEN_ASC" },
+    { "desc", "TOKEN_DESC" },
+    { "limit", "TOKEN_LIMIT" },
+    { "offset", "TOKEN_OFFSET" },
+    { "join", "TOKEN_JOIN" },
+    { "on", "TOKEN_ON" },
+};
+
+#define KEYWORD_COUNT (sizeof(keywords) / sizeof(keywords[0]))
+#define MAX_TABLE_BITS 10
+
+/* Must match keyword_hash() emitted below */
+static unsigned int hash(const char* text, unsigned int seed, unsigned int mask) {
+    size_t length = strlen(text);
+    unsigned int h = seed ^ (unsigned int)length;
+    h = h * 31 + (unsigned char)text[0];
+    h = h * 31 + (unsigned char)text[length / 2];
+    h = h * 31 + (unsigned char)text[length - 1];
+    h ^= h >> 7;
+    return h & mask;
+}
+
+int main(void) {
+    int max_length = 0;
+    for (int i = 0; i < (int)KEYWORD_COUNT; i++) {
+        if ((int)strlen(keywords[i].text) > max_length) max_length = (int)strlen(keywords[i].text);
+    }
+
+    for (int bits = 5; bits <= MAX_TABLE_BITS; bits++) {
+        unsigned int size = 1u << bits;
+        unsigned int mask = size - 1;
+
+        for (unsigned int seed = 0; seed < 100000; seed++) {
+            int slots[1 << MAX_TABLE_BITS];
+            memset(slots, -1, sizeof(slots));
+
+            int ok = 1;
+            for (int i = 0; i < (int)KEYWORD_COUNT && ok; i++) {
+                unsigned int h = hash(keywords[i].text, seed, mask);
+                if (slots[h] != -1) ok = 0;
+                slots[h] = i;
+            }
+            if (!ok) continue;
+
+            printf("/* Generated by tools/gen_keywords.c -- do not edit */\n");
+            printf("#ifndef KEYWORDS_H\n#define KEYWORDS_H\n\n");
+            printf("#define KEYWORD_HASH_SEED %uu\n", seed);
+            printf("#define KEYWORD_HASH_MASK %uu\n", mask);
+            printf("#define KEYWORD_MAX_LENGTH %d\n\n", max_length);
+            printf("/* Keywords are lowercase; the input is lowercased before hashing */\n");
+            printf("static unsigned int keyword_hash(const char* text, int length) {\n");
+            printf("    unsigned int h = KEYWORD_HASH_SEED ^ (unsigned int)length;\n");
+            printf("    h = h * 31 + (unsigned char)text[0];\n");
+            printf("    h = h * 31 + (unsigned char)text[length / 2];\n");
+            printf("    h = h * 31 + (unsigned char)text[length - 1];\n");
+            printf("    h ^= h >> 7;\n");
+            printf("    return h & KEYWORD_HASH_MASK;\n");
+            printf("}\n\n");
+            printf("static const struct {\n");
+            printf("    const char* text;\n");
+            printf("    int length;\n");
+            printf("    TokenType type;\n");
+            printf("} keyword_slots[%u] = {\n", size);
+            for (unsigned int h = 0; h < size; h++) {
+                if (slots[h] == -1) continue;
+                printf("    [%u] = { \"%s\", %d, %s },\n", h, keywords[slots[h]].text,
+                       (int)strlen(keywords[slots[h]].text), keywords[slots[h]].token);
+            }
+            printf("};\n\n#endif\n");
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "No perfect hash found\n");
+    return 1;
+}
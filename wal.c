@@ -0,0 +1,565 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wal.h"
+#include "buffer_pool.h"
+#include "executor.h"
+#include "column_store.h"
+#include "platform.h"
+#include "output.h"
+
+#define WAL_FLUSH_BYTES (4L * 1024 * 1024)   // Write out the log buffer past this size
+#define WAL_RECOVERY_TABLES 64                // Indexes checked after a replay
+
+typedef struct {
+    uint32_t type;
+    uint32_t length;        // Payload bytes following the header
+    uint32_t checksum;      // FNV-1a over type, length and payload
+} WalRecordHeader;
+
+typedef struct {
+    char table_name[64];
+    int32_t first_row_id;
+    int32_t row_size;
+    int32_t count;          // Followed by count * row_size bytes of rows
+} WalRowsPayload;
+
+typedef struct {
+    char table_name[64];
+    int32_t count;          // Followed by count BTreeEntry
+} WalIndexPayload;
+
+typedef struct {
+    char table_name[64];
+    uint64_t offset;
+    uint32_t length;        // Followed by length bytes of values
+} WalOverflowPayload;
+
+typedef struct {
+    char table_name[64];
+    int32_t column;         // -1 for the .table file
+    uint32_t length;        // Followed by length bytes
+    uint64_t offset;
+} WalColumnPayload;
+
+struct Wal {
+    char db_name[128];
+    char path[256];
+    FILE* file;
+    Mutex lock;
+    CondVar flushed;
+    char* buffer;           // Records logged but not yet written
+    size_t used;
+    size_t capacity;
+    char* spare;            // Swapped in while a leader writes the buffer
+    size_t spare_capacity;
+    uint64_t next_lsn;      // End of the last logged record
+    uint64_t durable_lsn;   // End of the last written and synced record
+    uint64_t file_start;    // LSN at the start of the file (last checkpoint)
+    int flushing;           // A group commit leader is writing
+    int holders;            // Commits waiting outside the engine lock
+};
+
+static Wal* wals[WAL_MAX_DATABASES];
+static long commit_delay_us = -1;
+
+/* ============================================
+   LOGGING
+   ============================================ */
+
+static uint32_t checksum_update(uint32_t hash, const void* data, size_t length) {
+    const unsigned char* p = data;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/* Write the buffered log and sync it, as leader or follower; lock held */
+static void flush_to(Wal* wal, uint64_t lsn) {
+    while (wal->durable_lsn < lsn) {
+        if (wal->flushing) {
+            cond_wait(&wal->flushed, &wal->lock);
+            continue;
+        }
+
+        wal->flushing = 1;
+        if (commit_delay_us > 0) {
+            // Give concurrent committers a chance to join this flush
+            mutex_unlock(&wal->lock);
+            sleep_us(commit_delay_us);
+            mutex_lock(&wal->lock);
+        }
+
+        char* data = wal->buffer;
+        size_t size = wal->used;
+        size_t capacity = wal->capacity;
+        uint64_t target = wal->next_lsn;
+
+        wal->buffer = wal->spare;
+        wal->capacity = wal->spare_capacity;
+        wal->used = 0;
+
+        mutex_unlock(&wal->lock);
+        if (fwrite(data, 1, size, wal->file) != size || !file_sync(wal->file)) {
+            out_perror("Failed to write log");
+        }
+        mutex_lock(&wal->lock);
+
+        wal->spare = data;
+        wal->spare_capacity = capacity;
+        wal->durable_lsn = target;
+        wal->flushing = 0;
+        cond_broadcast(&wal->flushed);
+    }
+}
+
+static uint64_t append_record(Wal* wal, uint32_t type, const void* head, size_t head_length,
+                              const void* body, size_t body_length) {
+    WalRecordHeader header;
+    header.type = type;
+    header.length = (uint32_t)(head_length + body_length);
+    header.checksum = checksum_update(2166136261u, &header.type, sizeof(uint32_t) * 2);
+    header.checksum = checksum_update(header.checksum, head, head_length);
+    header.checksum = checksum_update(header.checksum, body, body_length);
+
+    size_t total = sizeof(header) + head_length + body_length;
+
+    mutex_lock(&wal->lock);
+    if (wal->used + total > wal->capacity) {
+        while (wal->used + total > wal->capacity) {
+            wal->capacity = wal->capacity ? wal->capacity * 2 : 64 * 1024;
+        }
+        wal->buffer = realloc(wal->buffer, wal->capacity);
+    }
+
+    char* out = wal->buffer + wal->used;
+    memcpy(out, &header, sizeof(header));
+    if (head_length > 0) {
+        memcpy(out + sizeof(header), head, head_length);
+    }
+    if (body_length > 0) {
+        memcpy(out + sizeof(header) + head_length, body, body_length);
+    }
+    wal->used += total;
+    wal->next_lsn += total;
+    uint64_t lsn = wal->next_lsn;
+
+    // Bulk loads should not hold the whole log in memory
+    if (wal->used > WAL_FLUSH_BYTES) {
+        flush_to(wal, lsn);
+    }
+    mutex_unlock(&wal->lock);
+    return lsn;
+}
+
+void wal_log_rows(Wal* wal, const char* table_name, int first_row_id, int row_size,
+                  const char* rows, int count) {
+    WalRowsPayload payload;
+    memset(&payload, 0, sizeof(payload));
+    strncpy(payload.table_name, table_name, sizeof(payload.table_name) - 1);
+    payload.first_row_id = first_row_id;
+    payload.row_size = row_size;
+    payload.count = count;
+    append_record(wal, WAL_ROWS, &payload, sizeof(payload), rows, (size_t)count * row_size);
+}
+
+void wal_log_index(Wal* wal, const char* table_name, const BTreeEntry* entries, int count) {
+    WalIndexPayload payload;
+    memset(&payload, 0, sizeof(payload));
+    strncpy(payload.table_name, table_name, sizeof(payload.table_name) - 1);
+    payload.count = count;
+    append_record(wal, WAL_INDEX, &payload, sizeof(payload), entries, count * sizeof(BTreeEntry));
+}
+
+void wal_log_overflow(Wal* wal, const char* table_name, uint64_t offset, const char* data,
+                      uint32_t length) {
+    WalOverflowPayload payload;
+    memset(&payload, 0, sizeof(payload));
+    strncpy(payload.table_name, table_name, sizeof(payload.table_name) - 1);
+    payload.offset = offset;
+    payload.length = length;
+    append_record(wal, WAL_OVERFLOW, &payload, sizeof(payload), data, length);
+}
+
+void wal_log_column(Wal* wal, const char* table_name, int column, uint64_t offset, const char* data,
+                    uint32_t length) {
+    WalColumnPayload payload;
+    memset(&payload, 0, sizeof(payload));
+    strncpy(payload.table_name, table_name, sizeof(payload.table_name) - 1);
+    payload.column = column;
+    payload.offset = offset;
+    payload.length = length;
+    append_record(wal, WAL_COLUMN, &payload, sizeof(payload), data, length);
+}
+
+uint64_t wal_log_commit(Wal* wal) {
+    return append_record(wal, WAL_COMMIT, NULL, 0, NULL, 0);
+}
+
+void wal_commit(Wal* wal, uint64_t lsn) {
+    mutex_lock(&wal->lock);
+    flush_to(wal, lsn);
+    mutex_unlock(&wal->lock);
+}
+
+void wal_hold(Wal* wal) {
+    mutex_lock(&wal->lock);
+    wal->holders++;
+    mutex_unlock(&wal->lock);
+}
+
+void wal_commit_held(Wal* wal, uint64_t lsn) {
+    mutex_lock(&wal->lock);
+    flush_to(wal, lsn);
+    wal->holders--;
+    cond_broadcast(&wal->flushed);
+    mutex_unlock(&wal->lock);
+}
+
+void wal_set_commit_delay(long microseconds) {
+    commit_delay_us = microseconds;
+}
+
+/* ============================================
+   CHECKPOINT
+   ============================================ */
+
+void wal_checkpoint(Wal* wal) {
+    mutex_lock(&wal->lock);
+    flush_to(wal, wal->next_lsn);
+    uint64_t covered = wal->durable_lsn;
+    mutex_unlock(&wal->lock);
+
+    bp_sync_all();
+
+    // Only records the synced pages already reflect may be dropped
+    mutex_lock(&wal->lock);
+    if (wal->durable_lsn == covered && wal->used == 0 && !wal->flushing) {
+        FILE* file = fopen(wal->path, "wb");
+        if (file) {
+            fclose(wal->file);
+            wal->file = file;
+            wal->file_start = covered;
+        }
+    }
+    mutex_unlock(&wal->lock);
+}
+
+void wal_maybe_checkpoint(Wal* wal) {
+    if ((long)(wal->durable_lsn - wal->file_start) > WAL_CHECKPOINT_BYTES) {
+        wal_checkpoint(wal);
+    }
+}
+
+/* Pages are about to reach disk: make every log durable first */
+static void flush_all_logs(void) {
+    for (int i = 0; i < WAL_MAX_DATABASES; i++) {
+        if (wals[i]) {
+            mutex_lock(&wals[i]->lock);
+            flush_to(wals[i], wals[i]->next_lsn);
+            mutex_unlock(&wals[i]->lock);
+        }
+    }
+}
+
+static void checkpoint_all_at_exit(void) {
+    for (int i = 0; i < WAL_MAX_DATABASES; i++) {
+        if (wals[i]) wal_checkpoint(wals[i]);
+    }
+}
+
+/* ============================================
+   RECOVERY
+   ============================================ */
+
+static void redo_rows(const char* db_name, const WalRowsPayload* payload, const char* rows) {
+    char table_path[256];
+    snprintf(table_path, sizeof(table_path), "databases\\%s\\%s.table", db_name, payload->table_name);
+
+    int table_file = bp_open(table_path);
+    if (table_file == -1) return;
+
+    // Row images are written in place, so replaying twice is harmless
+    bp_write(table_file, sizeof(int) + (long)payload->first_row_id * payload->row_size,
+             rows, (size_t)payload->count * payload->row_size);
+
+    int row_count = 0;
+    bp_read(table_file, 0, &row_count, sizeof(int));
+    if (payload->first_row_id + payload->count > row_count) {
+        row_count = payload->first_row_id + payload->count;
+        bp_write(table_file, 0, &row_count, sizeof(int));
+    }
+    bp_release(table_file);
+}
+
+static void redo_overflow(const char* db_name, const WalOverflowPayload* payload, const char* data) {
+    char overflow_path[256];
+    snprintf(overflow_path, sizeof(overflow_path), "databases\\%s\\%s.ovf", db_name, payload->table_name);
+
+    int overflow_file = bp_open(overflow_path);
+    if (overflow_file == -1) return;
+
+    bp_write(overflow_file, (long)payload->offset, data, payload->length);
+
+    uint64_t used = 0;
+    bp_read(overflow_file, 0, &used, sizeof(used));
+    if (payload->offset + payload->length > used) {
+        used = payload->offset + payload->length;
+        bp_write(overflow_file, 0, &used, sizeof(used));
+    }
+    bp_release(overflow_file);
+}
+
+static void redo_column(const char* db_name, const WalColumnPayload* payload, const char* data) {
+    char path[256];
+    column_file_path(path, sizeof(path), db_name, payload->table_name, payload->column);
+
+    // Whole byte ranges, headers included, so replaying twice is harmless
+    int file = bp_open(path);
+    if (file != -1) {
+        bp_write(file, (long)payload->offset, data, payload->length);
+        bp_release(file);
+    }
+}
+
+static void redo_index(BTree* tree, const WalIndexPayload* payload, const BTreeEntry* entries) {
+    for (int i = 0; i < payload->count; i++) {
+        BTreeEntry entry;
+        memcpy(&entry, &entries[i], sizeof(entry));
+        if (!btree_contains(tree, entry.key, entry.row_id)) {
+            btree_insert(tree, entry.key, entry.row_id);
+        }
+    }
+}
+
+/* Index pages reach disk independently of each other, so after a crash the
+   tree may be torn (e.g. a split whose new root never made it). Such an
+   index is rebuilt from the recovered table instead of being patched. */
+static BTree* open_recovered_index(const char* db_name, const char* table_name, int* rebuilt) {
+    char index_path[256];
+    *rebuilt = 0;
+    if (snprintf(index_path, sizeof(index_path), "databases\\%s\\%s.idx", db_name, table_name) >=
+        (int)sizeof(index_path)) {
+        out_printf("Cannot recover index for '%s': path too long\n", table_name);
+        return NULL;
+    }
+
+    BTree* tree = btree_open(index_path);
+    if (tree && btree_validate(tree, NULL)) {
+        return tree;
+    }
+
+    btree_close(tree);
+    out_printf("Rebuilding index for '%s'\n", table_name);
+    *rebuilt = 1;
+    return rebuild_index(db_name, table_name);
+}
+
+/* After redo every row must have exactly one index entry; closes the tree */
+static void verify_index(const char* db_name, const char* table_name, BTree* tree) {
+    char table_path[256];
+    if (snprintf(table_path, sizeof(table_path), "databases\\%s\\%s.table", db_name, table_name) >=
+        (int)sizeof(table_path)) {
+        out_printf("Cannot verify index for '%s': path too long\n", table_name);
+        btree_close(tree);
+        return;
+    }
+
+    int row_count = 0;
+    int table_file = bp_open(table_path);
+    if (table_file != -1) {
+        bp_read(table_file, 0, &row_count, sizeof(int));
+        bp_release(table_file);
+    }
+
+    long entries = 0;
+    int valid = btree_validate(tree, &entries);
+    btree_close(tree);
+
+    if (!valid || entries != row_count) {
+        out_printf("Rebuilding index for '%s'\n", table_name);
+        btree_close(rebuild_index(db_name, table_name));
+    }
+}
+
+/* Length of the log prefix that ends with a commit record */
+static size_t committed_length(const char* log, size_t size) {
+    size_t offset = 0;
+    size_t committed = 0;
+
+    while (offset + sizeof(WalRecordHeader) <= size) {
+        WalRecordHeader header;
+        memcpy(&header, log + offset, sizeof(header));
+        if (header.length > size - offset - sizeof(header)) break;
+
+        uint32_t checksum = checksum_update(2166136261u, &header.type, sizeof(uint32_t) * 2);
+        checksum = checksum_update(checksum, log + offset + sizeof(header), header.length);
+        if (checksum != header.checksum) break;     // Torn tail
+
+        offset += sizeof(header) + header.length;
+        if (header.type == WAL_COMMIT) committed = offset;
+    }
+    return committed;
+}
+
+static void recover(Wal* wal) {
+    FILE* file = fopen(wal->path, "rb");
+    if (!file) return;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0) {
+        fclose(file);
+        return;
+    }
+
+    char* log = malloc(size);
+    size_t got = fread(log, 1, size, file);
+    fclose(file);
+
+    size_t end = committed_length(log, got);
+    int records = 0;
+    char tables[WAL_RECOVERY_TABLES][64];
+    int table_count = 0;
+
+    // Pass 1: row images, overflow bytes and column writes, and the tables
+    // whose indexes changed
+    for (size_t offset = 0; offset < end; ) {
+        WalRecordHeader header;
+        memcpy(&header, log + offset, sizeof(header));
+        const char* payload = log + offset + sizeof(header);
+
+        if (header.type == WAL_ROWS) {
+            WalRowsPayload rows;
+            memcpy(&rows, payload, sizeof(rows));
+            redo_rows(wal->db_name, &rows, payload + sizeof(rows));
+            records++;
+        } else if (header.type == WAL_OVERFLOW) {
+            WalOverflowPayload overflow;
+            memcpy(&overflow, payload, sizeof(overflow));
+            redo_overflow(wal->db_name, &overflow, payload + sizeof(overflow));
+            records++;
+        } else if (header.type == WAL_COLUMN) {
+            WalColumnPayload column;
+            memcpy(&column, payload, sizeof(column));
+            redo_column(wal->db_name, &column, payload + sizeof(column));
+            records++;
+        } else if (header.type == WAL_INDEX) {
+            WalIndexPayload index;
+            memcpy(&index, payload, sizeof(index));
+            int seen = 0;
+            for (int i = 0; i < table_count; i++) {
+                if (strcmp(tables[i], index.table_name) == 0) seen = 1;
+            }
+            if (!seen && table_count < WAL_RECOVERY_TABLES) {
+                strcpy(tables[table_count++], index.table_name);
+            }
+        }
+        offset += sizeof(header) + header.length;
+    }
+
+    // Pass 2: index entries, one table at a time
+    for (int t = 0; t < table_count; t++) {
+        int rebuilt;
+        BTree* tree = open_recovered_index(wal->db_name, tables[t], &rebuilt);
+        if (!tree) continue;
+
+        if (!rebuilt) {
+            for (size_t offset = 0; offset < end; ) {
+                WalRecordHeader header;
+                memcpy(&header, log + offset, sizeof(header));
+                const char* payload = log + offset + sizeof(header);
+
+                if (header.type == WAL_INDEX) {
+                    WalIndexPayload index;
+                    memcpy(&index, payload, sizeof(index));
+                    if (strcmp(index.table_name, tables[t]) == 0) {
+                        redo_index(tree, &index, (const BTreeEntry*)(payload + sizeof(index)));
+                        records++;
+                    }
+                }
+                offset += sizeof(header) + header.length;
+            }
+            verify_index(wal->db_name, tables[t], tree);
+        } else {
+            btree_close(tree);
+        }
+    }
+    free(log);
+
+    if (records > 0) {
+        out_printf("Recovered %d log record(s) for database '%s'\n", records, wal->db_name);
+    }
+    bp_sync_all();
+}
+
+/* ============================================
+   OPEN AND CLOSE
+   ============================================ */
+
+Wal* wal_get(const char* db_name) {
+    int free_slot = -1;
+    for (int i = 0; i < WAL_MAX_DATABASES; i++) {
+        if (wals[i] && strcmp(wals[i]->db_name, db_name) == 0) return wals[i];
+        if (!wals[i] && free_slot == -1) free_slot = i;
+    }
+
+    if (commit_delay_us < 0) {
+        const char* env = getenv("BRANCHDB_COMMIT_DELAY_US");
+        commit_delay_us = env ? atol(env) : WAL_DEFAULT_COMMIT_DELAY_US;
+        bp_set_write_hook(flush_all_logs);
+        atexit(checkpoint_all_at_exit);
+    }
+
+    // Out of slots: checkpoint and reuse the first log
+    if (free_slot == -1) {
+        wal_checkpoint(wals[0]);
+        wal_forget(wals[0]->db_name);
+        free_slot = 0;
+    }
+
+    Wal* wal = calloc(1, sizeof(Wal));
+    strncpy(wal->db_name, db_name, sizeof(wal->db_name) - 1);
+    snprintf(wal->path, sizeof(wal->path), "databases\\%s\\wal.log", db_name);
+    mutex_init(&wal->lock);
+    cond_init(&wal->flushed);
+
+    recover(wal);
+
+    // Everything recovered is on disk now; start an empty log
+    wal->file = fopen(wal->path, "wb");
+    if (!wal->file) {
+        out_perror("Failed to open log");
+        mutex_destroy(&wal->lock);
+        cond_destroy(&wal->flushed);
+        free(wal);
+        return NULL;
+    }
+
+    wals[free_slot] = wal;
+    return wal;
+}
+
+void wal_forget(const char* db_name) {
+    for (int i = 0; i < WAL_MAX_DATABASES; i++) {
+        Wal* wal = wals[i];
+        if (!wal || strcmp(wal->db_name, db_name) != 0) continue;
+
+        // Commits made outside the engine lock still use it
+        mutex_lock(&wal->lock);
+        while (wal->holders > 0) {
+            cond_wait(&wal->flushed, &wal->lock);
+        }
+        mutex_unlock(&wal->lock);
+
+        wals[i] = NULL;
+        fclose(wal->file);
+        mutex_destroy(&wal->lock);
+        cond_destroy(&wal->flushed);
+        free(wal->buffer);
+        free(wal->spare);
+        free(wal);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <stdint.h>
+#include "btree.h"
+
+/* =======================
+   WRITE-AHEAD LOG
+   ======================= */
+
+/*
+ * Redo log kept as wal.log in each database directory. Appends are logged
+ * (row images, overflow bytes, column file writes and index entries) and sealed with a commit record before
+ * they touch the buffer pool, and the pool flushes the log before any
+ * dirty page reaches disk, so every page on disk is covered by durable,
+ * committed log records.
+ *
+ * Commits use group commit: the first committer to find the log not yet
+ * durable becomes the leader, optionally waits the commit delay for
+ * others to join, and writes and syncs everything logged so far in one
+ * go; followers just wait for it. Recovery replays committed records
+ * idempotently when a database is first used, then checkpoints.
+ */
+
+#define WAL_MAX_DATABASES 16
+#define WAL_CHECKPOINT_BYTES (32L * 1024 * 1024)
+#define WAL_DEFAULT_COMMIT_DELAY_US 0       // Override with BRANCHDB_COMMIT_DELAY_US
+
+typedef enum {
+    WAL_ROWS = 1,       // Row images appended to a table
+    WAL_INDEX,          // Entries inserted into a table's index
+    WAL_COMMIT,         // Everything logged before this is committed
+    WAL_OVERFLOW,       // Long varchar bytes appended to a table's overflow file
+    WAL_COLUMN          // Bytes written to a column-stored table's files
+} WalRecordType;
+
+typedef struct Wal Wal;
+
+/* Log for a database, opened (and recovered) on first use */
+Wal* wal_get(const char* db_name);
+
+/* Close a database's log without checkpointing (before DROP DATABASE) */
+void wal_forget(const char* db_name);
+
+/* Log `count` rows written at first_row_id, and index entries */
+void wal_log_rows(Wal* wal, const char* table_name, int first_row_id, int row_size,
+                  const char* rows, int count);
+void wal_log_index(Wal* wal, const char* table_name, const BTreeEntry* entries, int count);
+
+/* Log `length` bytes written at offset in the table's overflow file */
+void wal_log_overflow(Wal* wal, const char* table_name, uint64_t offset, const char* data,
+                      uint32_t length);
+
+/* Log `length` bytes written at offset in a column file of a table, or in
+   its .table file for column -1 */
+void wal_log_column(Wal* wal, const char* table_name, int column, uint64_t offset, const char* data,
+                    uint32_t length);
+
+/* Seal everything logged so far; returns the LSN to pass to wal_commit() */
+uint64_t wal_log_commit(Wal* wal);
+
+/* Wait until the log is durable up to lsn (group commit) */
+void wal_commit(Wal* wal, uint64_t lsn);
+
+/* A commit made after the engine lock is released: wal_hold(), under the
+   lock, keeps the log from being forgotten until wal_commit_held() has
+   made it durable up to lsn */
+void wal_hold(Wal* wal);
+void wal_commit_held(Wal* wal, uint64_t lsn);
+
+/* Write back and sync all data pages, then truncate the log */
+void wal_checkpoint(Wal* wal);
+
+/* Checkpoint once the log has grown past WAL_CHECKPOINT_BYTES */
+void wal_maybe_checkpoint(Wal* wal);
+
+/* Commit delay in microseconds for group commit leaders */
+void wal_set_commit_delay(long microseconds);
+
+#endif